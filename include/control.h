@@ -227,6 +227,7 @@ int snd_card_get_longname(int card, char **name);
 
 int snd_device_name_hint(int card, const char *iface, void ***hints);
 int snd_device_name_free_hint(void **hints);
+int snd_device_name_hint_flush(int card);
 char *snd_device_name_get_hint(const void *hint, const char *id);
 
 int snd_ctl_open(snd_ctl_t **ctl, const char *name, int mode);
@@ -493,6 +494,9 @@ const void * snd_ctl_elem_value_get_bytes(const snd_ctl_elem_value_t *obj);
 void snd_ctl_elem_value_get_iec958(const snd_ctl_elem_value_t *obj, snd_aes_iec958_t *ptr);
 void snd_ctl_elem_value_set_iec958(snd_ctl_elem_value_t *obj, const snd_aes_iec958_t *ptr);
 
+/** dB conversion table built from a TLV */
+typedef struct _snd_tlv_dB_table snd_tlv_dB_table_t;
+
 int snd_tlv_parse_dB_info(unsigned int *tlv, unsigned int tlv_size,
 			  unsigned int **db_tlvp);
 int snd_tlv_get_dB_range(unsigned int *tlv, long rangemin, long rangemax,
@@ -501,12 +505,23 @@ int snd_tlv_convert_to_dB(unsigned int *tlv, long rangemin, long rangemax,
 			  long volume, long *db_gain);
 int snd_tlv_convert_from_dB(unsigned int *tlv, long rangemin, long rangemax,
 			    long db_gain, long *value, int xdir);
+int snd_tlv_dB_table_new(snd_tlv_dB_table_t **tablep, unsigned int *tlv,
+			 long rangemin, long rangemax);
+void snd_tlv_dB_table_free(snd_tlv_dB_table_t *table);
+int snd_tlv_dB_table_get_range(snd_tlv_dB_table_t *table,
+			       long *min, long *max);
+int snd_tlv_dB_table_convert_to_dB(snd_tlv_dB_table_t *table,
+				   long volume, long *db_gain);
+int snd_tlv_dB_table_convert_from_dB(snd_tlv_dB_table_t *table,
+				     long db_gain, long *value, int xdir);
 int snd_ctl_get_dB_range(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
 			 long *min, long *max);
 int snd_ctl_convert_to_dB(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
 			  long volume, long *db_gain);
 int snd_ctl_convert_from_dB(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
 			    long db_gain, long *value, int xdir);
+int snd_ctl_get_dB_table(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
+			 snd_tlv_dB_table_t **tablep);
 
 /**
  *  \defgroup HControl High level Control Interface
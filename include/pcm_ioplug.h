@@ -67,13 +67,15 @@ typedef snd_pcm_ioplug_callback snd_pcm_ioplug_callback_t;
 #define SND_PCM_IOPLUG_FLAG_MONOTONIC	(1<<1)		/**< monotonic timestamps */
 /** hw pointer wrap around at boundary instead of buffer_size */
 #define SND_PCM_IOPLUG_FLAG_BOUNDARY_WA	(1<<2)
+/** transfer the data via the lock-free ring buffer; since v1.0.3 */
+#define SND_PCM_IOPLUG_FLAG_RING	(1<<3)
 
 /*
  * Protocol version
  */
 #define SND_PCM_IOPLUG_VERSION_MAJOR	1	/**< Protocol major version */
 #define SND_PCM_IOPLUG_VERSION_MINOR	0	/**< Protocol minor version */
-#define SND_PCM_IOPLUG_VERSION_TINY	2	/**< Protocol tiny version */
+#define SND_PCM_IOPLUG_VERSION_TINY	3	/**< Protocol tiny version */
 /**
  * IO-plugin protocol version
  */
@@ -134,7 +136,8 @@ struct snd_pcm_ioplug_callback {
 	 */
 	int (*stop)(snd_pcm_ioplug_t *io);
 	/**
-	 * get the current DMA position; required, called inside mutex lock
+	 * get the current DMA position; required unless
+	 * #SND_PCM_IOPLUG_FLAG_RING is set, called inside mutex lock
 	 * \return buffer position up to buffer_size or
 	 * when #SND_PCM_IOPLUG_FLAG_BOUNDARY_WA flag is set up to boundary or
 	 * a negative error code for Xrun
@@ -156,7 +159,8 @@ struct snd_pcm_ioplug_callback {
 	 */
 	int (*hw_params)(snd_pcm_ioplug_t *io, snd_pcm_hw_params_t *params);
 	/**
-	 * hw_free; optional
+	 * hw_free; optional; with #SND_PCM_IOPLUG_FLAG_RING the I/O thread
+	 * must not access the ring after this callback returns
 	 */
 	int (*hw_free)(snd_pcm_ioplug_t *io);
 	/**
@@ -242,6 +246,16 @@ snd_pcm_uframes_t snd_pcm_ioplug_hw_avail(const snd_pcm_ioplug_t * const ioplug,
 					  const snd_pcm_uframes_t hw_ptr,
 					  const snd_pcm_uframes_t appl_ptr);
 
+/* lock-free ring buffer transport (SND_PCM_IOPLUG_FLAG_RING) */
+int snd_pcm_ioplug_ring_fd(snd_pcm_ioplug_t *ioplug);
+snd_pcm_sframes_t snd_pcm_ioplug_ring_avail(snd_pcm_ioplug_t *ioplug);
+snd_pcm_sframes_t snd_pcm_ioplug_ring_read(snd_pcm_ioplug_t *ioplug,
+					   void *buf, snd_pcm_uframes_t frames);
+snd_pcm_sframes_t snd_pcm_ioplug_ring_write(snd_pcm_ioplug_t *ioplug,
+					    const void *buf,
+					    snd_pcm_uframes_t frames);
+int snd_pcm_ioplug_ring_wait(snd_pcm_ioplug_t *ioplug, int timeout);
+
 /** \} */
 
 #endif /* __ALSA_PCM_IOPLUG_H */
@@ -79,6 +79,19 @@ typedef enum _snd_rawmidi_type {
 	SND_RAWMIDI_TYPE_VIRTUAL
 } snd_rawmidi_type_t;
 
+/** Maximum number of MIDI bytes in one #snd_rawmidi_frame_t */
+#define SND_RAWMIDI_FRAME_DATA_LENGTH	16
+
+/** Timestamped block of received MIDI bytes */
+typedef struct _snd_rawmidi_frame {
+	/** time when the bytes were received */
+	snd_htimestamp_t tstamp;
+	/** number of valid bytes in data */
+	unsigned int length;
+	/** MIDI bytes */
+	unsigned char data[SND_RAWMIDI_FRAME_DATA_LENGTH];
+} snd_rawmidi_frame_t;
+
 int snd_rawmidi_open(snd_rawmidi_t **in_rmidi, snd_rawmidi_t **out_rmidi,
 		     const char *name, int mode);
 int snd_rawmidi_open_lconf(snd_rawmidi_t **in_rmidi, snd_rawmidi_t **out_rmidi,
@@ -145,6 +158,7 @@ int snd_rawmidi_drain(snd_rawmidi_t *rmidi);
 int snd_rawmidi_drop(snd_rawmidi_t *rmidi);
 ssize_t snd_rawmidi_write(snd_rawmidi_t *rmidi, const void *buffer, size_t size);
 ssize_t snd_rawmidi_read(snd_rawmidi_t *rmidi, void *buffer, size_t size);
+ssize_t snd_rawmidi_read_frames(snd_rawmidi_t *rmidi, snd_rawmidi_frame_t *frames, size_t count);
 const char *snd_rawmidi_name(snd_rawmidi_t *rmidi);
 snd_rawmidi_type_t snd_rawmidi_type(snd_rawmidi_t *rmidi);
 snd_rawmidi_stream_t snd_rawmidi_stream(snd_rawmidi_t *rawmidi);
@@ -90,6 +90,8 @@ size_t snd_seq_get_output_buffer_size(snd_seq_t *handle);
 size_t snd_seq_get_input_buffer_size(snd_seq_t *handle);
 int snd_seq_set_output_buffer_size(snd_seq_t *handle, size_t size);
 int snd_seq_set_input_buffer_size(snd_seq_t *handle, size_t size);
+size_t snd_seq_get_input_buffer_max_size(snd_seq_t *handle);
+int snd_seq_set_input_buffer_max_size(snd_seq_t *handle, size_t size);
 
 /** system information container */
 typedef struct _snd_seq_system_info snd_seq_system_info_t;
@@ -521,7 +523,9 @@ ssize_t snd_seq_event_length(snd_seq_event_t *ev);
 int snd_seq_event_output(snd_seq_t *handle, snd_seq_event_t *ev);
 int snd_seq_event_output_buffer(snd_seq_t *handle, snd_seq_event_t *ev);
 int snd_seq_event_output_direct(snd_seq_t *handle, snd_seq_event_t *ev);
+int snd_seq_event_output_batch(snd_seq_t *handle, snd_seq_event_t *evs, unsigned int count);
 int snd_seq_event_input(snd_seq_t *handle, snd_seq_event_t **ev);
+int snd_seq_event_input_batch(snd_seq_t *handle, snd_seq_event_t **evs, unsigned int max);
 int snd_seq_event_input_pending(snd_seq_t *seq, int fetch_sequencer);
 int snd_seq_drain_output(snd_seq_t *handle);
 int snd_seq_event_output_pending(snd_seq_t *seq);
@@ -52,8 +52,10 @@ void snd_midi_event_no_status(snd_midi_event_t *dev, int on);
 /* encode from byte stream - return number of written bytes if success */
 long snd_midi_event_encode(snd_midi_event_t *dev, const unsigned char *buf, long count, snd_seq_event_t *ev);
 int snd_midi_event_encode_byte(snd_midi_event_t *dev, int c, snd_seq_event_t *ev);
+long snd_midi_event_encode_block(snd_midi_event_t *dev, const unsigned char *buf, long count, snd_seq_event_t *evs, unsigned int max, unsigned int *nevs);
 /* decode from event to bytes - return number of written bytes if success */
 long snd_midi_event_decode(snd_midi_event_t *dev, unsigned char *buf, long count, const snd_seq_event_t *ev);
+long snd_midi_event_decode_block(snd_midi_event_t *dev, unsigned char *buf, long count, const snd_seq_event_t *evs, unsigned int nevs, unsigned int *done);
 
 /** \} */
 
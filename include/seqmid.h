@@ -360,6 +360,20 @@ int snd_seq_parse_address(snd_seq_t *seq, snd_seq_addr_t *addr, const char *str)
 int snd_seq_reset_pool_output(snd_seq_t *seq);
 int snd_seq_reset_pool_input(snd_seq_t *seq);
 
+/*
+ * client-side queue clock
+ */
+/** queue clock extrapolating the queue position */
+typedef struct _snd_seq_queue_clock snd_seq_queue_clock_t;
+int snd_seq_queue_clock_new(snd_seq_queue_clock_t **clockp, snd_seq_t *seq, int q);
+void snd_seq_queue_clock_free(snd_seq_queue_clock_t *clock);
+int snd_seq_queue_clock_sync(snd_seq_queue_clock_t *clock);
+int snd_seq_queue_clock_update(snd_seq_queue_clock_t *clock, const snd_seq_event_t *ev);
+snd_seq_tick_time_t snd_seq_queue_clock_get_tick(snd_seq_queue_clock_t *clock);
+void snd_seq_queue_clock_get_time(snd_seq_queue_clock_t *clock, snd_seq_real_time_t *rt);
+void snd_seq_queue_clock_tick_to_time(snd_seq_queue_clock_t *clock, snd_seq_tick_time_t tick, snd_seq_real_time_t *rt);
+snd_seq_tick_time_t snd_seq_queue_clock_time_to_tick(snd_seq_queue_clock_t *clock, const snd_seq_real_time_t *rt);
+
 /**
  * \brief set note event
  * \param ev event record
@@ -246,6 +246,34 @@ long snd_timer_status_get_lost(snd_timer_status_t * status);
 long snd_timer_status_get_overrun(snd_timer_status_t * status);
 long snd_timer_status_get_queue(snd_timer_status_t * status);
 
+/** timer group handle */
+typedef struct _snd_timer_group snd_timer_group_t;
+
+/** timer group event statistics */
+typedef struct _snd_timer_group_stats {
+	unsigned long events;		/**< count of dispatched events */
+	unsigned long reads;		/**< count of read calls */
+	unsigned long ticks;		/**< count of ticks reported by tick events */
+	unsigned long missed;		/**< ticks merged into a later tick event */
+	long overrun;			/**< events lost on the kernel queue overflow */
+} snd_timer_group_stats_t;
+
+/** timer group callback, called with a batch of events read from timer */
+typedef void (*snd_timer_group_callback_t)(snd_timer_t *timer,
+					   const snd_timer_tread_t *events,
+					   unsigned int count,
+					   void *private_data);
+
+int snd_timer_group_new(snd_timer_group_t **group);
+int snd_timer_group_free(snd_timer_group_t *group);
+int snd_timer_group_add(snd_timer_group_t *group, snd_timer_t *timer,
+			snd_timer_group_callback_t callback, void *private_data);
+int snd_timer_group_remove(snd_timer_group_t *group, snd_timer_t *timer);
+int snd_timer_group_poll_descriptor(snd_timer_group_t *group);
+int snd_timer_group_dispatch(snd_timer_group_t *group, int timeout);
+int snd_timer_group_get_stats(snd_timer_group_t *group, snd_timer_t *timer,
+			      snd_timer_group_stats_t *stats);
+
 /* deprecated functions, for compatibility */
 long snd_timer_info_get_ticks(snd_timer_info_t * info);
 
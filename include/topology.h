@@ -1109,6 +1109,16 @@ typedef struct snd_tplg_obj_template {
  */
 int snd_tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t);
 
+/**
+ * \brief Remove an object from the topology.
+ * \param tplg Topology instance.
+ * \param t Template with the type, index and name of the object.
+ * \return Zero on success, otherwise a negative error code
+ *
+ * The routes are matched by the source, control and sink names.
+ */
+int snd_tplg_remove_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t);
+
 /**
  * \brief Build all registered topology data into binary file.
  * \param tplg Topology instance.
@@ -1158,15 +1168,132 @@ int snd_tplg_set_version(snd_tplg_t *tplg, unsigned int version);
  */
 int snd_tplg_save(snd_tplg_t *tplg, char **dst, int flags);
 
+/**
+ * \brief Save the topology to the text configuration output.
+ * \param tplg Topology instance.
+ * \param out Output handle.
+ * \param flags Save flags.
+ * \return Zero on success, otherwise a negative error code
+ *
+ * The text is passed to the output in chunks as it is rendered.
+ */
+int snd_tplg_save_output(snd_tplg_t *tplg, snd_output_t *out, int flags);
+
+/*
+ * Flags for the snd_tplg_decode()
+ */
+#define SND_TPLG_DECODE_INCREMENTAL (1<<0)	/*!< keep the blocks for snd_tplg_build_bin() */
+
 /**
  * \brief Decode the binary topology contents.
  * \param tplg Topology instance.
  * \param bin Binary topology input buffer.
  * \param size Binary topology input buffer size.
+ * \param dflags Decode flags.
  * \return Zero on success, otherwise a negative error code
+ *
+ * With #SND_TPLG_DECODE_INCREMENTAL, the next build copies the blocks
+ * without added or removed objects from the input verbatim and encodes
+ * only the changed blocks.
  */
 int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags);
 
+/**
+ * \brief Decode the binary topology file.
+ * \param tplg Topology instance.
+ * \param filename Binary topology file name.
+ * \param dflags Decode flags.
+ * \return Zero on success, otherwise a negative error code
+ *
+ * The file is memory-mapped and decoded in place.
+ */
+int snd_tplg_decode_file(snd_tplg_t *tplg, const char *filename, int dflags);
+
+/** Read-only view of the binary topology */
+typedef struct snd_tplg_view snd_tplg_view_t;
+
+/** Block of the binary topology view */
+typedef struct snd_tplg_view_block {
+	int type;			/*!< SND_TPLG_TYPE_* or -1 if unknown */
+	unsigned int asoc_type;		/*!< SND_SOC_TPLG_TYPE_* from the header */
+	unsigned int version;		/*!< block version */
+	unsigned int vendor_type;	/*!< vendor type */
+	unsigned int index;		/*!< group index */
+	unsigned int count;		/*!< number of elements */
+	size_t pos;			/*!< offset of the block header */
+	const void *payload;		/*!< block payload */
+	size_t payload_size;		/*!< payload size in bytes */
+} snd_tplg_view_block_t;
+
+/** Element of the binary topology view block */
+typedef struct snd_tplg_view_elem {
+	const void *data;		/*!< element (struct snd_soc_tplg_*) */
+	size_t size;			/*!< element size including private data */
+	size_t pos;			/*!< offset of the element in the view */
+} snd_tplg_view_elem_t;
+
+/**
+ * \brief Open a read-only view of the binary topology file.
+ * \param view Returned view handle.
+ * \param filename Binary topology file name.
+ * \return Zero on success, otherwise a negative error code
+ *
+ * The file is memory-mapped, nothing is copied. The headers are validated
+ * when the blocks and elements are iterated.
+ */
+int snd_tplg_view_open(snd_tplg_view_t **view, const char *filename);
+
+/**
+ * \brief Open a read-only view of the binary topology buffer.
+ * \param view Returned view handle.
+ * \param bin Binary topology buffer (must be valid until the view is closed).
+ * \param size Binary topology buffer size.
+ * \return Zero on success, otherwise a negative error code
+ */
+int snd_tplg_view_open_bin(snd_tplg_view_t **view, const void *bin, size_t size);
+
+/**
+ * \brief Close the binary topology view.
+ * \param view View handle.
+ * \return Zero on success, otherwise a negative error code
+ */
+int snd_tplg_view_close(snd_tplg_view_t *view);
+
+/**
+ * \brief Restart the block iteration from the beginning.
+ * \param view View handle.
+ */
+void snd_tplg_view_rewind(snd_tplg_view_t *view);
+
+/**
+ * \brief Get the next block of the view.
+ * \param view View handle.
+ * \param block Returned block.
+ * \return 1 when a block was returned, 0 at the end, otherwise a negative error code
+ */
+int snd_tplg_view_next_block(snd_tplg_view_t *view, snd_tplg_view_block_t *block);
+
+/**
+ * \brief Get the next element of the block.
+ * \param block Block returned by snd_tplg_view_next_block().
+ * \param offset Iteration state, set to zero before the first call.
+ * \param elem Returned element.
+ * \return 1 when an element was returned, 0 at the end, otherwise a negative error code
+ *
+ * The widget elements include the following kcontrols.
+ */
+int snd_tplg_view_block_next_elem(const snd_tplg_view_block_t *block,
+				  size_t *offset, snd_tplg_view_elem_t *elem);
+
+/**
+ * \brief Decode the whole view into the topology instance.
+ * \param view View handle.
+ * \param tplg Topology instance.
+ * \param dflags Decode flags.
+ * \return Zero on success, otherwise a negative error code
+ */
+int snd_tplg_view_decode(snd_tplg_view_t *view, snd_tplg_t *tplg, int dflags);
+
 /* \} */
 
 #ifdef __cplusplus
@@ -26,9 +26,15 @@
  */
 
 #include "local.h"
+#include "list.h"
+#include <sys/stat.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef DOC_HIDDEN
 #define DEV_SKIP	9999 /* some non-existing device number */
+#define HINT_FILE_CONTROL	ALSA_DEVICE_DIRECTORY "controlC%i"
 struct hint_list {
 	char **list;
 	unsigned int count;
@@ -45,6 +51,41 @@ struct hint_list {
 	int show_all;
 	char *cardname;
 };
+
+/* identity of the card control device, a new node for a new card */
+struct hint_card_id {
+	dev_t rdev;
+	ino_t ino;
+	struct timespec ctime;
+};
+
+/* the hints of one card or of the software devices (card -1) */
+struct hint_cache_entry {
+	struct list_head list;
+	snd_ctl_elem_iface_t iface;
+	int card;
+	struct hint_card_id id;
+	char **hints;
+	unsigned int count;
+};
+
+/* process-wide cache, see snd_device_name_hint() */
+static struct {
+	snd_config_t *config;
+	snd_config_update_t *update;
+	struct hint_card_id config_cards[SND_MAX_CARDS];
+} hint_cache;
+
+static LIST_HEAD(hint_cache_list);
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t hint_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define hint_cache_lock()	pthread_mutex_lock(&hint_cache_mutex)
+#define hint_cache_unlock()	pthread_mutex_unlock(&hint_cache_mutex)
+#else
+#define hint_cache_lock()	do { } while (0)
+#define hint_cache_unlock()	do { } while (0)
+#endif
 #endif
 
 static int hint_list_add(struct hint_list *list,
@@ -553,6 +594,219 @@ static int add_software_devices(snd_config_t *config, snd_config_t *rw_config,
 	return 0;
 }
 
+static int hint_card_id(int card, struct hint_card_id *id)
+{
+	char control[sizeof(HINT_FILE_CONTROL) + 10];
+	struct stat st;
+
+	sprintf(control, HINT_FILE_CONTROL, card);
+	if (stat(control, &st) < 0)
+		return -errno;
+	id->rdev = st.st_rdev;
+	id->ino = st.st_ino;
+	id->ctime = st.st_ctim;
+	return 0;
+}
+
+static int hint_card_id_equal(const struct hint_card_id *a,
+			      const struct hint_card_id *b)
+{
+	return a->rdev == b->rdev && a->ino == b->ino &&
+	       a->ctime.tv_sec == b->ctime.tv_sec &&
+	       a->ctime.tv_nsec == b->ctime.tv_nsec;
+}
+
+static void hint_cache_entry_free(struct hint_cache_entry *e)
+{
+	list_del(&e->list);
+	snd_device_name_free_hint((void **)e->hints);
+	free(e);
+}
+
+/* drop the entries of the card, -1 = all */
+static void hint_cache_flush(int card)
+{
+	struct list_head *pos, *npos;
+	struct hint_cache_entry *e;
+
+	list_for_each_safe(pos, npos, &hint_cache_list) {
+		e = list_entry(pos, struct hint_cache_entry, list);
+		if (card < 0 || e->card == card)
+			hint_cache_entry_free(e);
+	}
+}
+
+static void hint_cache_config_free(void)
+{
+	if (hint_cache.config)
+		snd_config_delete(hint_cache.config);
+	if (hint_cache.update)
+		snd_config_update_free(hint_cache.update);
+	hint_cache.config = NULL;
+	hint_cache.update = NULL;
+}
+
+/*
+ * Bring the cached configuration and entries up to date: the entries of
+ * the removed or replaced cards are dropped, a change of the
+ * configuration files drops all entries. The card specific configuration
+ * is loaded only for the cards present when the configuration is read,
+ * so a new card rereads it, but the entries of the other cards are kept.
+ * The software devices (card -1) are built from the whole configuration,
+ * so their entry is dropped on every reload.
+ */
+static int hint_cache_update(int card)
+{
+	struct hint_card_id cards[SND_MAX_CARDS];
+	struct list_head *pos, *npos;
+	struct hint_cache_entry *e;
+	int c, first, last, reload = 0, err;
+
+	memset(cards, 0, sizeof(cards));
+	for (c = 0; c < SND_MAX_CARDS; c++)
+		hint_card_id(c, &cards[c]);
+
+	list_for_each_safe(pos, npos, &hint_cache_list) {
+		e = list_entry(pos, struct hint_cache_entry, list);
+		if (e->card >= 0 && !hint_card_id_equal(&cards[e->card], &e->id))
+			hint_cache_entry_free(e);
+	}
+
+	err = snd_config_update_r(&hint_cache.config, &hint_cache.update, NULL);
+	if (err < 0)
+		return err;
+	if (err > 0) {
+		hint_cache_flush(-1);
+	} else {
+		first = card >= 0 ? card : 0;
+		last = card >= 0 ? card : SND_MAX_CARDS - 1;
+		for (c = first; c <= last && !reload; c++)
+			reload = cards[c].ino != 0 &&
+				 !hint_card_id_equal(&cards[c], &hint_cache.config_cards[c]);
+		if (!reload)
+			return 0;
+		hint_cache_config_free();
+		err = snd_config_update_r(&hint_cache.config,
+					  &hint_cache.update, NULL);
+		if (err < 0)
+			return err;
+		list_for_each_safe(pos, npos, &hint_cache_list) {
+			e = list_entry(pos, struct hint_cache_entry, list);
+			if (e->card < 0)
+				hint_cache_entry_free(e);
+		}
+	}
+	memcpy(hint_cache.config_cards, cards, sizeof(cards));
+	return 0;
+}
+
+static struct hint_cache_entry *hint_cache_find(snd_ctl_elem_iface_t iface,
+						int card)
+{
+	struct list_head *pos;
+	struct hint_cache_entry *e;
+
+	list_for_each(pos, &hint_cache_list) {
+		e = list_entry(pos, struct hint_cache_entry, list);
+		if (e->iface == iface && e->card == card)
+			return e;
+	}
+	return NULL;
+}
+
+/* move the built hints to the cache */
+static void hint_cache_put(struct hint_list *list, int card)
+{
+	struct hint_cache_entry *e;
+
+	e = calloc(1, sizeof(*e));
+	if (e == NULL)
+		return;
+	/* the list is NULL terminated for snd_device_name_free_hint() */
+	if (list->list == NULL)
+		e->hints = calloc(1, sizeof(char *));
+	else
+		e->hints = list->list;
+	if (e->hints == NULL ||
+	    (card >= 0 && hint_card_id(card, &e->id) < 0)) {
+		if (e->hints != list->list)
+			free(e->hints);
+		free(e);
+		return;
+	}
+	e->iface = list->iface;
+	e->card = card;
+	e->count = list->count;
+	list->list = NULL;
+	list_add_tail(&e->list, &hint_cache_list);
+}
+
+static int hint_list_append(struct hint_list *list, char **hints,
+			    unsigned int count)
+{
+	unsigned int idx;
+	char **n;
+
+	if (list->count + count + 1 > list->allocated) {
+		n = realloc(list->list, (list->count + count + 10) * sizeof(char *));
+		if (n == NULL)
+			return -ENOMEM;
+		memset(n + list->allocated, 0,
+		       (list->count + count + 10 - list->allocated) * sizeof(*n));
+		list->allocated = list->count + count + 10;
+		list->list = n;
+	}
+	for (idx = 0; idx < count; idx++) {
+		list->list[list->count] = strdup(hints[idx]);
+		if (list->list[list->count] == NULL)
+			return -ENOMEM;
+		list->count++;
+	}
+	return 0;
+}
+
+/*
+ * Add the hints of the card or of the software devices (card -1),
+ * from the cache if enabled. The read-write configuration copy is
+ * created only when the hints are built.
+ */
+static int add_hints(snd_config_t *config, snd_config_t **rw_config,
+		     struct hint_list *list, int card, int cached)
+{
+	struct hint_list l;
+	struct hint_cache_entry *e;
+	int err;
+
+	if (cached) {
+		e = hint_cache_find(list->iface, card);
+		if (e)
+			return hint_list_append(list, e->hints, e->count);
+	}
+	if (*rw_config == NULL) {
+		err = snd_config_copy(rw_config, config);
+		if (err < 0)
+			return err;
+	}
+	memset(&l, 0, sizeof(l));
+	l.siface = list->siface;
+	l.iface = list->iface;
+	l.show_all = list->show_all;
+	if (card >= 0) {
+		err = get_card_name(&l, card);
+		if (err >= 0)
+			err = add_card(config, *rw_config, &l, card);
+	} else {
+		err = add_software_devices(config, *rw_config, &l);
+	}
+	free(l.cardname);
+	if (err >= 0)
+		err = hint_list_append(list, l.list, l.count);
+	if (err >= 0 && cached)
+		hint_cache_put(&l, card);
+	snd_device_name_free_hint((void **)l.list);
+	return err;
+}
+
 /**
  * \brief Get a set of device name hints
  * \param card Card number or -1 (means all cards)
@@ -578,25 +832,25 @@ static int add_software_devices(snd_config_t *config, snd_config_t *rw_config,
  *
  * Special variables: defaults.namehint.showall specifies if all device
  * definitions are accepted (boolean type).
+ *
+ * The hints of each card and of the software devices are cached for the
+ * process, so only the cards added since the last call are queried.
+ * The cache is dropped when the configuration files change and the
+ * entry of a card when the card is removed or replaced. The variable
+ * defaults.namehint.cache (boolean type) disables the cache. See also
+ * #snd_device_name_hint_flush.
  */
 int snd_device_name_hint(int card, const char *iface, void ***hints)
 {
 	struct hint_list list;
 	char ehints[24];
 	const char *str;
-	snd_config_t *conf, *local_config = NULL, *local_config_rw = NULL;
-	snd_config_update_t *local_config_update = NULL;
+	snd_config_t *conf, *local_config, *local_config_rw = NULL;
 	snd_config_iterator_t i, next;
-	int err;
+	int err, cached = 1;
 
 	if (hints == NULL)
 		return -EINVAL;
-	err = snd_config_update_r(&local_config, &local_config_update, NULL);
-	if (err < 0)
-		return err;
-	err = snd_config_copy(&local_config_rw, local_config);
-	if (err < 0)
-		return err;
 	list.list = NULL;
 	list.count = list.allocated = 0;
 	list.siface = iface;
@@ -616,27 +870,33 @@ int snd_device_name_hint(int card, const char *iface, void ***hints)
 		list.iface = SND_CTL_ELEM_IFACE_HWDEP;
 	else if (strcmp(iface, "ctl") == 0)
 		list.iface = SND_CTL_ELEM_IFACE_MIXER;
-	else {
-		err = -EINVAL;
+	else
+		return -EINVAL;
+
+	hint_cache_lock();
+	err = hint_cache_update(card);
+	if (err < 0)
 		goto __error;
-	}
+	local_config = hint_cache.config;
+	if (snd_config_search(local_config, "defaults.namehint.cache", &conf) >= 0)
+		cached = snd_config_get_bool(conf) > 0;
+	if (!cached)
+		hint_cache_flush(-1);
 
 	if (snd_config_search(local_config, "defaults.namehint.showall", &conf) >= 0)
 		list.show_all = snd_config_get_bool(conf) > 0;
 	if (card >= 0) {
-		err = get_card_name(&list, card);
-		if (err >= 0)
-			err = add_card(local_config, local_config_rw, &list, card);
+		err = add_hints(local_config, &local_config_rw, &list, card, cached);
 	} else {
-		add_software_devices(local_config, local_config_rw, &list);
+		err = add_hints(local_config, &local_config_rw, &list, -1, cached);
+		if (err == -ENOMEM)
+			goto __error;
 		err = snd_card_next(&card);
 		if (err < 0)
 			goto __error;
 		while (card >= 0) {
-			err = get_card_name(&list, card);
-			if (err < 0)
-				goto __error;
-			err = add_card(local_config, local_config_rw, &list, card);
+			err = add_hints(local_config, &local_config_rw, &list,
+					card, cached);
 			if (err < 0)
 				goto __error;
 			err = snd_card_next(&card);
@@ -667,16 +927,32 @@ int snd_device_name_hint(int card, const char *iface, void ***hints)
       		snd_device_name_free_hint((void **)list.list);
 	else
       		*hints = (void **)list.list;
-	free(list.cardname);
 	if (local_config_rw)
 		snd_config_delete(local_config_rw);
-	if (local_config)
-		snd_config_delete(local_config);
-	if (local_config_update)
-		snd_config_update_free(local_config_update);
+	hint_cache_unlock();
 	return err;
 }
 
+/**
+ * \brief Drop the cached device name hints
+ * \param card Card number or -1 (means all cards and the configuration)
+ * \result zero if success, otherwise a negative error code
+ *
+ * The cache is updated by #snd_device_name_hint when a card is added
+ * or removed or the configuration files change. This call is for the
+ * applications which know about other changes of a card (for example
+ * the devices added to a running card), or to release the memory.
+ */
+int snd_device_name_hint_flush(int card)
+{
+	hint_cache_lock();
+	hint_cache_flush(card);
+	if (card < 0)
+		hint_cache_config_free();
+	hint_cache_unlock();
+	return 0;
+}
+
 /**
  * \brief Free a list of device name hints.
  * \param hints List to free
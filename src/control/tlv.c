@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <limits.h>
 #ifndef HAVE_SOFT_FLOAT
 #include <math.h>
 #endif
@@ -410,6 +411,159 @@ int snd_tlv_convert_from_dB(unsigned int *tlv, long rangemin, long rangemax,
 	return -EINVAL;
 }
 
+#ifndef DOC_HIDDEN
+/* max number of raw volume steps for a precomputed dB table */
+#define MAX_DB_TABLE_SIZE	0x10000
+
+/* table entry of a raw value not convertible with the TLV */
+#define DB_TABLE_INVALID	LONG_MIN
+
+struct _snd_tlv_dB_table {
+	long rangemin, rangemax;
+	long dbmin, dbmax;
+	int range_err;		/* error of the dB range evaluation */
+	long *to_dB;		/* raw -> dB, built at the first lookup */
+	unsigned int tlv[0];	/* private copy of the dB TLV */
+};
+#endif
+
+/**
+ * \brief Create a dB conversion table from the given TLV
+ * \param tablep the pointer to store the newly allocated table
+ * \param tlv the TLV source returned by #snd_tlv_parse_dB_info()
+ * \param rangemin the minimum value of the raw volume
+ * \param rangemax the maximum value of the raw volume
+ * \return 0 if successful, or a negative error code
+ *
+ * The dB TLV is copied, so the source buffer can be released after
+ * this call.  The dB range is evaluated once.  When the raw volume
+ * range is reasonably small, the dB gain of every raw value is
+ * precomputed at the first #snd_tlv_dB_table_convert_to_dB() call,
+ * which becomes a simple lookup then.  This is suitable for sliders
+ * showing dB labels for all steps of a control.
+ */
+int snd_tlv_dB_table_new(snd_tlv_dB_table_t **tablep, unsigned int *tlv,
+			 long rangemin, long rangemax)
+{
+	snd_tlv_dB_table_t *table;
+	unsigned int size;
+
+	assert(tablep && tlv);
+	*tablep = NULL;
+	size = int_index(tlv[SNDRV_CTL_TLVO_LEN]) + 2;
+	if (size * sizeof(int) > MAX_TLV_RANGE_SIZE + 2 * sizeof(int))
+		return -EINVAL;
+	table = calloc(1, sizeof(*table) + size * sizeof(int));
+	if (table == NULL)
+		return -ENOMEM;
+	memcpy(table->tlv, tlv, size * sizeof(int));
+	table->rangemin = rangemin;
+	table->rangemax = rangemax;
+	table->range_err = snd_tlv_get_dB_range(table->tlv, rangemin, rangemax,
+						&table->dbmin, &table->dbmax);
+	*tablep = table;
+	return 0;
+}
+
+/* precompute the dB values of all raw values; the values not covered
+ * by the TLV are marked and left to the direct conversion
+ */
+static void dB_table_fill(snd_tlv_dB_table_t *table)
+{
+	long i;
+
+	if (table->rangemax < table->rangemin ||
+	    table->rangemax - table->rangemin >= MAX_DB_TABLE_SIZE)
+		return;
+	table->to_dB = malloc((table->rangemax - table->rangemin + 1) *
+			      sizeof(long));
+	if (table->to_dB == NULL)
+		return;
+	for (i = table->rangemin; i <= table->rangemax; i++) {
+		if (snd_tlv_convert_to_dB(table->tlv, table->rangemin,
+					  table->rangemax, i,
+					  &table->to_dB[i - table->rangemin]) < 0)
+			table->to_dB[i - table->rangemin] = DB_TABLE_INVALID;
+	}
+}
+
+/**
+ * \brief Free a dB conversion table
+ * \param table the table created by #snd_tlv_dB_table_new()
+ */
+void snd_tlv_dB_table_free(snd_tlv_dB_table_t *table)
+{
+	if (table == NULL)
+		return;
+	free(table->to_dB);
+	free(table);
+}
+
+/**
+ * \brief Get the dB min/max values from a dB conversion table
+ * \param table the table created by #snd_tlv_dB_table_new()
+ * \param min the pointer to store the minimum dB value (in 0.01dB unit)
+ * \param max the pointer to store the maximum dB value (in 0.01dB unit)
+ * \return 0 if successful, or a negative error code
+ */
+int snd_tlv_dB_table_get_range(snd_tlv_dB_table_t *table,
+			       long *min, long *max)
+{
+	assert(table);
+	if (table->range_err < 0)
+		return table->range_err;
+	*min = table->dbmin;
+	*max = table->dbmax;
+	return 0;
+}
+
+/**
+ * \brief Convert the given raw volume value to a dB gain using a table
+ * \param table the table created by #snd_tlv_dB_table_new()
+ * \param volume the raw volume value to convert
+ * \param db_gain the dB gain (in 0.01dB unit)
+ * \return 0 if successful, or a negative error code
+ *
+ * The result is identical to #snd_tlv_convert_to_dB() called with
+ * the TLV and the raw volume range given at the table creation.
+ */
+int snd_tlv_dB_table_convert_to_dB(snd_tlv_dB_table_t *table,
+				   long volume, long *db_gain)
+{
+	assert(table);
+	if (table->to_dB == NULL)
+		dB_table_fill(table);
+	if (table->to_dB &&
+	    volume >= table->rangemin && volume <= table->rangemax &&
+	    table->to_dB[volume - table->rangemin] != DB_TABLE_INVALID) {
+		*db_gain = table->to_dB[volume - table->rangemin];
+		return 0;
+	}
+	return snd_tlv_convert_to_dB(table->tlv, table->rangemin,
+				     table->rangemax, volume, db_gain);
+}
+
+/**
+ * \brief Convert from dB gain to the corresponding raw value using a table
+ * \param table the table created by #snd_tlv_dB_table_new()
+ * \param db_gain the dB gain to convert (in 0.01dB unit)
+ * \param value the pointer to store the converted raw volume value
+ * \param xdir the direction for round-up. The value is round up
+ *        when this is positive. A negative value means round down.
+ *        Zero means round-up to nearest.
+ * \return 0 if successful, or a negative error code
+ *
+ * The result is identical to #snd_tlv_convert_from_dB() called with
+ * the TLV and the raw volume range given at the table creation.
+ */
+int snd_tlv_dB_table_convert_from_dB(snd_tlv_dB_table_t *table,
+				     long db_gain, long *value, int xdir)
+{
+	assert(table);
+	return snd_tlv_convert_from_dB(table->tlv, table->rangemin,
+				       table->rangemax, db_gain, value, xdir);
+}
+
 #ifndef DOC_HIDDEN
 #define TEMP_TLV_SIZE		4096
 struct tlv_info {
@@ -508,3 +662,28 @@ int snd_ctl_convert_from_dB(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
 	return snd_tlv_convert_from_dB(info.tlv, info.minval, info.maxval,
 				       db_gain, value, xdir);
 }
+
+/**
+ * \brief Create a dB conversion table for the given control element
+ * \param ctl the control handler
+ * \param id the element id
+ * \param tablep the pointer to store the newly allocated table
+ * \return 0 if successful, or a negative error code
+ *
+ * The element info and TLV are read only once.  The returned table
+ * must be released with #snd_tlv_dB_table_free() and rebuilt when
+ * a TLV change event (#SND_CTL_EVENT_MASK_TLV) is received for
+ * the element.
+ */
+int snd_ctl_get_dB_table(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
+			 snd_tlv_dB_table_t **tablep)
+{
+	struct tlv_info info;
+	int err;
+
+	err = get_tlv_info(ctl, id, &info);
+	if (err < 0)
+		return err;
+	return snd_tlv_dB_table_new(tablep, info.tlv, info.minval,
+				    info.maxval);
+}
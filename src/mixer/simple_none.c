@@ -86,7 +86,7 @@ typedef struct _selem_none {
 		unsigned int channels;
 		long vol[32];
 		unsigned int sw;
-		unsigned int *db_info;
+		snd_tlv_dB_table_t *db_table;
 	} str[2];
 } selem_none_t;
 
@@ -664,11 +664,25 @@ static void selem_free(snd_mixer_elem_t *elem)
 	if (simple->selem.id)
 		snd_mixer_selem_id_free(simple->selem.id);
 	/* free db range information */
-	free(simple->str[0].db_info);
-	free(simple->str[1].db_info);
+	snd_tlv_dB_table_free(simple->str[0].db_table);
+	snd_tlv_dB_table_free(simple->str[1].db_table);
 	free(simple);
 }
 
+/* set the raw volume range; the dB table depends on it */
+static void set_str_range(struct selem_str *rec, long min, long max)
+{
+	if (rec->min == min && rec->max == max)
+		return;
+	rec->min = min;
+	rec->max = max;
+	if (rec->db_initialized) {
+		snd_tlv_dB_table_free(rec->db_table);
+		rec->db_table = NULL;
+		rec->db_initialized = 0;
+	}
+}
+
 static int simple_update(snd_mixer_elem_t *melem)
 {
 	selem_none_t *simple;
@@ -874,15 +888,15 @@ static int simple_update(snd_mixer_elem_t *melem)
 
 	simple->selem.caps = caps;
 	simple->str[SM_PLAY].channels = pchannels;
-	if (!simple->str[SM_PLAY].range) {
-		simple->str[SM_PLAY].min = pmin != LONG_MAX ? pmin : 0;
-		simple->str[SM_PLAY].max = pmax != LONG_MIN ? pmax : 0;
-	}
+	if (!simple->str[SM_PLAY].range)
+		set_str_range(&simple->str[SM_PLAY],
+			      pmin != LONG_MAX ? pmin : 0,
+			      pmax != LONG_MIN ? pmax : 0);
 	simple->str[SM_CAPT].channels = cchannels;
-	if (!simple->str[SM_CAPT].range) {
-		simple->str[SM_CAPT].min = cmin != LONG_MAX ? cmin : 0;
-		simple->str[SM_CAPT].max = cmax != LONG_MIN ? cmax : 0;
-	}
+	if (!simple->str[SM_CAPT].range)
+		set_str_range(&simple->str[SM_CAPT],
+			      cmin != LONG_MAX ? cmin : 0,
+			      cmax != LONG_MIN ? cmax : 0);
 	return 0;
 }	   
 
@@ -1064,8 +1078,7 @@ static int set_range_ops(snd_mixer_elem_t *elem, int dir,
 	int err;
 
 	s->str[dir].range = 1;
-	s->str[dir].min = min;
-	s->str[dir].max = max;
+	set_str_range(&s->str[dir], min, max);
 	if ((err = selem_read(elem)) < 0)
 		return err;
 	return 0;
@@ -1090,11 +1103,11 @@ static int convert_to_dB(snd_hctl_elem_t *ctl, struct selem_str *rec,
 {
 	if (init_db_range(ctl, rec) < 0)
 		return -EINVAL;
-	return snd_tlv_convert_to_dB(rec->db_info, rec->min, rec->max,
-				     volume, db_gain);
+	return snd_tlv_dB_table_convert_to_dB(rec->db_table, volume, db_gain);
 }
 
-/* initialize dB range information, reading TLV via hcontrol
+/* initialize dB range information, reading TLV via hcontrol;
+ * the parsed TLV is kept in a dB table for the current raw range
  */
 static int init_db_range(snd_hctl_elem_t *ctl, struct selem_str *rec)
 {
@@ -1102,7 +1115,7 @@ static int init_db_range(snd_hctl_elem_t *ctl, struct selem_str *rec)
 	unsigned int *tlv = NULL;
 	const unsigned int tlv_size = 4096;
 	unsigned int *dbrec;
-	int db_size;
+	int err;
 
 	if (rec->db_init_error)
 		return -EINVAL;
@@ -1118,13 +1131,15 @@ static int init_db_range(snd_hctl_elem_t *ctl, struct selem_str *rec)
 		return -ENOMEM;
 	if (snd_hctl_elem_tlv_read(ctl, tlv, tlv_size) < 0)
 		goto error;
-	db_size = snd_tlv_parse_dB_info(tlv, tlv_size, &dbrec);
-	if (db_size < 0)
+	if (snd_tlv_parse_dB_info(tlv, tlv_size, &dbrec) < 0)
 		goto error;
-	rec->db_info = malloc(db_size);
-	if (!rec->db_info)
+	err = snd_tlv_dB_table_new(&rec->db_table, dbrec, rec->min, rec->max);
+	if (err == -ENOMEM) {
+		free(tlv);
+		return err;
+	}
+	if (err < 0)
 		goto error;
-	memcpy(rec->db_info, dbrec, db_size);
 	free(tlv);
 	rec->db_initialized = 1;
 	return 0;
@@ -1161,7 +1176,7 @@ static int get_dB_range(snd_hctl_elem_t *ctl, struct selem_str *rec,
 	if (init_db_range(ctl, rec) < 0)
 		return -EINVAL;
 
-	return snd_tlv_get_dB_range(rec->db_info, rec->min, rec->max, min, max);
+	return snd_tlv_dB_table_get_range(rec->db_table, min, max);
 }
 	
 static int get_dB_range_ops(snd_mixer_elem_t *elem, int dir,
@@ -1184,8 +1199,8 @@ static int convert_from_dB(snd_hctl_elem_t *ctl, struct selem_str *rec,
 	if (init_db_range(ctl, rec) < 0)
 		return -EINVAL;
 
-	return snd_tlv_convert_from_dB(rec->db_info, rec->min, rec->max,
-				       db_gain, value, xdir);
+	return snd_tlv_dB_table_convert_from_dB(rec->db_table, db_gain,
+						value, xdir);
 }
 
 static int ask_vol_dB_ops(snd_mixer_elem_t *elem,
@@ -3048,6 +3048,15 @@ int snd_pcm_area_silence(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes
 	dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
 	width = snd_pcm_format_physical_width(format);
 	silence = snd_pcm_format_silence_64(format);
+	/*
+	 * Contiguous samples with the all-zero silence (the signed and
+	 * float formats), any alignment and also the packed 24 bit.
+	 */
+	if (dst_area->step == (unsigned int) width && width % 8 == 0 &&
+	    silence == 0 && dst_area->first % 8 == 0) {
+		memset(dst, 0, samples * (width / 8));
+		return 0;
+	}
         /*
          * Iterate copying silent sample for sample data aligned to 64 bit.
          * This is a fast path.
@@ -3311,6 +3320,120 @@ int snd_pcm_area_copy(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes_t
 	return 0;
 }
 
+#ifndef DOC_HIDDEN
+/* max channels handled by the interleave/deinterleave fast path */
+#define AREAS_TRANSPOSE_MAX_CHANNELS	32
+#endif
+
+/* check whether the areas are the channels of one interleaved buffer */
+static int areas_interleaved(const snd_pcm_channel_area_t *areas,
+			     unsigned int channels, int width)
+{
+	unsigned int c;
+
+	if (areas->step != channels * width || areas->first % 8)
+		return 0;
+	for (c = 1; c < channels; c++) {
+		if (areas[c].addr != areas->addr ||
+		    areas[c].step != areas->step ||
+		    areas[c].first != areas->first + c * width)
+			return 0;
+	}
+	return 1;
+}
+
+/* check whether each area is a separate contiguous (planar) buffer */
+static int areas_planar(const snd_pcm_channel_area_t *areas,
+			unsigned int channels, int width)
+{
+	unsigned int c;
+
+	for (c = 0; c < channels; c++) {
+		if (!areas[c].addr ||
+		    areas[c].step != (unsigned int) width ||
+		    areas[c].first % 8)
+			return 0;
+	}
+	return 1;
+}
+
+#define AREAS_TRANSPOSE_LOOP(type) do { \
+	while (frames-- > 0) { \
+		for (c = 0; c < channels; c++) { \
+			*(type *)dst[c] = *(const type *)src[c]; \
+			src[c] += src_step; \
+			dst[c] += dst_step; \
+		} \
+	} \
+} while (0)
+
+/*
+ * Copy between interleaved and planar buffers frame by frame, so that
+ * the interleaved side is walked only once instead of once per channel.
+ */
+static void areas_transpose(const snd_pcm_channel_area_t *dst_areas,
+			    snd_pcm_uframes_t dst_offset,
+			    const snd_pcm_channel_area_t *src_areas,
+			    snd_pcm_uframes_t src_offset,
+			    unsigned int channels, snd_pcm_uframes_t frames,
+			    int width)
+{
+	const char *src[AREAS_TRANSPOSE_MAX_CHANNELS];
+	char *dst[AREAS_TRANSPOSE_MAX_CHANNELS];
+	unsigned int src_step = src_areas->step / 8;
+	unsigned int dst_step = dst_areas->step / 8;
+	unsigned int c;
+
+	for (c = 0; c < channels; c++) {
+		src[c] = snd_pcm_channel_area_addr(&src_areas[c], src_offset);
+		dst[c] = snd_pcm_channel_area_addr(&dst_areas[c], dst_offset);
+	}
+	switch (width) {
+	case 8:
+		AREAS_TRANSPOSE_LOOP(uint8_t);
+		break;
+	case 16:
+		AREAS_TRANSPOSE_LOOP(uint16_t);
+		break;
+	case 24:
+		while (frames-- > 0) {
+			for (c = 0; c < channels; c++) {
+				dst[c][0] = src[c][0];
+				dst[c][1] = src[c][1];
+				dst[c][2] = src[c][2];
+				src[c] += src_step;
+				dst[c] += dst_step;
+			}
+		}
+		break;
+	case 32:
+		AREAS_TRANSPOSE_LOOP(uint32_t);
+		break;
+	case 64:
+		AREAS_TRANSPOSE_LOOP(uint64_t);
+		break;
+	}
+}
+
+/* check whether the interleave/deinterleave fast path can be used */
+static int areas_can_transpose(const snd_pcm_channel_area_t *dst_areas,
+			       const snd_pcm_channel_area_t *src_areas,
+			       unsigned int channels, int width)
+{
+	if (channels < 2 || channels > AREAS_TRANSPOSE_MAX_CHANNELS)
+		return 0;
+	if (width != 8 && width != 16 && width != 24 &&
+	    width != 32 && width != 64)
+		return 0;
+	if (!src_areas->addr || !dst_areas->addr)
+		return 0;
+	if (areas_interleaved(src_areas, channels, width))
+		return areas_planar(dst_areas, channels, width);
+	if (areas_interleaved(dst_areas, channels, width))
+		return areas_planar(src_areas, channels, width);
+	return 0;
+}
+
 /**
  * \brief Copy one or more areas
  * \param dst_areas destination areas specification (one for each channel)
@@ -3337,6 +3460,11 @@ int snd_pcm_areas_copy(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_
 		SNDMSG("invalid frames %ld", frames);
 		return -EINVAL;
 	}
+	if (areas_can_transpose(dst_areas, src_areas, channels, width)) {
+		areas_transpose(dst_areas, dst_offset, src_areas, src_offset,
+				channels, frames, width);
+		return 0;
+	}
 	while (channels > 0) {
 		unsigned int step = src_areas->step;
 		void *src_addr = src_areas->addr;
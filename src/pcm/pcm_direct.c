@@ -315,11 +315,32 @@ static int _snd_send_fd(int sock, void *data, size_t len, int fd)
 	return ret;
 }
 
+/* start the slave timer waking up the mixing server every period;
+ * returns the poll timeout to be used instead if there is no timer
+ */
+static int server_mix_timer(snd_pcm_direct_t *dmix)
+{
+	int timeout;
+
+	if (snd_pcm_direct_initialize_poll_fd(dmix) >= 0 &&
+	    snd_pcm_direct_set_timer_params(dmix) >= 0 &&
+	    snd_timer_start(dmix->timer) >= 0)
+		return -1;
+	if (dmix->timer) {
+		snd_timer_close(dmix->timer);
+		dmix->timer = NULL;
+	}
+	timeout = dmix->shmptr->s.period_time / 1000;
+	return timeout > 0 ? timeout : 1;
+}
+
 static void server_job(snd_pcm_direct_t *dmix)
 {
 	int ret, sck, i;
-	int max = 128, current = 0;
-	struct pollfd pfds[max + 1];
+	int max = 128, current = 0, base = 1;
+	int timeout = 500, mix_timeout = -1;
+	struct timespec now, check = { 0, 0 };
+	struct pollfd pfds[max + 2];
 
 	server_job_dmix = dmix;
 	/* don't allow to be killed */
@@ -344,9 +365,20 @@ static void server_job(snd_pcm_direct_t *dmix)
 	pfds[0].fd = dmix->server_fd;
 	pfds[0].events = POLLIN | POLLERR | POLLHUP;
 
+	if (dmix->server_mix) {
+		mix_timeout = server_mix_timer(dmix);
+		if (mix_timeout < 0) {
+			pfds[1] = dmix->timer_fd;
+			pfds[1].events = POLLIN;
+			base = 2;
+		} else {
+			timeout = mix_timeout;
+		}
+	}
+
 	server_printf("DIRECT SERVER STARTED\n");
 	while (1) {
-		ret = poll(pfds, current + 1, 500);
+		ret = poll(pfds, current + base, timeout);
 		server_printf("DIRECT SERVER: poll ret = %i, revents[0] = 0x%x, errno = %i\n", ret, pfds[0].revents, errno);
 		if (ret < 0) {
 			if (errno == EINTR)
@@ -354,6 +386,25 @@ static void server_job(snd_pcm_direct_t *dmix)
 			/* some error */
 			break;
 		}
+		if (dmix->server_mix) {
+			if (base > 1 && (pfds[1].revents & POLLIN)) {
+				ret--;
+				snd_pcm_direct_clear_timer_queue(dmix);
+				dmix->server_mix(dmix);
+			} else if (base == 1 && ret == 0) {
+				dmix->server_mix(dmix);
+			}
+			/* the mixing wakeups hide the idle timeout, so check
+			 * the users once per second
+			 */
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (now.tv_sec - check.tv_sec >= 1) {
+				check = now;
+				ret = 0;
+			} else if (ret == 0) {
+				continue;
+			}
+		}
 		if (ret == 0 || (pfds[0].revents & (POLLERR | POLLHUP))) {	/* timeout or error? */
 			struct shmid_ds buf;
 			snd_pcm_direct_semaphore_down(dmix, DIRECT_IPC_SEM_CLIENT);
@@ -377,8 +428,8 @@ static void server_job(snd_pcm_direct_t *dmix)
 					close(sck);
 				} else {
 					unsigned char buf = 'A';
-					pfds[current+1].fd = sck;
-					pfds[current+1].events = POLLIN | POLLERR | POLLHUP;
+					pfds[current+base].fd = sck;
+					pfds[current+base].events = POLLIN | POLLERR | POLLHUP;
 					_snd_send_fd(sck, &buf, 1, dmix->hw_fd);
 					server_printf("DIRECT SERVER: fd sent ok\n");
 					current++;
@@ -386,7 +437,7 @@ static void server_job(snd_pcm_direct_t *dmix)
 			}
 		}
 		for (i = 0; i < current && ret > 0; i++) {
-			struct pollfd *pfd = &pfds[i+1];
+			struct pollfd *pfd = &pfds[i+base];
 			unsigned char cmd;
 			server_printf("client %i revents = 0x%x\n", pfd->fd, pfd->revents);
 			if (pfd->revents & (POLLERR | POLLHUP)) {
@@ -402,9 +453,9 @@ static void server_job(snd_pcm_direct_t *dmix)
 				cmd = 0 /*process command */;
 		}
 		for (i = 0; i < current; i++) {
-			if (pfds[i+1].fd < 0) {
+			if (pfds[i+base].fd < 0) {
 				if (i + 1 != max)
-					memcpy(&pfds[i+1], &pfds[i+2], sizeof(struct pollfd) * (max - i - 1));
+					memcpy(&pfds[i+base], &pfds[i+base+1], sizeof(struct pollfd) * (max - i - 1));
 				current--;
 			}
 		}
@@ -523,32 +574,25 @@ int snd_pcm_direct_async(snd_pcm_t *pcm, int sig, pid_t pid)
 /* empty the timer read queue */
 int snd_pcm_direct_clear_timer_queue(snd_pcm_direct_t *dmix)
 {
+	/* large enough to take the whole queue in one read */
+	snd_timer_tread_t rbuf[DIRECT_TIMER_QUEUE];
+	size_t size = dmix->tread ? sizeof(rbuf) :
+		      sizeof(snd_timer_read_t) * DIRECT_TIMER_QUEUE;
+	ssize_t len;
 	int changed = 0;
+
 	if (dmix->timer_need_poll) {
 		while (poll(&dmix->timer_fd, 1, 0) > 0) {
 			changed++;
 			/* we don't need the value */
-			if (dmix->tread) {
-				snd_timer_tread_t rbuf[4];
-				snd_timer_read(dmix->timer, rbuf, sizeof(rbuf));
-			} else {
-				snd_timer_read_t rbuf;
-				snd_timer_read(dmix->timer, &rbuf, sizeof(rbuf));
-			}
+			snd_timer_read(dmix->timer, rbuf, size);
 		}
 	} else {
-		if (dmix->tread) {
-			snd_timer_tread_t rbuf[4];
-			int len;
-			while ((len = snd_timer_read(dmix->timer, rbuf,
-						     sizeof(rbuf))) > 0
-						     && (++changed) &&
-			       len != sizeof(rbuf[0]))
-				;
-		} else {
-			snd_timer_read_t rbuf;
-			while (snd_timer_read(dmix->timer, &rbuf, sizeof(rbuf)) > 0)
-				changed++;
+		/* a short read means the queue is empty now */
+		while ((len = snd_timer_read(dmix->timer, rbuf, size)) > 0) {
+			changed++;
+			if ((size_t)len < size)
+				break;
 		}
 	}
 	return changed;
@@ -1003,9 +1047,36 @@ int snd_pcm_direct_hw_free(snd_pcm_t *pcm ATTRIBUTE_UNUSED)
 
 int snd_pcm_direct_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 {
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	snd_pcm_uframes_t spare;
+	unsigned int ticks = 1, late;
+
 	if (params->tstamp_type != pcm->tstamp_type)
 		return -EINVAL;
 
+	/* The timer counts slave periods; let it skip the periods which
+	 * cannot bring avail to avail_min, so the client is not woken up
+	 * just to find out that it has nothing to do.
+	 *
+	 * The ticks run in a fixed phase from the start of the timer, not
+	 * from the last write of the client, so the wakeup may come up to
+	 * ticks - 1 periods after avail reached avail_min.  Keep that delay
+	 * within half of the room left in the buffer above avail_min.
+	 *
+	 * The count is applied by the next prepare; setting the timer
+	 * parameters stops a running timer.
+	 */
+	if (dmix->slave_period_size &&
+	    params->avail_min > dmix->slave_period_size) {
+		ticks = params->avail_min / dmix->slave_period_size;
+		spare = pcm->buffer_size > params->avail_min ?
+			pcm->buffer_size - params->avail_min : 0;
+		late = spare / 2 / dmix->slave_period_size;
+		if (ticks > late + 1)
+			ticks = late + 1;
+	}
+	dmix->timer_ticks = ticks;
+
 	/* values are cached in the pcm structure */
 	return 0;
 }
@@ -1905,6 +1976,7 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 #endif
 	rec->hw_ptr_alignment = SND_PCM_HW_PTR_ALIGNMENT_AUTO;
 	rec->tstamp_type = -1;
+	rec->mix_server = 0;
 
 	/* read defaults */
 	if (snd_config_search(root, "defaults.pcm.dmix_max_periods", &n) >= 0) {
@@ -2068,6 +2140,13 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			rec->direct_memory_access = err;
 			continue;
 		}
+		if (strcmp(id, "mix_server") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->mix_server = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
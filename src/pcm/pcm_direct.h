@@ -28,6 +28,8 @@
 #define SEC_TO_MS               1000
 /* slave_period time for low latency requirements in ms */
 #define LOW_LATENCY_PERIOD_TIME 10
+/* timer events taken by one read when clearing the timer queue */
+#define DIRECT_TIMER_QUEUE      32
 
 
 typedef void (mix_areas_t)(unsigned int size,
@@ -124,9 +126,30 @@ typedef struct {
 		struct {
 			unsigned long long chn_mask;
 		} dshare;
+		struct {
+			unsigned int mix_server;	/* clients mixed by server */
+		} dmix;
 	} u;
 } snd_pcm_direct_share_t;
 
+/* dmix mixing server: per-client rings, shared with the server */
+#define DMIX_MIX_CLIENTS	16
+
+typedef struct {
+	pid_t pid;				/* owner, 0 = free slot */
+	unsigned int pad;
+	unsigned long long start_ptr;		/* first valid slave position */
+	unsigned long long appl_ptr;		/* end of written slave frames */
+} snd_pcm_dmix_mix_slot_t;
+
+typedef struct {
+	unsigned long long mixed_ptr;		/* end of mixed slave frames */
+	unsigned int ring_size;			/* ring size in frames */
+	unsigned int frame_bytes;		/* slave frame size */
+	snd_pcm_dmix_mix_slot_t slot[DMIX_MIX_CLIENTS];
+	/* followed by DMIX_MIX_CLIENTS rings in the slave format */
+} snd_pcm_dmix_mix_t;
+
 typedef struct snd_pcm_direct snd_pcm_direct_t;
 
 struct snd_pcm_direct {
@@ -187,12 +210,17 @@ struct snd_pcm_direct {
 			mix_areas_24_t *remix_areas_24;
 			mix_areas_u8_t *remix_areas_u8;
 			unsigned int use_sem;
+			int shmid_mix;			/* IPC mixing server area identification */
+			snd_pcm_dmix_mix_t *mix;	/* mixing server area */
+			int mix_slot;			/* own ring, -1 = mix locally */
+			signed int *mix_sum;		/* server: sum of one period */
 		} dmix;
 		struct {
 			unsigned long long chn_mask;
 		} dshare;
 	} u;
 	void (*server_free)(snd_pcm_direct_t *direct);
+	void (*server_mix)(snd_pcm_direct_t *direct);	/* server: called every period */
 };
 
 /* make local functions really local */
@@ -360,6 +388,7 @@ struct snd_pcm_direct_open_conf {
 	int direct_memory_access;
 	snd_pcm_direct_hw_ptr_alignment_t hw_ptr_alignment;
 	int tstamp_type;
+	int mix_server;
 	snd_config_t *slave;
 	snd_config_t *bindings;
 };
@@ -127,11 +127,274 @@ static int shm_sum_discard(snd_pcm_direct_t *dmix)
 	return ret;
 }
 
+/*
+ *  mixing server area: one ring per client, summed by the server
+ */
+static int shm_mix_discard(snd_pcm_direct_t *dmix);
+
+static size_t mix_ring_bytes(snd_pcm_direct_t *dmix)
+{
+	return (size_t)dmix->shmptr->s.buffer_size *
+		(dmix->shmptr->s.frame_bits / 8);
+}
+
+static unsigned char *mix_ring(snd_pcm_direct_t *dmix, int slot)
+{
+	return (unsigned char *)(dmix->u.dmix.mix + 1) +
+		slot * mix_ring_bytes(dmix);
+}
+
+static int shm_mix_create_or_connect(snd_pcm_direct_t *dmix)
+{
+	struct shmid_ds buf;
+	int err;
+	size_t size;
+
+	size = sizeof(snd_pcm_dmix_mix_t) +
+	       DMIX_MIX_CLIENTS * mix_ring_bytes(dmix);
+	dmix->u.dmix.shmid_mix = shmget(dmix->ipc_key + 2, size,
+					IPC_CREAT | dmix->ipc_perm);
+	if (dmix->u.dmix.shmid_mix < 0)
+		return -errno;
+	if (dmix->ipc_gid >= 0 &&
+	    shmctl(dmix->u.dmix.shmid_mix, IPC_STAT, &buf) == 0) {
+		buf.shm_perm.gid = dmix->ipc_gid;
+		shmctl(dmix->u.dmix.shmid_mix, IPC_SET, &buf);
+	}
+	dmix->u.dmix.mix = shmat(dmix->u.dmix.shmid_mix, 0, 0);
+	if (dmix->u.dmix.mix == (void *) -1) {
+		err = -errno;
+		shm_mix_discard(dmix);
+		return err;
+	}
+	mlock(dmix->u.dmix.mix, size);
+	if (!dmix->u.dmix.mix->ring_size) {
+		/* a new segment (zeroed by the system) */
+		dmix->u.dmix.mix->frame_bytes = dmix->shmptr->s.frame_bits / 8;
+		dmix->u.dmix.mix->ring_size = dmix->shmptr->s.buffer_size;
+	}
+	return 0;
+}
+
+static int shm_mix_discard(snd_pcm_direct_t *dmix)
+{
+	struct shmid_ds buf;
+	int ret = 0;
+
+	if (dmix->u.dmix.shmid_mix < 0)
+		return -EINVAL;
+	if (dmix->u.dmix.mix != (void *) -1 && dmix->u.dmix.mix &&
+	    shmdt(dmix->u.dmix.mix) < 0)
+		return -errno;
+	dmix->u.dmix.mix = NULL;
+	if (shmctl(dmix->u.dmix.shmid_mix, IPC_STAT, &buf) < 0)
+		return -errno;
+	if (buf.shm_nattch == 0) {	/* we're the last user, destroy the segment */
+		if (shmctl(dmix->u.dmix.shmid_mix, IPC_RMID, NULL) < 0)
+			return -errno;
+		ret = 1;
+	}
+	dmix->u.dmix.shmid_mix = -1;
+	return ret;
+}
+
+/* take a free ring; called with the semaphore held */
+static int mix_slot_acquire(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_dmix_mix_t *mix = dmix->u.dmix.mix;
+	int i;
+
+	for (i = 0; i < DMIX_MIX_CLIENTS; i++) {
+		/* a live client of another user fails with EPERM */
+		if (mix->slot[i].pid &&
+		    (kill(mix->slot[i].pid, 0) == 0 || errno != ESRCH))
+			continue;
+		memset(mix_ring(dmix, i), 0, mix_ring_bytes(dmix));
+		mix->slot[i].start_ptr = mix->slot[i].appl_ptr = 0;
+		__atomic_store_n(&mix->slot[i].pid, getpid(), __ATOMIC_RELEASE);
+		dmix->u.dmix.mix_slot = i;
+		return 0;
+	}
+	return -EBUSY;
+}
+
+static void mix_slot_release(snd_pcm_direct_t *dmix)
+{
+	if (dmix->u.dmix.mix_slot < 0)
+		return;
+	__atomic_store_n(&dmix->u.dmix.mix->slot[dmix->u.dmix.mix_slot].pid, 0,
+			 __ATOMIC_RELEASE);
+	dmix->u.dmix.mix_slot = -1;
+}
+
+/* the ring is valid from the current slave_appl_ptr on */
+static void mix_slot_restart(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_dmix_mix_slot_t *slot;
+
+	if (dmix->u.dmix.mix_slot < 0)
+		return;
+	slot = &dmix->u.dmix.mix->slot[dmix->u.dmix.mix_slot];
+	__atomic_store_n(&slot->appl_ptr, dmix->slave_appl_ptr, __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->start_ptr, dmix->slave_appl_ptr, __ATOMIC_RELEASE);
+}
+
+/* client side: store the frames to own ring instead of mixing them */
+static void mix_areas_ring(snd_pcm_direct_t *dmix,
+			   const snd_pcm_channel_area_t *src_areas,
+			   snd_pcm_uframes_t src_ofs,
+			   snd_pcm_uframes_t dst_ofs,
+			   snd_pcm_uframes_t size)
+{
+	unsigned int frame_bytes = dmix->u.dmix.mix->frame_bytes;
+	unsigned char *ring = mix_ring(dmix, dmix->u.dmix.mix_slot);
+	snd_pcm_channel_area_t dst;
+	unsigned int chn, dchn;
+
+	if (dmix->interleaved) {
+		memcpy(ring + dst_ofs * frame_bytes,
+		       (unsigned char *)src_areas[0].addr + src_ofs * frame_bytes,
+		       size * frame_bytes);
+		return;
+	}
+	for (chn = 0; chn < dmix->channels; chn++) {
+		dchn = dmix->bindings ? dmix->bindings[chn] : chn;
+		if (dchn >= dmix->shmptr->s.channels)
+			continue;
+		dst.addr = ring;
+		dst.first = dchn * dmix->shmptr->s.sample_bits;
+		dst.step = frame_bytes * 8;
+		snd_pcm_area_copy(&dst, dst_ofs, &src_areas[chn], src_ofs,
+				  size, dmix->shmptr->s.format);
+	}
+}
+
+/* distance of slave positions, signed */
+static long long mix_ptr_diff(snd_pcm_direct_t *dmix,
+			      unsigned long long a, unsigned long long b)
+{
+	long long diff = (long long)(a - b) % (long long)dmix->slave_boundary;
+
+	if (diff > (long long)(dmix->slave_boundary / 2))
+		diff -= dmix->slave_boundary;
+	else if (diff < -(long long)(dmix->slave_boundary / 2))
+		diff += dmix->slave_boundary;
+	return diff;
+}
+
+/*
+ * Server side: sum the rings of all clients for the period following the
+ * one being played, and store it to the slave buffer in one pass.
+ */
+static void dmix_server_mix(snd_pcm_direct_t *dmix)
+{
+	const snd_pcm_channel_area_t *dst_areas;
+	snd_pcm_dmix_mix_t *mix;
+	snd_pcm_dmix_mix_slot_t *slot;
+	snd_pcm_uframes_t period = dmix->slave_period_size;
+	snd_pcm_uframes_t target, pos, f;
+	unsigned int channels = dmix->shmptr->s.channels;
+	unsigned int c, frame_bytes, is16;
+	long long lo, hi, start, end;
+	signed int *sum;
+	unsigned char *ring, *dst;
+	int i;
+
+	if (!dmix->u.dmix.mix && shm_mix_create_or_connect(dmix) < 0)
+		return;
+	mix = dmix->u.dmix.mix;
+	if (!dmix->u.dmix.mix_sum) {
+		dmix->u.dmix.mix_sum = malloc(period * channels * sizeof(*sum));
+		if (!dmix->u.dmix.mix_sum)
+			return;
+	}
+	sum = dmix->u.dmix.mix_sum;
+	frame_bytes = mix->frame_bytes;
+	is16 = dmix->shmptr->s.format == SND_PCM_FORMAT_S16;
+
+	snd_pcm_hwsync(dmix->spcm);
+	target = *dmix->spcm->hw.ptr;
+	target -= target % period;
+	target = (target + period) % dmix->slave_boundary;
+	if (mix->mixed_ptr == (target + period) % dmix->slave_boundary)
+		return;		/* already done */
+
+	memset(sum, 0, period * channels * sizeof(*sum));
+	for (i = 0; i < DMIX_MIX_CLIENTS; i++) {
+		slot = &mix->slot[i];
+		if (!__atomic_load_n(&slot->pid, __ATOMIC_ACQUIRE))
+			continue;
+		end = mix_ptr_diff(dmix, __atomic_load_n(&slot->appl_ptr, __ATOMIC_ACQUIRE), target);
+		start = mix_ptr_diff(dmix, __atomic_load_n(&slot->start_ptr, __ATOMIC_ACQUIRE), target);
+		/* older frames are overwritten in the ring */
+		if (start < end - (long long)mix->ring_size)
+			start = end - mix->ring_size;
+		lo = start > 0 ? start : 0;
+		hi = end < (long long)period ? end : (long long)period;
+		if (lo >= hi)
+			continue;
+		ring = mix_ring(dmix, i);
+		for (f = lo; f < (snd_pcm_uframes_t)hi; f++) {
+			pos = (target + f) % mix->ring_size;
+			if (is16) {
+				const int16_t *s = (const int16_t *)(ring + pos * frame_bytes);
+				for (c = 0; c < channels; c++)
+					sum[f * channels + c] += s[c];
+			} else {
+				const int32_t *s = (const int32_t *)(ring + pos * frame_bytes);
+				for (c = 0; c < channels; c++)
+					sum[f * channels + c] += s[c] >> 8;
+			}
+		}
+	}
+
+	dst_areas = snd_pcm_mmap_areas(dmix->spcm);
+	for (f = 0; f < period; f++) {
+		pos = (target + f) % dmix->slave_buffer_size;
+		for (c = 0; c < channels; c++) {
+			signed int v = sum[f * channels + c];
+			dst = snd_pcm_channel_area_addr(&dst_areas[c], pos);
+			if (is16) {
+				if (v > 0x7fff)
+					v = 0x7fff;
+				else if (v < -0x8000)
+					v = -0x8000;
+				*(int16_t *)dst = v;
+			} else {
+				if (v > 0x7fffff)
+					v = 0x7fffff;
+				else if (v < -0x800000)
+					v = -0x800000;
+				*(int32_t *)dst = (int32_t)((uint32_t)v << 8);
+			}
+		}
+	}
+	__atomic_store_n(&mix->mixed_ptr, (target + period) % dmix->slave_boundary,
+			 __ATOMIC_RELEASE);
+}
+
+/* mix server: slave frames written by this client, not mixed yet */
+static snd_pcm_uframes_t dmix_server_unmixed(snd_pcm_direct_t *dmix)
+{
+	long long diff;
+
+	diff = mix_ptr_diff(dmix, dmix->slave_appl_ptr,
+			    __atomic_load_n(&dmix->u.dmix.mix->mixed_ptr,
+					    __ATOMIC_ACQUIRE));
+	return diff > 0 ? diff : 0;
+}
+
 static void dmix_server_free(snd_pcm_direct_t *dmix)
 {
 	/* remove the memory region */
 	shm_sum_create_or_connect(dmix);
 	shm_sum_discard(dmix);
+	if (dmix->shmptr->u.dmix.mix_server) {
+		if (!dmix->u.dmix.mix)
+			shm_mix_create_or_connect(dmix);
+		shm_mix_discard(dmix);
+		free(dmix->u.dmix.mix_sum);
+	}
 }
 
 /*
@@ -373,6 +636,27 @@ static void snd_pcm_dmix_sync_area(snd_pcm_t *pcm)
 	slave_appl_ptr = dmix->slave_appl_ptr % dmix->slave_buffer_size;
 	dmix->slave_appl_ptr += size;
 	dmix->slave_appl_ptr %= dmix->slave_boundary;
+	if (dmix->u.dmix.mix_slot >= 0) {
+		/* the server mixes it; no locking needed */
+		for (;;) {
+			transfer = size;
+			if (appl_ptr + transfer > pcm->buffer_size)
+				transfer = pcm->buffer_size - appl_ptr;
+			if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
+				transfer = dmix->slave_buffer_size - slave_appl_ptr;
+			mix_areas_ring(dmix, src_areas, appl_ptr, slave_appl_ptr, transfer);
+			size -= transfer;
+			if (! size)
+				break;
+			slave_appl_ptr += transfer;
+			slave_appl_ptr %= dmix->slave_buffer_size;
+			appl_ptr += transfer;
+			appl_ptr %= pcm->buffer_size;
+		}
+		__atomic_store_n(&dmix->u.dmix.mix->slot[dmix->u.dmix.mix_slot].appl_ptr,
+				 dmix->slave_appl_ptr, __ATOMIC_RELEASE);
+		return;
+	}
 	dmix_down_sem(dmix);
 	for (;;) {
 		transfer = size;
@@ -568,6 +852,7 @@ static int snd_pcm_dmix_reset(snd_pcm_t *pcm)
 	dmix->appl_ptr = dmix->last_appl_ptr = dmix->hw_ptr;
 	dmix->slave_appl_ptr = dmix->slave_hw_ptr = *dmix->spcm->hw.ptr;
 	snd_pcm_direct_reset_slave_ptr(pcm, dmix);
+	mix_slot_restart(dmix);
 	return 0;
 }
 
@@ -578,6 +863,7 @@ static int snd_pcm_dmix_start_timer(snd_pcm_t *pcm, snd_pcm_direct_t *dmix)
 	snd_pcm_hwsync(dmix->spcm);
 	dmix->slave_appl_ptr = dmix->slave_hw_ptr = *dmix->spcm->hw.ptr;
 	snd_pcm_direct_reset_slave_ptr(pcm, dmix);
+	mix_slot_restart(dmix);
 	err = snd_timer_start(dmix->timer);
 	if (err < 0)
 		return err;
@@ -701,7 +987,19 @@ static int snd_pcm_dmix_pause(snd_pcm_t *pcm ATTRIBUTE_UNUSED, int enable ATTRIB
 
 static snd_pcm_sframes_t snd_pcm_dmix_rewindable(snd_pcm_t *pcm)
 {
-	return snd_pcm_mmap_playback_hw_rewindable(pcm);
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	snd_pcm_sframes_t avail, size;
+
+	avail = snd_pcm_mmap_playback_hw_rewindable(pcm);
+	if (dmix->u.dmix.mix_slot < 0 || avail <= 0)
+		return avail;
+	/* the frames already mixed by the server can't be taken back */
+	if (dmix->last_appl_ptr <= dmix->appl_ptr)
+		size = dmix->appl_ptr - dmix->last_appl_ptr;
+	else
+		size = dmix->appl_ptr + (pcm->boundary - dmix->last_appl_ptr);
+	size += dmix_server_unmixed(dmix);
+	return size < avail ? size : avail;
 }
 
 static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
@@ -726,7 +1024,7 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 	 * So they can be remixed.
 	 */
 
-	if (dmix->last_appl_ptr < dmix->appl_ptr)
+	if (dmix->last_appl_ptr <= dmix->appl_ptr)
 		size = dmix->appl_ptr - dmix->last_appl_ptr;
 	else
 		size = dmix->appl_ptr + (pcm->boundary - dmix->last_appl_ptr);
@@ -753,6 +1051,12 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 		slave_size = dmix->slave_appl_ptr + (pcm->boundary - dmix->slave_hw_ptr);
 	if (slave_size < size)
 		size = slave_size;
+	/* the server has mixed the frames up to mixed_ptr already */
+	if (dmix->u.dmix.mix_slot >= 0) {
+		slave_size = dmix_server_unmixed(dmix);
+		if (slave_size < size)
+			size = slave_size;
+	}
 
 	/* frames which should be remixed will be saved
 	 * to also backward the appl pointer on success
@@ -768,6 +1072,14 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 	dmix->slave_appl_ptr -= size;
 	dmix->slave_appl_ptr %= dmix->slave_boundary;
 	slave_appl_ptr = dmix->slave_appl_ptr % dmix->slave_buffer_size;
+	if (dmix->u.dmix.mix_slot >= 0) {
+		/* the frames not mixed yet by the server are simply dropped;
+		 * the new ones are mixed when written again
+		 */
+		__atomic_store_n(&dmix->u.dmix.mix->slot[dmix->u.dmix.mix_slot].appl_ptr,
+				 dmix->slave_appl_ptr, __ATOMIC_RELEASE);
+		goto _backward;
+	}
 	dmix_down_sem(dmix);
 	for (;;) {
 		transfer = size;
@@ -786,6 +1098,7 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 	}
 	dmix_up_sem(dmix);
 
+ _backward:
 	snd_pcm_mmap_appl_backward(pcm, frames_to_remix);
 	result += frames_to_remix;
 	/* At this point last_appl_ptr and appl_ptr has to indicate the
@@ -834,6 +1147,10 @@ static int snd_pcm_dmix_close(snd_pcm_t *pcm)
  	if (dmix->client)
  		snd_pcm_direct_client_discard(dmix);
  	shm_sum_discard(dmix);
+	if (dmix->u.dmix.shmid_mix >= 0) {
+		mix_slot_release(dmix);
+		shm_mix_discard(dmix);
+	}
 	if (snd_pcm_direct_shm_discard(dmix)) {
 		if (snd_pcm_direct_semaphore_discard(dmix))
 			snd_pcm_direct_semaphore_final(dmix, DIRECT_IPC_SEM_CLIENT);
@@ -1045,6 +1362,8 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 	dmix->tstamp_type = opts->tstamp_type;
 	dmix->semid = -1;
 	dmix->shmid = -1;
+	dmix->u.dmix.shmid_mix = -1;
+	dmix->u.dmix.mix_slot = -1;
 
 	ret = snd_pcm_new(&pcm, dmix->type = SND_PCM_TYPE_DMIX, name, stream, mode);
 	if (ret < 0)
@@ -1109,7 +1428,15 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 
 		dmix->spcm = spcm;
 
-		if (dmix->shmptr->use_server) {
+		/* the server mixes the native 16 and 32 bit formats */
+		if (opts->mix_server &&
+		    (dmix->shmptr->s.format == SND_PCM_FORMAT_S16 ||
+		     dmix->shmptr->s.format == SND_PCM_FORMAT_S32)) {
+			dmix->shmptr->u.dmix.mix_server = 1;
+			dmix->server_mix = dmix_server_mix;
+		}
+
+		if (dmix->shmptr->use_server || dmix->shmptr->u.dmix.mix_server) {
 			dmix->server_free = dmix_server_free;
 		
 			ret = snd_pcm_direct_server_create(dmix);
@@ -1173,6 +1500,19 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 		goto _err;
 	}
 
+	if (dmix->shmptr->u.dmix.mix_server) {
+		ret = shm_mix_create_or_connect(dmix);
+		if (ret < 0) {
+			SNDERR("unable to initialize mixing server area");
+			goto _err;
+		}
+		ret = mix_slot_acquire(dmix);
+		if (ret < 0) {
+			SNDERR("too many clients of mixing server");
+			goto _err;
+		}
+	}
+
 	ret = snd_pcm_direct_initialize_poll_fd(dmix);
 	if (ret < 0) {
 		SNDERR("unable to initialize poll_fd");
@@ -1207,6 +1547,10 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 		snd_pcm_close(spcm);
 	if (dmix->u.dmix.shmid_sum >= 0)
 		shm_sum_discard(dmix);
+	if (dmix->u.dmix.shmid_mix >= 0) {
+		mix_slot_release(dmix);
+		shm_mix_discard(dmix);
+	}
 	if ((dmix->shmid >= 0) && (snd_pcm_direct_shm_discard(dmix))) {
 		if (snd_pcm_direct_semaphore_discard(dmix))
 			snd_pcm_direct_semaphore_final(dmix, DIRECT_IPC_SEM_CLIENT);
@@ -1266,6 +1610,7 @@ pcm.name {
 		N INT		# maps slave channel to client channel N
 	}
 	slowptr BOOL		# slow but more precise pointer updates
+	mix_server BOOL		# mix all clients in a server process
 }
 \endcode
 
@@ -1298,6 +1643,18 @@ the possible configurations:
   case of a dependency to another sound device (e.g. forwarding of
   microphone to speaker). Else "no" will be chosen.
 
+When <code>mix_server</code> is set true, the clients do not mix into
+the slave buffer themselves.  Each client stores its frames to its own
+ring in the shared memory and the server process sums the rings of all
+clients once per slave period, right ahead of the hardware pointer.
+This removes the semaphore and the per-client atomic mixing from the
+write path.  Frames written less than one slave period ahead of the
+hardware pointer are not played.  The server mixes a single period per
+wakeup and does not catch up on a period skipped by a late wakeup; that
+period is not played either.  In this mode, a rewind stops at the frames
+already mixed by the server.  Only the \c S16 and \c S32 native
+formats are supported; with other formats the option is ignored.
+
 Note that the dmix plugin itself supports only a single configuration.
 That is, it supports only the fixed rate (default 48000), format
 (\c S16), channels (2), and period_time (125000).
@@ -30,6 +30,14 @@
 #include "pcm_ioplug.h"
 #include "pcm_ext_parm.h"
 #include "pcm_generic.h"
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC	0x0001U
+#endif
 
 #ifndef PIC
 /* entry for static linking */
@@ -38,6 +46,32 @@ const char *_snd_module_pcm_ioplug = "";
 
 #ifndef DOC_HIDDEN
 
+/* control block of the ring buffer, placed at the head of the shared area;
+ * hw and reset_ack are written only by the plugin side, appl, reset_hw
+ * and reset_seq only by the PCM side
+ */
+struct ioplug_ring_ctrl {
+	snd_pcm_uframes_t hw;
+	snd_pcm_uframes_t appl;
+	snd_pcm_uframes_t boundary;
+	snd_pcm_uframes_t buffer_size;
+	unsigned int frame_bytes;
+	int seq;		/* futex word, bumped at each pointer update */
+	int waiters;
+	snd_pcm_uframes_t reset_hw;	/* playback: hw after the reset */
+	int reset_seq;		/* bumped at each playback reset */
+	int reset_ack;		/* last reset_seq applied by the plugin side */
+};
+
+typedef struct {
+	int fd;
+	void *ptr;
+	size_t size;
+	struct ioplug_ring_ctrl *ctrl;
+	char *data;
+	snd_pcm_channel_area_t *areas;
+} ioplug_ring_t;
+
 /* hw_params */
 typedef struct snd_pcm_ioplug_priv {
 	snd_pcm_ioplug_t *data;
@@ -45,6 +79,7 @@ typedef struct snd_pcm_ioplug_priv {
 	snd_pcm_uframes_t last_hw;
 	snd_pcm_uframes_t avail_max;
 	snd_htimestamp_t trigger_tstamp;
+	ioplug_ring_t ring;
 } ioplug_priv_t;
 
 static int snd_pcm_ioplug_drop(snd_pcm_t *pcm);
@@ -52,6 +87,166 @@ static int snd_pcm_ioplug_poll_descriptors_count(snd_pcm_t *pcm);
 static int snd_pcm_ioplug_poll_descriptors(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int space);
 static int snd_pcm_ioplug_poll_revents(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int nfds, unsigned short *revents);
 
+static int ioplug_ring_mode(ioplug_priv_t *io)
+{
+	return io->data->flags & SND_PCM_IOPLUG_FLAG_RING;
+}
+
+static void ioplug_ring_wake(struct ioplug_ring_ctrl *ctrl)
+{
+	__atomic_add_fetch(&ctrl->seq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ctrl->waiters, __ATOMIC_SEQ_CST))
+		syscall(SYS_futex, &ctrl->seq, FUTEX_WAKE, INT_MAX,
+			NULL, NULL, 0);
+}
+
+static void ioplug_ring_free(ioplug_priv_t *io)
+{
+	ioplug_ring_t *ring = &io->ring;
+
+	if (ring->ptr)
+		munmap(ring->ptr, ring->size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	free(ring->areas);
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+}
+
+/* allocate the shared ring; memfd backed when available so that
+ * the storage can be passed to another process
+ */
+static int ioplug_ring_alloc(snd_pcm_t *pcm, snd_pcm_uframes_t boundary)
+{
+	ioplug_priv_t *io = pcm->private_data;
+	ioplug_ring_t *ring = &io->ring;
+	size_t page = sysconf(_SC_PAGE_SIZE);
+	size_t ctrl_size = (sizeof(*ring->ctrl) + page - 1) / page * page;
+	unsigned int frame_bytes = pcm->frame_bits / 8;
+	unsigned int c;
+
+	ioplug_ring_free(io);
+	ring->size = ctrl_size + pcm->buffer_size * frame_bytes;
+	ring->size = (ring->size + page - 1) / page * page;
+#ifdef SYS_memfd_create
+	ring->fd = syscall(SYS_memfd_create, "alsa-ioplug-ring", MFD_CLOEXEC);
+	if (ring->fd >= 0 && ftruncate(ring->fd, ring->size) < 0) {
+		close(ring->fd);
+		ring->fd = -1;
+	}
+#endif
+	if (ring->fd >= 0)
+		ring->ptr = mmap(NULL, ring->size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, ring->fd, 0);
+	else
+		ring->ptr = mmap(NULL, ring->size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ring->ptr == MAP_FAILED) {
+		ring->ptr = NULL;
+		ioplug_ring_free(io);
+		return -ENOMEM;
+	}
+	ring->areas = calloc(pcm->channels, sizeof(*ring->areas));
+	if (!ring->areas) {
+		ioplug_ring_free(io);
+		return -ENOMEM;
+	}
+	ring->ctrl = ring->ptr;
+	ring->data = (char *)ring->ptr + ctrl_size;
+	ring->ctrl->boundary = boundary;
+	ring->ctrl->buffer_size = pcm->buffer_size;
+	ring->ctrl->frame_bytes = frame_bytes;
+	for (c = 0; c < pcm->channels; c++) {
+		ring->areas[c].addr = ring->data;
+		ring->areas[c].first = c * pcm->sample_bits;
+		ring->areas[c].step = pcm->frame_bits;
+	}
+	return 0;
+}
+
+/*
+ * Drop the queued data at prepare/reset.  The I/O thread may be using
+ * the ring, so each side moves only its own pointer: the capture data
+ * is dropped by moving appl to hw here, the playback data is dropped by
+ * the plugin side, which moves hw to reset_hw when it sees the new
+ * reset_seq (see ioplug_ring_sync_reset()).
+ */
+static void ioplug_ring_reset(snd_pcm_t *pcm)
+{
+	ioplug_priv_t *io = pcm->private_data;
+	struct ioplug_ring_ctrl *ctrl = io->ring.ctrl;
+	snd_pcm_uframes_t hw;
+
+	if (!ctrl)
+		return;
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
+		hw = ctrl->appl;
+		ctrl->reset_hw = hw;
+		__atomic_add_fetch(&ctrl->reset_seq, 1, __ATOMIC_RELEASE);
+	} else {
+		hw = __atomic_load_n(&ctrl->hw, __ATOMIC_ACQUIRE);
+		__atomic_store_n(&ctrl->appl, hw, __ATOMIC_RELEASE);
+	}
+	io->last_hw = hw;
+	ioplug_ring_wake(ctrl);
+}
+
+/* the hw pointer seen by the PCM side; a reset not yet applied by the
+ * plugin side counts as done
+ */
+static snd_pcm_uframes_t ioplug_ring_hw(struct ioplug_ring_ctrl *ctrl)
+{
+	if (__atomic_load_n(&ctrl->reset_ack, __ATOMIC_ACQUIRE) !=
+	    ctrl->reset_seq)
+		return ctrl->reset_hw;
+	return __atomic_load_n(&ctrl->hw, __ATOMIC_ACQUIRE);
+}
+
+/* copy the application data from/to the ring, or fill silence/skip
+ * the data when areas is NULL; called in lock
+ */
+static snd_pcm_sframes_t ioplug_ring_transfer(snd_pcm_t *pcm,
+					      const snd_pcm_channel_area_t *areas,
+					      snd_pcm_uframes_t offset,
+					      snd_pcm_uframes_t size)
+{
+	ioplug_priv_t *io = pcm->private_data;
+	ioplug_ring_t *ring = &io->ring;
+	snd_pcm_uframes_t appl, pos, xfer, left = size;
+
+	if (!ring->ctrl)
+		return -EBADFD;
+	appl = ring->ctrl->appl;
+	pos = appl % pcm->buffer_size;
+	while (left > 0) {
+		xfer = pcm->buffer_size - pos;
+		if (xfer > left)
+			xfer = left;
+		if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
+			if (areas)
+				snd_pcm_areas_copy(ring->areas, pos, areas,
+						   offset, pcm->channels, xfer,
+						   pcm->format);
+			else
+				snd_pcm_areas_silence(ring->areas, pos,
+						      pcm->channels, xfer,
+						      pcm->format);
+		} else if (areas) {
+			snd_pcm_areas_copy(areas, offset, ring->areas, pos,
+					   pcm->channels, xfer, pcm->format);
+		}
+		offset += xfer;
+		left -= xfer;
+		pos = 0;
+	}
+	appl += size;
+	if (appl >= pcm->boundary)
+		appl -= pcm->boundary;
+	__atomic_store_n(&ring->ctrl->appl, appl, __ATOMIC_RELEASE);
+	ioplug_ring_wake(ring->ctrl);
+	return size;
+}
+
 /* update the hw pointer */
 /* called in lock */
 static void snd_pcm_ioplug_hw_ptr_update(snd_pcm_t *pcm)
@@ -59,7 +254,10 @@ static void snd_pcm_ioplug_hw_ptr_update(snd_pcm_t *pcm)
 	ioplug_priv_t *io = pcm->private_data;
 	snd_pcm_sframes_t hw;
 
-	hw = io->data->callback->pointer(io->data);
+	if (ioplug_ring_mode(io))
+		hw = io->ring.ctrl ? ioplug_ring_hw(io->ring.ctrl) : 0;
+	else
+		hw = io->data->callback->pointer(io->data);
 	if (hw >= 0) {
 		snd_pcm_uframes_t delta;
 		snd_pcm_uframes_t avail;
@@ -68,7 +266,8 @@ static void snd_pcm_ioplug_hw_ptr_update(snd_pcm_t *pcm)
 			delta = hw - io->last_hw;
 		else {
 			const snd_pcm_uframes_t wrap_point =
-				(io->data->flags & SND_PCM_IOPLUG_FLAG_BOUNDARY_WA) ?
+				(io->data->flags & (SND_PCM_IOPLUG_FLAG_BOUNDARY_WA |
+						    SND_PCM_IOPLUG_FLAG_RING)) ?
 					pcm->boundary : pcm->buffer_size;
 			delta = wrap_point + hw - io->last_hw;
 		}
@@ -154,6 +353,7 @@ static int snd_pcm_ioplug_reset(snd_pcm_t *pcm)
 	io->data->hw_ptr = 0;
 	io->last_hw = 0;
 	io->avail_max = 0;
+	ioplug_ring_reset(pcm);
 	return 0;
 }
 
@@ -290,6 +490,17 @@ static int snd_pcm_ioplug_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 			return err;
 		change |= err;
 	}
+	/* the ring transport copies in read/write calls only */
+	if (ioplug_ring_mode(io)) {
+		snd_pcm_access_mask_t mask = { 0 };
+		snd_pcm_access_mask_set(&mask, SND_PCM_ACCESS_RW_INTERLEAVED);
+		snd_pcm_access_mask_set(&mask, SND_PCM_ACCESS_RW_NONINTERLEAVED);
+		err = _snd_pcm_hw_param_set_mask(params, SND_PCM_HW_PARAM_ACCESS,
+						 &mask);
+		if (err < 0)
+			return err;
+		change |= err;
+	}
 	/* channels, rate */
 	for (; i <= SND_PCM_IOPLUG_HW_RATE; i++) {
 		err = snd_ext_parm_interval_refine(hw_param_interval(params, hw_params_type[i]),
@@ -449,10 +660,13 @@ static int snd_pcm_ioplug_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 static int snd_pcm_ioplug_hw_free(snd_pcm_t *pcm)
 {
 	ioplug_priv_t *io = pcm->private_data;
+	int err = 0;
 
+	/* the I/O thread of the plugin is stopped in hw_free */
 	if (io->data->callback->hw_free)
-		return io->data->callback->hw_free(io->data);
-	return 0;
+		err = io->data->callback->hw_free(io->data);
+	ioplug_ring_free(io);
+	return err;
 }
 
 static int snd_pcm_ioplug_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
@@ -460,6 +674,18 @@ static int snd_pcm_ioplug_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 	ioplug_priv_t *io = pcm->private_data;
 	int err;
 
+	/* the ring is set up once the buffer geometry is fixed;
+	 * sw_params are applied always right after hw_params
+	 */
+	if (ioplug_ring_mode(io)) {
+		if (!io->ring.ctrl) {
+			err = ioplug_ring_alloc(pcm, params->boundary);
+			if (err < 0)
+				return err;
+		} else
+			io->ring.ctrl->boundary = params->boundary;
+	}
+
 	if (!io->data->callback->sw_params)
 		return 0;
 
@@ -592,6 +818,11 @@ static int snd_pcm_ioplug_pause(snd_pcm_t *pcm, int enable)
 
 static snd_pcm_sframes_t snd_pcm_ioplug_rewindable(snd_pcm_t *pcm)
 {
+	ioplug_priv_t *io = pcm->private_data;
+
+	/* the data may be already consumed by the ring reader */
+	if (ioplug_ring_mode(io))
+		return 0;
 	return snd_pcm_mmap_hw_rewindable(pcm);
 }
 
@@ -608,6 +839,17 @@ static snd_pcm_sframes_t snd_pcm_ioplug_forwardable(snd_pcm_t *pcm)
 
 static snd_pcm_sframes_t snd_pcm_ioplug_forward(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
 {
+	ioplug_priv_t *io = pcm->private_data;
+	snd_pcm_sframes_t result;
+
+	/* the ring pointer moves along; the skipped playback frames
+	 * are silenced
+	 */
+	if (ioplug_ring_mode(io) && frames > 0) {
+		result = ioplug_ring_transfer(pcm, NULL, 0, frames);
+		if (result < 0)
+			return result;
+	}
 	snd_pcm_mmap_appl_forward(pcm, frames);
 	return frames;
 }
@@ -633,7 +875,9 @@ static snd_pcm_sframes_t ioplug_priv_transfer_areas(snd_pcm_t *pcm,
 		
 	if (! size)
 		return 0;
-	if (io->data->callback->transfer)
+	if (ioplug_ring_mode(io))
+		result = ioplug_ring_transfer(pcm, areas, offset, size);
+	else if (io->data->callback->transfer)
 		result = io->data->callback->transfer(io->data, areas, offset, size);
 	else
 		result = size;
@@ -888,6 +1132,7 @@ static int snd_pcm_ioplug_close(snd_pcm_t *pcm)
 	clear_io_params(io);
 	if (io->data->callback->close)
 		io->data->callback->close(io->data);
+	ioplug_ring_free(io);
 	free(io);
 
 	return 0;
@@ -1030,6 +1275,26 @@ may be called inside the internal pthread mutex, and they shouldn't
 call the PCM functions again unnecessarily from the callback itself;
 otherwise it may lead to a deadlock.
 
+When #SND_PCM_IOPLUG_FLAG_RING is set in flags before calling
+#snd_pcm_ioplug_create(), the data is exchanged via a lock-free
+single-producer/single-consumer ring buffer instead of the transfer
+and pointer callbacks (the pointer callback may be NULL then).
+The ring is allocated (memfd backed if available) when hw_params are
+set and released after the hw_free callback, so the plugin must stop
+its I/O thread in hw_free at the latest.  It always holds interleaved frames of
+buffer_size.  The write or read call of the application copies the
+data to or from the ring and publishes the new position with an atomic
+store, so the I/O thread of the plugin never has to take the PCM lock.
+The I/O thread consumes the playback data via #snd_pcm_ioplug_ring_read()
+or produces the capture data via #snd_pcm_ioplug_ring_write(), and can
+sleep in #snd_pcm_ioplug_ring_wait() until the application side moves.
+The hw pointer of the PCM is taken from the ring.  The plugin is still
+responsible for waking up the application via its poll descriptor.
+Only the RW access types are available in this mode, and rewinding
+is disabled.  At prepare or reset, the queued playback data is dropped
+by the ring functions of the I/O thread at their next call, so the I/O
+thread does not need to be stopped for it.
+
 The hw_params constraints can be defined via either
 #snd_pcm_ioplug_set_param_minmax() and #snd_pcm_ioplug_set_param_list()
 functions after calling #snd_pcm_ioplug_create().
@@ -1066,7 +1331,8 @@ int snd_pcm_ioplug_create(snd_pcm_ioplug_t *ioplug, const char *name,
 	assert(ioplug && ioplug->callback);
 	assert(ioplug->callback->start &&
 	       ioplug->callback->stop &&
-	       ioplug->callback->pointer);
+	       (ioplug->callback->pointer ||
+		(ioplug->flags & SND_PCM_IOPLUG_FLAG_RING)));
 
 	/* We support 1.0.0 to current */
 	if (ioplug->version < 0x010000 ||
@@ -1081,6 +1347,7 @@ int snd_pcm_ioplug_create(snd_pcm_ioplug_t *ioplug, const char *name,
 		return -ENOMEM;
 
 	io->data = ioplug;
+	io->ring.fd = -1;
 	ioplug->state = SND_PCM_STATE_OPEN;
 	ioplug->stream = stream;
 
@@ -1194,7 +1461,11 @@ int snd_pcm_ioplug_reinit_status(snd_pcm_ioplug_t *ioplug)
 		ioplug->pcm->tstamp_type = SND_PCM_TSTAMP_TYPE_MONOTONIC;
 	else
 		ioplug->pcm->tstamp_type = SND_PCM_TSTAMP_TYPE_GETTIMEOFDAY;
-	ioplug->pcm->mmap_rw = ioplug->mmap_rw;
+	/* the ring transport does not use the pseudo mmap buffer */
+	if (ioplug->flags & SND_PCM_IOPLUG_FLAG_RING)
+		ioplug->pcm->mmap_rw = 0;
+	else
+		ioplug->pcm->mmap_rw = ioplug->mmap_rw;
 	return 0;
 }
 
@@ -1270,3 +1541,220 @@ snd_pcm_uframes_t snd_pcm_ioplug_hw_avail(const snd_pcm_ioplug_t * const ioplug,
 	/* available data/space which can be transferred by the DMA */
 	return ioplug->pcm->buffer_size - user_avail;
 }
+
+static ioplug_ring_t *ioplug_get_ring(snd_pcm_ioplug_t *ioplug)
+{
+	ioplug_priv_t *io = ioplug->pcm->private_data;
+
+	if (!io->ring.ctrl)
+		return NULL;
+	return &io->ring;
+}
+
+/* plugin side: apply a playback reset of the PCM side by moving hw to
+ * the reset position; returns the applied reset_seq
+ */
+static int ioplug_ring_sync_reset(struct ioplug_ring_ctrl *ctrl)
+{
+	int seq = __atomic_load_n(&ctrl->reset_seq, __ATOMIC_ACQUIRE);
+
+	if (seq != ctrl->reset_ack) {
+		__atomic_store_n(&ctrl->hw, ctrl->reset_hw, __ATOMIC_RELEASE);
+		__atomic_store_n(&ctrl->reset_ack, seq, __ATOMIC_RELEASE);
+	}
+	return seq;
+}
+
+/* frames ready for the plugin side: queued playback data or free
+ * space for the capture data
+ */
+static snd_pcm_uframes_t ioplug_ring_avail(snd_pcm_ioplug_t *ioplug,
+					   struct ioplug_ring_ctrl *ctrl)
+{
+	snd_pcm_uframes_t appl, hw;
+	snd_pcm_sframes_t avail;
+
+	appl = __atomic_load_n(&ctrl->appl, __ATOMIC_ACQUIRE);
+	hw = ctrl->hw;
+	if (ioplug->stream == SND_PCM_STREAM_PLAYBACK)
+		avail = appl - hw;
+	else
+		avail = hw - appl;
+	if (avail < 0)
+		avail += ctrl->boundary;
+	/* appl may be already past a reset not applied yet */
+	if ((snd_pcm_uframes_t)avail > ctrl->buffer_size)
+		avail = ctrl->buffer_size;
+	if (ioplug->stream == SND_PCM_STREAM_CAPTURE)
+		avail = ctrl->buffer_size - avail;
+	return avail;
+}
+
+/**
+ * \brief Get the file descriptor of the ring buffer storage
+ * \param ioplug the ioplug handle
+ * \return the memfd, or a negative error code
+ *
+ * The ring (control block followed by the data) can be mapped by
+ * another process via this file descriptor.  Available only with
+ * #SND_PCM_IOPLUG_FLAG_RING between hw_params and hw_free.
+ */
+int snd_pcm_ioplug_ring_fd(snd_pcm_ioplug_t *ioplug)
+{
+	ioplug_ring_t *ring = ioplug_get_ring(ioplug);
+
+	if (!ring)
+		return -EBADFD;
+	return ring->fd >= 0 ? ring->fd : -ENOSYS;
+}
+
+/**
+ * \brief Get the frames available for the plugin side of the ring
+ * \param ioplug the ioplug handle
+ * \return the queued frames for playback, the free frames for capture,
+ *         or a negative error code
+ *
+ * This function can be called from the I/O thread without the PCM lock.
+ */
+snd_pcm_sframes_t snd_pcm_ioplug_ring_avail(snd_pcm_ioplug_t *ioplug)
+{
+	ioplug_ring_t *ring = ioplug_get_ring(ioplug);
+
+	if (!ring)
+		return -EBADFD;
+	if (ioplug->stream == SND_PCM_STREAM_PLAYBACK)
+		ioplug_ring_sync_reset(ring->ctrl);
+	return ioplug_ring_avail(ioplug, ring->ctrl);
+}
+
+/**
+ * \brief Consume the playback data from the ring
+ * \param ioplug the ioplug handle
+ * \param buf the buffer to store interleaved frames
+ * \param frames the max number of frames to read
+ * \return the number of frames read, or a negative error code
+ *
+ * This function can be called from the I/O thread without the PCM lock.
+ * When the PCM is reset or prepared during the call, the data is
+ * dropped and zero is returned.
+ */
+snd_pcm_sframes_t snd_pcm_ioplug_ring_read(snd_pcm_ioplug_t *ioplug,
+					   void *buf, snd_pcm_uframes_t frames)
+{
+	ioplug_ring_t *ring = ioplug_get_ring(ioplug);
+	struct ioplug_ring_ctrl *ctrl;
+	snd_pcm_uframes_t avail, pos, xfer, hw;
+	unsigned int fb;
+	int reset;
+
+	if (!ring)
+		return -EBADFD;
+	if (ioplug->stream != SND_PCM_STREAM_PLAYBACK)
+		return -EINVAL;
+	ctrl = ring->ctrl;
+	fb = ctrl->frame_bytes;
+	reset = ioplug_ring_sync_reset(ctrl);
+	avail = ioplug_ring_avail(ioplug, ctrl);
+	if (frames > avail)
+		frames = avail;
+	hw = ctrl->hw;
+	pos = hw % ctrl->buffer_size;
+	xfer = ctrl->buffer_size - pos;
+	if (xfer > frames)
+		xfer = frames;
+	memcpy(buf, ring->data + pos * fb, xfer * fb);
+	memcpy((char *)buf + xfer * fb, ring->data, (frames - xfer) * fb);
+	/* reset in the meantime; the frames may be overwritten already */
+	if (__atomic_load_n(&ctrl->reset_seq, __ATOMIC_ACQUIRE) != reset)
+		return 0;
+	hw += frames;
+	if (hw >= ctrl->boundary)
+		hw -= ctrl->boundary;
+	__atomic_store_n(&ctrl->hw, hw, __ATOMIC_RELEASE);
+	ioplug_ring_wake(ctrl);
+	return frames;
+}
+
+/**
+ * \brief Produce the capture data to the ring
+ * \param ioplug the ioplug handle
+ * \param buf the buffer containing interleaved frames
+ * \param frames the max number of frames to write
+ * \return the number of frames written, or a negative error code
+ *
+ * This function can be called from the I/O thread without the PCM lock.
+ */
+snd_pcm_sframes_t snd_pcm_ioplug_ring_write(snd_pcm_ioplug_t *ioplug,
+					    const void *buf,
+					    snd_pcm_uframes_t frames)
+{
+	ioplug_ring_t *ring = ioplug_get_ring(ioplug);
+	struct ioplug_ring_ctrl *ctrl;
+	snd_pcm_uframes_t avail, pos, xfer, hw;
+	unsigned int fb;
+
+	if (!ring)
+		return -EBADFD;
+	if (ioplug->stream != SND_PCM_STREAM_CAPTURE)
+		return -EINVAL;
+	ctrl = ring->ctrl;
+	fb = ctrl->frame_bytes;
+	avail = ioplug_ring_avail(ioplug, ctrl);
+	if (frames > avail)
+		frames = avail;
+	hw = ctrl->hw;
+	pos = hw % ctrl->buffer_size;
+	xfer = ctrl->buffer_size - pos;
+	if (xfer > frames)
+		xfer = frames;
+	memcpy(ring->data + pos * fb, buf, xfer * fb);
+	memcpy(ring->data, (const char *)buf + xfer * fb, (frames - xfer) * fb);
+	hw += frames;
+	if (hw >= ctrl->boundary)
+		hw -= ctrl->boundary;
+	__atomic_store_n(&ctrl->hw, hw, __ATOMIC_RELEASE);
+	ioplug_ring_wake(ctrl);
+	return frames;
+}
+
+/**
+ * \brief Wait until the ring has frames available for the plugin side
+ * \param ioplug the ioplug handle
+ * \param timeout the max time to wait in milliseconds, negative to wait forever
+ * \return 1 if frames are available, 0 on timeout, or a negative error code
+ *
+ * The waiter is woken up via futex when the application side moves
+ * its pointer (or the PCM is prepared/reset).
+ */
+int snd_pcm_ioplug_ring_wait(snd_pcm_ioplug_t *ioplug, int timeout)
+{
+	ioplug_ring_t *ring = ioplug_get_ring(ioplug);
+	struct ioplug_ring_ctrl *ctrl;
+	struct timespec ts, *tsp = NULL;
+	int seq, err = 0;
+
+	if (!ring)
+		return -EBADFD;
+	ctrl = ring->ctrl;
+	if (ioplug->stream == SND_PCM_STREAM_PLAYBACK)
+		ioplug_ring_sync_reset(ctrl);
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000L;
+		tsp = &ts;
+	}
+	seq = __atomic_load_n(&ctrl->seq, __ATOMIC_SEQ_CST);
+	if (ioplug_ring_avail(ioplug, ctrl) > 0)
+		return 1;
+	__atomic_add_fetch(&ctrl->waiters, 1, __ATOMIC_SEQ_CST);
+	if (ioplug_ring_avail(ioplug, ctrl) == 0 &&
+	    syscall(SYS_futex, &ctrl->seq, FUTEX_WAIT, seq, tsp, NULL, 0) < 0 &&
+	    errno != EAGAIN && errno != EINTR)
+		err = -errno;
+	__atomic_sub_fetch(&ctrl->waiters, 1, __ATOMIC_SEQ_CST);
+	if (err == -ETIMEDOUT)
+		return 0;
+	if (err < 0)
+		return err;
+	return ioplug_ring_avail(ioplug, ctrl) > 0;
+}
@@ -31,6 +31,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <math.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 #include "pcm_local.h"
 #include "pcm_generic.h"
 
@@ -46,6 +49,16 @@ typedef struct {
 	unsigned int channels_count;
 	int close_slave;
 	snd_pcm_t *linked;
+	/* drift compensation (playback, non-master slaves) */
+	int drift;
+	void *drift_buf;		/* private buffer the client writes to */
+	snd_pcm_channel_area_t *drift_areas;
+	double *drift_last;		/* last input frame, per channel */
+	double drift_pos;		/* read position relative to the commit */
+	double drift_ratio;		/* input frames per output frame */
+	double drift_err;		/* filtered delay error in frames */
+	double drift_err_sum;		/* integrated delay error */
+	snd_pcm_uframes_t drift_dropped;
 } snd_pcm_multi_slave_t;
 
 typedef struct {
@@ -53,22 +66,442 @@ typedef struct {
 	unsigned int slave_channel;
 } snd_pcm_multi_channel_t;
 
+/* jobs dispatched to the slaves, possibly in parallel */
+enum {
+	MULTI_JOB_HWSYNC,
+	MULTI_JOB_AVAIL_UPDATE,
+	MULTI_JOB_MMAP_COMMIT,
+};
+
+typedef struct snd_pcm_multi snd_pcm_multi_t;
+
+#ifdef HAVE_LIBPTHREAD
 typedef struct {
+	snd_pcm_multi_t *multi;
+	unsigned int idx;
+	pthread_t thread;
+} snd_pcm_multi_worker_t;
+#endif
+
+struct snd_pcm_multi {
 	snd_pcm_uframes_t appl_ptr, hw_ptr;
 	unsigned int slaves_count;
 	unsigned int master_slave;
 	snd_pcm_multi_slave_t *slaves;
 	unsigned int channels_count;
 	snd_pcm_multi_channel_t *channels;
-} snd_pcm_multi_t;
+	/* worker pool for parallel slave processing */
+	unsigned int workers_count;
+#ifdef HAVE_LIBPTHREAD
+	snd_pcm_multi_worker_t *workers;
+	pthread_mutex_t job_mutex;
+	pthread_cond_t job_cond;
+	pthread_cond_t done_cond;
+	unsigned int job_seq;
+	unsigned int job_pending;
+	int job;
+	int job_quit;
+#endif
+	snd_pcm_uframes_t job_offset, job_size;
+	snd_pcm_sframes_t *job_results;
+	/* drift compensation */
+	int drift;
+	snd_pcm_format_t drift_format;
+	unsigned int drift_rate;
+	snd_pcm_uframes_t drift_buffer_size;
+	int master_running;
+	snd_pcm_uframes_t master_avail;
+	snd_htimestamp_t master_tstamp;
+};
+
+/* gains of the drift controller; the error is measured in frames and
+ * integrated over the committed frames
+ */
+#define DRIFT_FILTER		0.05
+#define DRIFT_KP		1e-6
+#define DRIFT_KI		1e-12
+/* max. correction of the resampling ratio (+/- 0.5%) */
+#define DRIFT_MAX_CORRECTION	0.005
+
+#endif
+
+static void snd_pcm_multi_drift_reset(snd_pcm_multi_slave_t *slave)
+{
+	slave->drift_pos = 0;
+	slave->drift_ratio = 1.0;
+	slave->drift_err = 0;
+	slave->drift_err_sum = 0;
+	slave->drift_dropped = 0;
+	if (slave->drift_last)
+		memset(slave->drift_last, 0,
+		       slave->channels_count * sizeof(*slave->drift_last));
+}
+
+static void snd_pcm_multi_drift_free(snd_pcm_multi_t *multi)
+{
+	unsigned int i;
+
+	for (i = 0; i < multi->slaves_count; ++i) {
+		snd_pcm_multi_slave_t *slave = &multi->slaves[i];
+		free(slave->drift_buf);
+		free(slave->drift_areas);
+		free(slave->drift_last);
+		slave->drift_buf = NULL;
+		slave->drift_areas = NULL;
+		slave->drift_last = NULL;
+	}
+}
+
+static double drift_get_sample(const snd_pcm_channel_area_t *area,
+			       snd_pcm_uframes_t offset,
+			       snd_pcm_format_t format)
+{
+	const void *addr = snd_pcm_channel_area_addr(area, offset);
+
+	switch (format) {
+	case SND_PCM_FORMAT_S16:
+		return *(const int16_t *)addr;
+	case SND_PCM_FORMAT_S32:
+		return *(const int32_t *)addr;
+	default:
+		return *(const float *)addr;
+	}
+}
+
+static void drift_put_sample(const snd_pcm_channel_area_t *area,
+			     snd_pcm_uframes_t offset,
+			     snd_pcm_format_t format, double val)
+{
+	void *addr = snd_pcm_channel_area_addr(area, offset);
+
+	switch (format) {
+	case SND_PCM_FORMAT_S16:
+		val = lrint(val);
+		if (val > INT16_MAX)
+			val = INT16_MAX;
+		else if (val < INT16_MIN)
+			val = INT16_MIN;
+		*(int16_t *)addr = val;
+		break;
+	case SND_PCM_FORMAT_S32:
+		val = llrint(val);
+		if (val > INT32_MAX)
+			val = INT32_MAX;
+		else if (val < INT32_MIN)
+			val = INT32_MIN;
+		*(int32_t *)addr = val;
+		break;
+	default:
+		*(float *)addr = val;
+		break;
+	}
+}
+
+/* compare the queued frames of the slave and the master at the same
+ * point of time and adjust the resampling ratio (PI controller);
+ * frames is the time elapsed since the last update
+ */
+static void snd_pcm_multi_drift_update(snd_pcm_multi_t *multi,
+				       snd_pcm_multi_slave_t *slave,
+				       snd_pcm_uframes_t frames)
+{
+	const double sum_max = DRIFT_MAX_CORRECTION / DRIFT_KI;
+	snd_pcm_uframes_t avail;
+	snd_htimestamp_t tstamp;
+	double delay, err, dt;
+
+	if (!multi->master_running ||
+	    snd_pcm_state(slave->pcm) != SND_PCM_STATE_RUNNING)
+		return;
+	if (snd_pcm_htimestamp(slave->pcm, &avail, &tstamp) < 0)
+		return;
+	dt = (double)(tstamp.tv_sec - multi->master_tstamp.tv_sec) +
+		(double)(tstamp.tv_nsec - multi->master_tstamp.tv_nsec) / 1e9;
+	/* slave delay at the time of the master timestamp */
+	delay = (double)multi->drift_buffer_size - avail +
+		dt * multi->drift_rate;
+	err = delay - ((double)multi->drift_buffer_size - multi->master_avail);
+	slave->drift_err += (err - slave->drift_err) * DRIFT_FILTER;
+	slave->drift_err_sum += slave->drift_err * frames;
+	/* no wind-up while the correction is saturated */
+	if (slave->drift_err_sum > sum_max)
+		slave->drift_err_sum = sum_max;
+	else if (slave->drift_err_sum < -sum_max)
+		slave->drift_err_sum = -sum_max;
+	slave->drift_ratio = 1.0 + slave->drift_err * DRIFT_KP +
+		slave->drift_err_sum * DRIFT_KI;
+	if (slave->drift_ratio > 1.0 + DRIFT_MAX_CORRECTION)
+		slave->drift_ratio = 1.0 + DRIFT_MAX_CORRECTION;
+	else if (slave->drift_ratio < 1.0 - DRIFT_MAX_CORRECTION)
+		slave->drift_ratio = 1.0 - DRIFT_MAX_CORRECTION;
+}
+
+/* resample the committed frames from the private buffer to the slave */
+static snd_pcm_sframes_t snd_pcm_multi_drift_commit(snd_pcm_multi_t *multi,
+						    snd_pcm_multi_slave_t *slave,
+						    snd_pcm_uframes_t offset,
+						    snd_pcm_uframes_t size)
+{
+	const snd_pcm_channel_area_t *in = slave->drift_areas;
+	snd_pcm_format_t format = multi->drift_format;
+	double end = (double)size - 1.0;
+	snd_pcm_sframes_t avail;
+	unsigned int c;
+
+	avail = snd_pcm_avail_update(slave->pcm);
+	if (avail < 0)
+		return avail;
+	snd_pcm_multi_drift_update(multi, slave, size);
+
+	while (slave->drift_pos < end) {
+		const snd_pcm_channel_area_t *areas;
+		snd_pcm_uframes_t soffset, frames, k;
+		snd_pcm_sframes_t result;
+		int err;
+
+		frames = (snd_pcm_uframes_t)
+			((end - slave->drift_pos) / slave->drift_ratio) + 1;
+		err = snd_pcm_mmap_begin(slave->pcm, &areas, &soffset, &frames);
+		if (err < 0)
+			return err;
+		if (!frames) {
+			/* no room in the slave buffer, drop the rest */
+			while (slave->drift_pos < end) {
+				slave->drift_pos += slave->drift_ratio;
+				slave->drift_dropped++;
+			}
+			break;
+		}
+		for (k = 0; k < frames && slave->drift_pos < end; k++) {
+			long i = (long)floor(slave->drift_pos);
+			double f = slave->drift_pos - i;
+			for (c = 0; c < slave->channels_count; c++) {
+				double a, b;
+				a = i < 0 ? slave->drift_last[c] :
+					drift_get_sample(&in[c], offset + i,
+							 format);
+				b = drift_get_sample(&in[c], offset + i + 1,
+						     format);
+				drift_put_sample(&areas[c], soffset + k,
+						 format, a + (b - a) * f);
+			}
+			slave->drift_pos += slave->drift_ratio;
+		}
+		result = snd_pcm_mmap_commit(slave->pcm, soffset, k);
+		if (result < 0)
+			return result;
+		if ((snd_pcm_uframes_t)result != k)
+			return -EIO;
+	}
+	for (c = 0; c < slave->channels_count; c++)
+		slave->drift_last[c] = drift_get_sample(&in[c],
+							offset + size - 1,
+							format);
+	slave->drift_pos -= size;
+	return size;
+}
+
+/* execute the job on a single slave */
+static void snd_pcm_multi_slave_job(snd_pcm_multi_t *multi, int job,
+				    unsigned int i)
+{
+	snd_pcm_t *slave = multi->slaves[i].pcm;
+	snd_pcm_sframes_t result;
+
+	switch (job) {
+	case MULTI_JOB_HWSYNC:
+		result = snd_pcm_hwsync(slave);
+		break;
+	case MULTI_JOB_AVAIL_UPDATE:
+		result = snd_pcm_avail_update(slave);
+		break;
+	case MULTI_JOB_MMAP_COMMIT:
+		if (multi->slaves[i].drift)
+			result = snd_pcm_multi_drift_commit(multi,
+							    &multi->slaves[i],
+							    multi->job_offset,
+							    multi->job_size);
+		else
+			result = snd_pcm_mmap_commit(slave, multi->job_offset,
+						     multi->job_size);
+		break;
+	default:
+		result = -EINVAL;
+		break;
+	}
+	multi->job_results[i] = result;
+}
+
+/* the slave result makes the whole job fail */
+static int snd_pcm_multi_job_failed(snd_pcm_multi_t *multi, int job,
+				    snd_pcm_sframes_t result)
+{
+	if (result < 0)
+		return 1;
+	return job == MULTI_JOB_MMAP_COMMIT &&
+	       (snd_pcm_uframes_t)result != multi->job_size;
+}
+
+/* slaves are distributed round-robin; the caller thread takes index 0.
+ * without workers, stop at the first failing slave like the serial code,
+ * so that the following slaves are not committed; the results after it
+ * are not valid then.
+ */
+static void snd_pcm_multi_run_part(snd_pcm_multi_t *multi, int job,
+				   unsigned int part)
+{
+	unsigned int i;
+
+	for (i = part; i < multi->slaves_count; i += multi->workers_count + 1) {
+		snd_pcm_multi_slave_job(multi, job, i);
+		if (!multi->workers_count &&
+		    snd_pcm_multi_job_failed(multi, job, multi->job_results[i]))
+			break;
+	}
+}
+
+#ifdef HAVE_LIBPTHREAD
+
+static void *snd_pcm_multi_worker(void *data)
+{
+	snd_pcm_multi_worker_t *worker = data;
+	snd_pcm_multi_t *multi = worker->multi;
+	unsigned int seq = 0;
+	int job;
+
+	pthread_mutex_lock(&multi->job_mutex);
+	for (;;) {
+		while (multi->job_seq == seq && !multi->job_quit)
+			pthread_cond_wait(&multi->job_cond, &multi->job_mutex);
+		if (multi->job_quit)
+			break;
+		seq = multi->job_seq;
+		job = multi->job;
+		pthread_mutex_unlock(&multi->job_mutex);
+		snd_pcm_multi_run_part(multi, job, worker->idx + 1);
+		pthread_mutex_lock(&multi->job_mutex);
+		if (--multi->job_pending == 0)
+			pthread_cond_signal(&multi->done_cond);
+	}
+	pthread_mutex_unlock(&multi->job_mutex);
+	return NULL;
+}
+#endif
+
+/* run the job on all slaves and wait until all of them are finished;
+ * the per-slave results are stored in multi->job_results
+ */
+static void snd_pcm_multi_run_job(snd_pcm_multi_t *multi, int job)
+{
+#ifdef HAVE_LIBPTHREAD
+	if (!multi->workers_count) {
+		snd_pcm_multi_run_part(multi, job, 0);
+		return;
+	}
+	pthread_mutex_lock(&multi->job_mutex);
+	multi->job = job;
+	multi->job_pending = multi->workers_count;
+	multi->job_seq++;
+	pthread_cond_broadcast(&multi->job_cond);
+	pthread_mutex_unlock(&multi->job_mutex);
+
+	snd_pcm_multi_run_part(multi, job, 0);
+
+	pthread_mutex_lock(&multi->job_mutex);
+	while (multi->job_pending > 0)
+		pthread_cond_wait(&multi->done_cond, &multi->job_mutex);
+	pthread_mutex_unlock(&multi->job_mutex);
+#else
+	snd_pcm_multi_run_part(multi, job, 0);
+#endif
+}
+
+#ifdef HAVE_LIBPTHREAD
 
+static void snd_pcm_multi_stop_workers(snd_pcm_multi_t *multi)
+{
+	unsigned int i;
+
+	if (!multi->workers)
+		return;
+	pthread_mutex_lock(&multi->job_mutex);
+	multi->job_quit = 1;
+	pthread_cond_broadcast(&multi->job_cond);
+	pthread_mutex_unlock(&multi->job_mutex);
+	for (i = 0; i < multi->workers_count; i++)
+		pthread_join(multi->workers[i].thread, NULL);
+	pthread_cond_destroy(&multi->done_cond);
+	pthread_cond_destroy(&multi->job_cond);
+	pthread_mutex_destroy(&multi->job_mutex);
+	free(multi->workers);
+	multi->workers = NULL;
+	multi->workers_count = 0;
+}
+
+static int snd_pcm_multi_start_workers(snd_pcm_multi_t *multi,
+				       unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	if (count >= multi->slaves_count)
+		count = multi->slaves_count - 1;
+	if (!count)
+		return 0;
+	multi->workers = calloc(count, sizeof(*multi->workers));
+	if (!multi->workers)
+		return -ENOMEM;
+	pthread_mutex_init(&multi->job_mutex, NULL);
+	pthread_cond_init(&multi->job_cond, NULL);
+	pthread_cond_init(&multi->done_cond, NULL);
+	multi->job_quit = 0;
+	for (i = 0; i < count; i++) {
+		multi->workers[i].multi = multi;
+		multi->workers[i].idx = i;
+		err = pthread_create(&multi->workers[i].thread, NULL,
+				     snd_pcm_multi_worker, &multi->workers[i]);
+		if (err) {
+			multi->workers_count = i;
+			snd_pcm_multi_stop_workers(multi);
+			return -err;
+		}
+	}
+	multi->workers_count = count;
+	return 0;
+}
+#else
+/* no threads; the slaves are processed serially */
+static void snd_pcm_multi_stop_workers(snd_pcm_multi_t *multi ATTRIBUTE_UNUSED)
+{
+}
+
+static int snd_pcm_multi_start_workers(snd_pcm_multi_t *multi ATTRIBUTE_UNUSED,
+				       unsigned int count ATTRIBUTE_UNUSED)
+{
+	return 0;
+}
 #endif
 
+/* enable drift compensation for all slaves but the master */
+static void snd_pcm_multi_set_drift(snd_pcm_multi_t *multi)
+{
+	unsigned int i;
+
+	for (i = 0; i < multi->slaves_count; ++i) {
+		if (i == multi->master_slave)
+			continue;
+		multi->slaves[i].drift = 1;
+		multi->drift = 1;
+	}
+}
+
 static int snd_pcm_multi_close(snd_pcm_t *pcm)
 {
 	snd_pcm_multi_t *multi = pcm->private_data;
 	unsigned int i;
 	int ret = 0;
+
+	snd_pcm_multi_stop_workers(multi);
 	for (i = 0; i < multi->slaves_count; ++i) {
 		snd_pcm_multi_slave_t *slave = &multi->slaves[i];
 		if (slave->close_slave) {
@@ -79,6 +512,7 @@ static int snd_pcm_multi_close(snd_pcm_t *pcm)
 	}
 	free(multi->slaves);
 	free(multi->channels);
+	free(multi->job_results);
 	free(multi);
 	return ret;
 }
@@ -411,6 +845,9 @@ static void snd_pcm_multi_hwptr_update(snd_pcm_t *pcm)
 	if (pcm->stream == SND_PCM_STREAM_PLAYBACK) {
 		last_avail = 0;
 		for (i = 0; i < multi->slaves_count; ++i) {
+			/* resampled slaves run in their own frame domain */
+			if (multi->slaves[i].drift)
+				continue;
 			slave_hw_ptr = *multi->slaves[i].pcm->hw.ptr;
 			avail = __snd_pcm_playback_avail(pcm, multi->hw_ptr, slave_hw_ptr);
 			if (avail > last_avail) {
@@ -436,11 +873,11 @@ static int snd_pcm_multi_hwsync(snd_pcm_t *pcm)
 {
 	snd_pcm_multi_t *multi = pcm->private_data;
 	unsigned int i;
-	int err;
+
+	snd_pcm_multi_run_job(multi, MULTI_JOB_HWSYNC);
 	for (i = 0; i < multi->slaves_count; ++i) {
-		err = snd_pcm_hwsync(multi->slaves[i].pcm);
-		if (err < 0)
-			return err;
+		if (multi->job_results[i] < 0)
+			return multi->job_results[i];
 	}
 	snd_pcm_multi_hwptr_update(pcm);
 	return 0;
@@ -468,11 +905,14 @@ static snd_pcm_sframes_t snd_pcm_multi_avail_update(snd_pcm_t *pcm)
 	snd_pcm_multi_t *multi = pcm->private_data;
 	snd_pcm_sframes_t ret = LONG_MAX;
 	unsigned int i;
+
+	snd_pcm_multi_run_job(multi, MULTI_JOB_AVAIL_UPDATE);
 	for (i = 0; i < multi->slaves_count; ++i) {
-		snd_pcm_sframes_t avail;
-		avail = snd_pcm_avail_update(multi->slaves[i].pcm);
+		snd_pcm_sframes_t avail = multi->job_results[i];
 		if (avail < 0)
 			return avail;
+		if (multi->slaves[i].drift)
+			continue;
 		if (ret > avail)
 			ret = avail;
 	}
@@ -500,6 +940,8 @@ static int snd_pcm_multi_prepare(snd_pcm_t *pcm)
 		err = snd_pcm_prepare(multi->slaves[i].pcm);
 		if (err < 0)
 			result = err;
+		if (multi->slaves[i].drift)
+			snd_pcm_multi_drift_reset(&multi->slaves[i]);
 	}
 	multi->hw_ptr = multi->appl_ptr = 0;
 	return result;
@@ -515,6 +957,8 @@ static int snd_pcm_multi_reset(snd_pcm_t *pcm)
 		err = snd_pcm_reset(multi->slaves[i].pcm);
 		if (err < 0) 
 			result = err;
+		if (multi->slaves[i].drift)
+			snd_pcm_multi_drift_reset(&multi->slaves[i]);
 	}
 	multi->hw_ptr = multi->appl_ptr = 0;
 	return result;
@@ -612,6 +1056,10 @@ static snd_pcm_sframes_t snd_pcm_multi_rewindable(snd_pcm_t *pcm)
 	unsigned int i;
 	snd_pcm_sframes_t frames = LONG_MAX;
 
+	/* resampled data cannot be moved back */
+	if (multi->drift)
+		return 0;
+
 	for (i = 0; i < multi->slaves_count; ++i) {
 		snd_pcm_sframes_t f = snd_pcm_rewindable(multi->slaves[i].pcm);
 		if (f <= 0)
@@ -630,6 +1078,10 @@ static snd_pcm_sframes_t snd_pcm_multi_forwardable(snd_pcm_t *pcm)
 	unsigned int i;
 	snd_pcm_sframes_t frames = LONG_MAX;
 
+	/* resampled data cannot be moved back */
+	if (multi->drift)
+		return 0;
+
 	for (i = 0; i < multi->slaves_count; ++i) {
 		snd_pcm_sframes_t f = snd_pcm_forwardable(multi->slaves[i].pcm);
 		if (f <= 0)
@@ -770,13 +1222,21 @@ static snd_pcm_sframes_t snd_pcm_multi_mmap_commit(snd_pcm_t *pcm,
 						   snd_pcm_uframes_t size)
 {
 	snd_pcm_multi_t *multi = pcm->private_data;
-	snd_pcm_t *slave;
 	unsigned int i;
 	snd_pcm_sframes_t result;
 
+	if (multi->drift) {
+		snd_pcm_t *master = multi->slaves[multi->master_slave].pcm;
+		multi->master_running =
+			snd_pcm_state(master) == SND_PCM_STATE_RUNNING &&
+			snd_pcm_htimestamp(master, &multi->master_avail,
+					   &multi->master_tstamp) >= 0;
+	}
+	multi->job_offset = offset;
+	multi->job_size = size;
+	snd_pcm_multi_run_job(multi, MULTI_JOB_MMAP_COMMIT);
 	for (i = 0; i < multi->slaves_count; ++i) {
-		slave = multi->slaves[i].pcm;
-		result = snd_pcm_mmap_commit(slave, offset, size);
+		result = multi->job_results[i];
 		if (result < 0)
 			return result;
 		if ((snd_pcm_uframes_t)result != size)
@@ -787,8 +1247,55 @@ static snd_pcm_sframes_t snd_pcm_multi_mmap_commit(snd_pcm_t *pcm,
 	return size;
 }
 
+/* allocate the private buffers of the resampled slaves */
+static int snd_pcm_multi_drift_alloc(snd_pcm_t *pcm)
+{
+	snd_pcm_multi_t *multi = pcm->private_data;
+	unsigned int i, c;
+
+	if (!multi->drift)
+		return 0;
+	switch (pcm->format) {
+	case SND_PCM_FORMAT_S16:
+	case SND_PCM_FORMAT_S32:
+	case SND_PCM_FORMAT_FLOAT:
+		break;
+	default:
+		SNDERR("drift compensation supports only S16, S32 and FLOAT formats");
+		return -EINVAL;
+	}
+	multi->drift_format = pcm->format;
+	multi->drift_rate = pcm->rate;
+	multi->drift_buffer_size = pcm->buffer_size;
+	for (i = 0; i < multi->slaves_count; ++i) {
+		snd_pcm_multi_slave_t *slave = &multi->slaves[i];
+		unsigned int channels = slave->channels_count;
+		if (!slave->drift)
+			continue;
+		slave->drift_buf = calloc(pcm->buffer_size,
+					  channels * pcm->sample_bits / 8);
+		slave->drift_areas = calloc(channels,
+					    sizeof(*slave->drift_areas));
+		slave->drift_last = calloc(channels,
+					   sizeof(*slave->drift_last));
+		if (!slave->drift_buf || !slave->drift_areas ||
+		    !slave->drift_last) {
+			snd_pcm_multi_drift_free(multi);
+			return -ENOMEM;
+		}
+		for (c = 0; c < channels; c++) {
+			slave->drift_areas[c].addr = slave->drift_buf;
+			slave->drift_areas[c].first = c * pcm->sample_bits;
+			slave->drift_areas[c].step = channels * pcm->sample_bits;
+		}
+		snd_pcm_multi_drift_reset(slave);
+	}
+	return 0;
+}
+
 static int snd_pcm_multi_munmap(snd_pcm_t *pcm)
 {
+	snd_pcm_multi_drift_free(pcm->private_data);
 	free(pcm->mmap_channels);
 	free(pcm->running_areas);
 	pcm->mmap_channels = NULL;
@@ -800,6 +1307,7 @@ static int snd_pcm_multi_mmap(snd_pcm_t *pcm)
 {
 	snd_pcm_multi_t *multi = pcm->private_data;
 	unsigned int c;
+	int err;
 
 	pcm->mmap_channels = calloc(pcm->channels,
 				    sizeof(pcm->mmap_channels[0]));
@@ -809,6 +1317,11 @@ static int snd_pcm_multi_mmap(snd_pcm_t *pcm)
 		snd_pcm_multi_munmap(pcm);
 		return -ENOMEM;
 	}
+	err = snd_pcm_multi_drift_alloc(pcm);
+	if (err < 0) {
+		snd_pcm_multi_munmap(pcm);
+		return err;
+	}
 
 	/* Copy the slave mmapped buffer data */
 	for (c = 0; c < pcm->channels; c++) {
@@ -818,6 +1331,18 @@ static int snd_pcm_multi_mmap(snd_pcm_t *pcm)
 			snd_pcm_multi_munmap(pcm);
 			return -ENXIO;
 		}
+		if (multi->slaves[chan->slave_idx].drift) {
+			/* the client writes to the private buffer */
+			snd_pcm_channel_area_t *a =
+				&multi->slaves[chan->slave_idx].drift_areas[chan->slave_channel];
+			pcm->mmap_channels[c].channel = c;
+			pcm->mmap_channels[c].addr = a->addr;
+			pcm->mmap_channels[c].first = a->first;
+			pcm->mmap_channels[c].step = a->step;
+			pcm->mmap_channels[c].type = SND_PCM_AREA_LOCAL;
+			pcm->running_areas[c] = *a;
+			continue;
+		}
 		slave = multi->slaves[chan->slave_idx].pcm;
 		pcm->mmap_channels[c] =
 			slave->mmap_channels[chan->slave_channel];
@@ -989,8 +1514,13 @@ static void snd_pcm_multi_dump(snd_pcm_t *pcm, snd_output_t *out)
 		snd_pcm_dump_setup(pcm, out);
 	}
 	for (k = 0; k < multi->slaves_count; ++k) {
+		snd_pcm_multi_slave_t *slave = &multi->slaves[k];
 		snd_output_printf(out, "Slave #%d: ", k);
-		snd_pcm_dump(multi->slaves[k].pcm, out);
+		if (slave->drift)
+			snd_output_printf(out, "(drift %+.1f ppm, dropped %lu) ",
+					  (slave->drift_ratio - 1.0) * 1e6,
+					  slave->drift_dropped);
+		snd_pcm_dump(slave->pcm, out);
 	}
 }
 
@@ -1100,6 +1630,13 @@ int snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
 		free(multi);
 		return -ENOMEM;
 	}
+	multi->job_results = calloc(slaves_count, sizeof(*multi->job_results));
+	if (!multi->job_results) {
+		free(multi->channels);
+		free(multi->slaves);
+		free(multi);
+		return -ENOMEM;
+	}
 	for (i = 0; i < slaves_count; ++i) {
 		snd_pcm_multi_slave_t *slave = &multi->slaves[i];
 		assert(slaves_pcm[i]->stream == stream);
@@ -1123,6 +1660,7 @@ int snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
 	if (err < 0) {
 		free(multi->slaves);
 		free(multi->channels);
+		free(multi->job_results);
 		free(multi);
 		return err;
 	}
@@ -1166,9 +1704,32 @@ pcm.name {
 		}
 	}
 	[master INT]		# Define the master slave
+	[workers INT]		# Worker threads for parallel slave processing
+	[drift BOOL]		# Compensate clock drift of non-master slaves
 }
 \endcode
 
+When \c drift is enabled (playback only), the slaves other than the master
+are assumed to run from independent clocks.  The data for such a slave is
+written to a private buffer and fed to the slave through a small linear
+interpolating resampler.  At each commit, the queued frames of the slave
+and the master are compared at the same point of time (using
+snd_pcm_htimestamp()) and the resampling ratio is adjusted to keep both
+in sync, within +/- 0.5%.  The compensated slaves do not take part in
+the hw_ptr and avail computation of the multi PCM, and rewind/forward
+are disabled.  Only S16, S32 and FLOAT formats are supported in this mode.
+
+When \c workers is greater than zero, the commit, avail_update and hwsync
+operations of the slaves (including their whole plugin chains, e.g.
+rate or route conversions) are executed in parallel by a pool of
+worker threads, joined before the result is returned.  The slaves are
+distributed round-robin between the caller and the workers, so at most
+slaves - 1 workers are started.  The state operations (start, drop,
+etc.) and the slave linking are not affected.  Without pthread support,
+the option is ignored and the slaves are processed serially.  This is useful when
+many devices are aggregated and the serial processing does not meet
+the period deadlines.
+
 For example, to bind two PCM streams with two-channel stereo (hw:0,0 and
 hw:0,1) as one 4-channel stereo PCM stream, define like this:
 \code
@@ -1245,6 +1806,8 @@ int _snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
 	unsigned int *channels_schannel = NULL;
 	unsigned int slaves_count = 0;
 	long master_slave = 0;
+	long workers = 0;
+	int drift = 0;
 	unsigned int channels_count = 0;
 	snd_config_for_each(i, inext, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
@@ -1276,6 +1839,23 @@ int _snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
 			}
 			continue;
 		}
+		if (strcmp(id, "drift") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0) {
+				SNDERR("Invalid value for %s", id);
+				return err;
+			}
+			drift = err;
+			continue;
+		}
+		if (strcmp(id, "workers") == 0) {
+			if (snd_config_get_integer(n, &workers) < 0 ||
+			    workers < 0) {
+				SNDERR("Invalid value for %s", id);
+				return -EINVAL;
+			}
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -1425,6 +2005,27 @@ int _snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
 				 channels_count,
 				 channels_sidx, channels_schannel,
 				 1);
+	if (err >= 0 && drift) {
+		if (stream != SND_PCM_STREAM_PLAYBACK) {
+			SNDERR("drift compensation supports only playback");
+			snd_pcm_close(*pcmp);
+			*pcmp = NULL;
+			memset(slaves_pcm, 0, slaves_count * sizeof(*slaves_pcm));
+			err = -EINVAL;
+			goto _free;
+		}
+		snd_pcm_multi_set_drift((*pcmp)->private_data);
+	}
+	if (err >= 0 && workers > 0) {
+		err = snd_pcm_multi_start_workers((*pcmp)->private_data,
+						  workers);
+		if (err < 0) {
+			/* the slaves are closed together with the multi PCM */
+			snd_pcm_close(*pcmp);
+			*pcmp = NULL;
+			memset(slaves_pcm, 0, slaves_count * sizeof(*slaves_pcm));
+		}
+	}
 _free:
 	if (err < 0) {
 		for (idx = 0; idx < slaves_count; ++idx) {
@@ -78,6 +78,20 @@ snd_rawmidi_drain() immediately'.
 There is only standard read/write access to device internal ring buffer. Use
 snd_rawmidi_read() and snd_rawmidi_write() functions to obtain / write MIDI bytes.
 
+\subsection rawmidi_io_frames Timestamped input
+
+snd_rawmidi_read_frames() reads the input as an array of #snd_rawmidi_frame_t
+records, each carrying up to #SND_RAWMIDI_FRAME_DATA_LENGTH bytes and the
+CLOCK_MONOTONIC_RAW time they were received, so that a whole buffer of messages
+can be taken with one call without losing their timing.
+When the kernel supports it (rawmidi protocol 2.0.2 and newer), the hw device
+is switched to the kernel framing mode at the first call and the timestamps
+are taken by the driver when the bytes arrive. Otherwise the bytes are split
+into frames by the library, one MIDI message per frame (System Exclusive
+messages in chunks), stamped at the time they were read.
+Once the frames are read from a stream, snd_rawmidi_read() must not be used
+for it any more.
+
 \subsection rawmidi_dev_names RawMidi naming conventions
 
 The ALSA library uses a generic string representation for names of devices.
@@ -945,6 +959,9 @@ int snd_rawmidi_status(snd_rawmidi_t *rawmidi, snd_rawmidi_status_t * status)
 int snd_rawmidi_drop(snd_rawmidi_t *rawmidi)
 {
 	assert(rawmidi);
+	rawmidi->frame.length = 0;
+	rawmidi->frame_status = 0;
+	rawmidi->frame_pos = rawmidi->frame_len = 0;
 	return rawmidi->ops->drop(rawmidi);
 }
 
@@ -987,5 +1004,162 @@ ssize_t snd_rawmidi_read(snd_rawmidi_t *rawmidi, void *buffer, size_t size)
 	assert(rawmidi);
 	assert(rawmidi->stream == SND_RAWMIDI_STREAM_INPUT);
 	assert(buffer || size == 0);
+	if (rawmidi->framing > 0)
+		return -EBADFD;
 	return (rawmidi->ops->read)(rawmidi, buffer, size);
 }
+
+/* number of data bytes following the given status byte */
+static unsigned char snd_rawmidi_frame_length(unsigned char status)
+{
+	switch (status & 0xf0) {
+	case 0xc0:
+	case 0xd0:
+		return 1;
+	case 0xf0:
+		break;
+	default:
+		return 2;
+	}
+	switch (status) {
+	case 0xf1:
+	case 0xf3:
+		return 1;
+	case 0xf2:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+/* complete the pending frame */
+static void snd_rawmidi_frame_put(snd_rawmidi_t *rawmidi, snd_rawmidi_frame_t *frame)
+{
+	*frame = rawmidi->frame;
+	rawmidi->frame.length = 0;
+}
+
+/* split the bytes in frame_buf to frames; returns the number of frames */
+static size_t snd_rawmidi_frame_parse(snd_rawmidi_t *rawmidi, const snd_htimestamp_t *tstamp,
+				      snd_rawmidi_frame_t *frames, size_t count)
+{
+	snd_rawmidi_frame_t *frame = &rawmidi->frame;
+	unsigned char c;
+	size_t n = 0;
+
+	while (rawmidi->frame_pos < rawmidi->frame_len && n < count) {
+		c = rawmidi->frame_buf[rawmidi->frame_pos];
+		if (frame->length && (c & 0x80) && c < 0xf8 &&
+		    !(c == 0xf7 && rawmidi->frame_status == 0xf0) &&
+		    n + 2 > count) {
+			/* no room for both the pending frame and this one */
+			snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+			break;
+		}
+		rawmidi->frame_pos++;
+		if (c >= 0xf8) {
+			/* real-time messages may appear anywhere */
+			frames[n].tstamp = *tstamp;
+			frames[n].length = 1;
+			frames[n].data[0] = c;
+			n++;
+			continue;
+		}
+		if (c & 0x80) {
+			if (c == 0xf7 && rawmidi->frame_status == 0xf0) {
+				/* end of SysEx */
+				if (!frame->length)
+					frame->tstamp = *tstamp;
+				frame->data[frame->length++] = c;
+				snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+				rawmidi->frame_status = 0;
+				continue;
+			}
+			if (frame->length)
+				snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+			frame->tstamp = *tstamp;
+			frame->data[0] = c;
+			frame->length = 1;
+			/* system common messages cancel the running status */
+			rawmidi->frame_status = c < 0xf0 || c == 0xf0 ? c : 0;
+			rawmidi->frame_need = snd_rawmidi_frame_length(c);
+			if (!rawmidi->frame_need && c != 0xf0)
+				snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+			continue;
+		}
+		if (!frame->length) {
+			frame->tstamp = *tstamp;
+			/* running status */
+			if (rawmidi->frame_status && rawmidi->frame_status != 0xf0)
+				rawmidi->frame_need = snd_rawmidi_frame_length(rawmidi->frame_status);
+			else if (rawmidi->frame_status != 0xf0)
+				rawmidi->frame_need = 1;	/* stray data byte */
+		}
+		frame->data[frame->length++] = c;
+		if (rawmidi->frame_status == 0xf0) {
+			if (frame->length == SND_RAWMIDI_FRAME_DATA_LENGTH)
+				snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+		} else if (--rawmidi->frame_need == 0) {
+			snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+		}
+	}
+	/* don't hold back the received part of SysEx */
+	if (rawmidi->frame_pos >= rawmidi->frame_len &&
+	    rawmidi->frame_status == 0xf0 && frame->length && n < count)
+		snd_rawmidi_frame_put(rawmidi, &frames[n++]);
+	return n;
+}
+
+/* user-space framing of the input bytes */
+static ssize_t snd_rawmidi_frame_read(snd_rawmidi_t *rawmidi, snd_rawmidi_frame_t *frames, size_t count)
+{
+	static const snd_htimestamp_t zero;
+	struct timespec ts;
+	ssize_t result;
+	size_t n;
+
+	if (rawmidi->frame_pos < rawmidi->frame_len) {
+		/* bytes left over by the last call */
+		n = snd_rawmidi_frame_parse(rawmidi, &rawmidi->frame_tstamp, frames, count);
+		if (n > 0)
+			return n;
+	}
+	result = rawmidi->ops->read(rawmidi, rawmidi->frame_buf, sizeof(rawmidi->frame_buf));
+	if (result <= 0)
+		return result;
+	if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) < 0)
+		ts = zero;
+	rawmidi->frame_tstamp = ts;
+	rawmidi->frame_pos = 0;
+	rawmidi->frame_len = result;
+	return snd_rawmidi_frame_parse(rawmidi, &ts, frames, count);
+}
+
+/**
+ * \brief read timestamped MIDI bytes from MIDI stream
+ * \param rawmidi RawMidi handle
+ * \param frames array to store the received frames
+ * \param count number of elements in frames
+ * \return number of frames read, otherwise a negative error code
+ *
+ * Reads as many bytes as available (blocking until at least one arrives
+ * unless the stream is nonblocking) and returns them as frames stamped
+ * with CLOCK_MONOTONIC_RAW. See \ref rawmidi_io_frames for details.
+ */
+ssize_t snd_rawmidi_read_frames(snd_rawmidi_t *rawmidi, snd_rawmidi_frame_t *frames, size_t count)
+{
+	ssize_t result;
+
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_INPUT);
+	assert(frames || count == 0);
+	if (count == 0)
+		return 0;
+	if (rawmidi->framing >= 0 && rawmidi->ops->read_frames) {
+		result = rawmidi->ops->read_frames(rawmidi, frames, count);
+		if (result != -ENOSYS)
+			return result;
+	}
+	rawmidi->framing = -1;
+	return snd_rawmidi_frame_read(rawmidi, frames, count);
+}
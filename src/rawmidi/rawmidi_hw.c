@@ -42,6 +42,7 @@ typedef struct {
 	int open;
 	int fd;
 	int card, device, subdevice;
+	int version;
 } snd_rawmidi_hw_t;
 #endif
 
@@ -96,6 +97,10 @@ static int snd_rawmidi_hw_params(snd_rawmidi_t *rmidi, snd_rawmidi_params_t * pa
 {
 	snd_rawmidi_hw_t *hw = rmidi->private_data;
 	params->stream = rmidi->stream;
+	params->mode = 0;
+	if (rmidi->framing > 0)
+		params->mode = SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP |
+			       SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW;
 	if (ioctl(hw->fd, SNDRV_RAWMIDI_IOCTL_PARAMS, params) < 0) {
 		SYSERR("SNDRV_RAWMIDI_IOCTL_PARAMS failed");
 		return -errno;
@@ -156,6 +161,62 @@ static ssize_t snd_rawmidi_hw_read(snd_rawmidi_t *rmidi, void *buffer, size_t si
 	return result;
 }
 
+/* switch the input stream to the kernel framing */
+static int snd_rawmidi_hw_framing(snd_rawmidi_t *rmidi)
+{
+	snd_rawmidi_hw_t *hw = rmidi->private_data;
+	snd_rawmidi_params_t params;
+
+	if (hw->version < SNDRV_PROTOCOL_VERSION(2, 0, 2))
+		return -ENOSYS;
+	memset(&params, 0, sizeof(params));
+	params.stream = rmidi->stream;
+	params.buffer_size = rmidi->buffer_size;
+	params.avail_min = rmidi->avail_min;
+	params.no_active_sensing = rmidi->no_active_sensing;
+	params.mode = SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP |
+		      SNDRV_RAWMIDI_MODE_CLOCK_MONOTONIC_RAW;
+	if (ioctl(hw->fd, SNDRV_RAWMIDI_IOCTL_PARAMS, &params) < 0)
+		return -ENOSYS;
+	rmidi->framing = 1;
+	return 0;
+}
+
+static ssize_t snd_rawmidi_hw_read_frames(snd_rawmidi_t *rmidi, snd_rawmidi_frame_t *frames, size_t count)
+{
+	snd_rawmidi_hw_t *hw = rmidi->private_data;
+	struct snd_rawmidi_framing_tstamp recs[32], *rec;
+	ssize_t result;
+	size_t i, n;
+	int err;
+
+	if (!rmidi->framing) {
+		err = snd_rawmidi_hw_framing(rmidi);
+		if (err < 0)
+			return err;
+	}
+	if (count > sizeof(recs) / sizeof(recs[0]))
+		count = sizeof(recs) / sizeof(recs[0]);
+	/* the kernel hands out whole records only */
+	result = read(hw->fd, recs, count * sizeof(recs[0]));
+	if (result < 0)
+		return -errno;
+	result /= sizeof(recs[0]);
+	for (i = n = 0; i < (size_t)result; i++) {
+		rec = &recs[i];
+		if (rec->frame_type != 0 || !rec->length)
+			continue;
+		frames[n].tstamp.tv_sec = rec->tv_sec;
+		frames[n].tstamp.tv_nsec = rec->tv_nsec;
+		frames[n].length = rec->length;
+		if (frames[n].length > SND_RAWMIDI_FRAME_DATA_LENGTH)
+			frames[n].length = SND_RAWMIDI_FRAME_DATA_LENGTH;
+		memcpy(frames[n].data, rec->data, frames[n].length);
+		n++;
+	}
+	return n;
+}
+
 static const snd_rawmidi_ops_t snd_rawmidi_hw_ops = {
 	.close = snd_rawmidi_hw_close,
 	.nonblock = snd_rawmidi_hw_nonblock,
@@ -166,6 +227,7 @@ static const snd_rawmidi_ops_t snd_rawmidi_hw_ops = {
 	.drain = snd_rawmidi_hw_drain,
 	.write = snd_rawmidi_hw_write,
 	.read = snd_rawmidi_hw_read,
+	.read_frames = snd_rawmidi_hw_read_frames,
 };
 
 
@@ -272,6 +334,7 @@ int snd_rawmidi_hw_open(snd_rawmidi_t **inputp, snd_rawmidi_t **outputp,
 	hw->device = device;
 	hw->subdevice = subdevice;
 	hw->fd = fd;
+	hw->version = ver;
 
 	if (inputp) {
 		rmidi = calloc(1, sizeof(snd_rawmidi_t));
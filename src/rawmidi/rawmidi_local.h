@@ -34,8 +34,11 @@ typedef struct {
 	int (*drain)(snd_rawmidi_t *rawmidi);
 	ssize_t (*write)(snd_rawmidi_t *rawmidi, const void *buffer, size_t size);
 	ssize_t (*read)(snd_rawmidi_t *rawmidi, void *buffer, size_t size);
+	ssize_t (*read_frames)(snd_rawmidi_t *rawmidi, snd_rawmidi_frame_t *frames, size_t count);	/* optional */
 } snd_rawmidi_ops_t;
 
+#define SND_RAWMIDI_FRAME_BUF	256
+
 struct _snd_rawmidi {
 	void *open_func;
 	char *name;
@@ -48,6 +51,15 @@ struct _snd_rawmidi {
 	size_t buffer_size;
 	size_t avail_min;
 	unsigned int no_active_sensing: 1;
+	int framing;		/* 1 = framed by kernel, -1 = framed here */
+	/* user-space framer */
+	snd_rawmidi_frame_t frame;	/* incomplete frame */
+	unsigned char frame_status;	/* running status */
+	unsigned char frame_need;	/* data bytes missing in frame */
+	snd_htimestamp_t frame_tstamp;	/* time of the last read */
+	unsigned int frame_pos;
+	unsigned int frame_len;
+	unsigned char frame_buf[SND_RAWMIDI_FRAME_BUF];
 };
 
 int snd_rawmidi_hw_open(snd_rawmidi_t **input, snd_rawmidi_t **output,
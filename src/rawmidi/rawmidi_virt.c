@@ -36,6 +36,9 @@ const char *_snd_module_rawmidi_virt = "";
 
 
 #ifndef DOC_HIDDEN
+#define VIRT_IN_EVENTS		64	/* events fetched at once */
+#define VIRT_OUT_EVENTS		64	/* events encoded at once */
+
 typedef struct {
 	int open;
 
@@ -44,14 +47,18 @@ typedef struct {
 
 	snd_midi_event_t *midi_event;
 
-	snd_seq_event_t *in_event;
+	snd_seq_event_t *in_events[VIRT_IN_EVENTS];
+	int in_count;
+	int in_pos;
 	int in_buf_size;
 	int in_buf_ofs;
 	char *in_buf_ptr;
 	char in_tmp_buf[16];
 
-	snd_seq_event_t out_event;
-	int pending;
+	snd_seq_event_t out_events[VIRT_OUT_EVENTS];
+	unsigned int pending;		/* events in out_events not sent yet */
+	unsigned char *out_data;	/* payload of the pending events */
+	size_t out_data_size;
 } snd_rawmidi_virtual_t;
 
 int _snd_seq_open_lconf(snd_seq_t **seqp, const char *name, 
@@ -68,6 +75,7 @@ static int snd_rawmidi_virtual_close(snd_rawmidi_t *rmidi)
 	snd_seq_close(virt->handle);
 	if (virt->midi_event)
 		snd_midi_event_free(virt->midi_event);
+	free(virt->out_data);
 	free(virt);
 	return 0;
 }
@@ -165,23 +173,83 @@ static int snd_rawmidi_virtual_drop(snd_rawmidi_t *rmidi)
 	} else {
 		snd_seq_drop_input(virt->handle);
 		snd_midi_event_reset_decode(virt->midi_event);
+		virt->in_count = virt->in_pos = 0;
 		virt->in_buf_ofs = 0;
 	}
 	return 0;
 }
 
+/* send the events left over by the last write */
+static int snd_rawmidi_virtual_flush(snd_rawmidi_virtual_t *virt)
+{
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < virt->pending; i++) {
+		err = snd_seq_event_output(virt->handle, &virt->out_events[i]);
+		if (err < 0) {
+			if (err != -EAGAIN) {
+				/* we got some fatal error. removing these events
+				 * at the next time
+				 */
+				virt->pending = 0;
+				return err;
+			}
+			virt->pending -= i;
+			memmove(virt->out_events, virt->out_events + i,
+				virt->pending * sizeof(snd_seq_event_t));
+			return err;
+		}
+	}
+	virt->pending = 0;
+	return 0;
+}
+
+/* keep the encoded events from first on for the next time; their payload
+ * may point to the caller's buffer, so it's copied
+ */
+static int snd_rawmidi_virtual_keep(snd_rawmidi_virtual_t *virt,
+				    unsigned int first, unsigned int count)
+{
+	snd_seq_event_t *ev;
+	size_t len = 0;
+	unsigned int i;
+
+	count -= first;
+	memmove(virt->out_events, virt->out_events + first,
+		count * sizeof(snd_seq_event_t));
+	for (i = 0; i < count; i++)
+		if (snd_seq_ev_is_variable(&virt->out_events[i]))
+			len += virt->out_events[i].data.ext.len;
+	if (len > virt->out_data_size) {
+		unsigned char *buf = realloc(virt->out_data, len);
+		if (!buf)
+			return -ENOMEM;
+		virt->out_data = buf;
+		virt->out_data_size = len;
+	}
+	len = 0;
+	for (i = 0; i < count; i++) {
+		ev = &virt->out_events[i];
+		if (!snd_seq_ev_is_variable(ev))
+			continue;
+		memcpy(virt->out_data + len, ev->data.ext.ptr, ev->data.ext.len);
+		ev->data.ext.ptr = virt->out_data + len;
+		len += ev->data.ext.len;
+	}
+	virt->pending = count;
+	return 0;
+}
+
 static int snd_rawmidi_virtual_drain(snd_rawmidi_t *rmidi)
 {
 	snd_rawmidi_virtual_t *virt = rmidi->private_data;
 	int err;
 
 	if (rmidi->stream == SND_RAWMIDI_STREAM_OUTPUT) {
-		if (virt->pending) {
-			err = snd_seq_event_output(virt->handle, &virt->out_event);
-			if (err < 0)
-				return err;
-			virt->pending = 0;
-		}
+		err = snd_rawmidi_virtual_flush(virt);
+		if (err < 0)
+			return err;
 		snd_seq_drain_output(virt->handle);
 		snd_seq_sync_output_queue(virt->handle);
 	}
@@ -193,70 +261,102 @@ static ssize_t snd_rawmidi_virtual_write(snd_rawmidi_t *rmidi, const void *buffe
 	snd_rawmidi_virtual_t *virt = rmidi->private_data;
 	ssize_t result = 0;
 	ssize_t size1;
+	unsigned int i, count;
 	int err;
 
-	if (virt->pending) {
-		err = snd_seq_event_output(virt->handle, &virt->out_event);
-		if (err < 0) {
-			if (err != -EAGAIN)
-				/* we got some fatal error. removing this event
-				 * at the next time
-				 */
-				virt->pending = 0;
-			return err;
-		}
-		virt->pending = 0;
-	}
+	err = snd_rawmidi_virtual_flush(virt);
+	if (err < 0)
+		return err;
 
 	while (size > 0) {
-		size1 = snd_midi_event_encode(virt->midi_event, buffer, size, &virt->out_event);
+		/* encode a block of messages at once; complete SysEx
+		 * messages are referred in place, not copied
+		 */
+		memset(virt->out_events, 0, sizeof(virt->out_events));
+		size1 = snd_midi_event_encode_block(virt->midi_event, buffer, size,
+						    virt->out_events,
+						    VIRT_OUT_EVENTS, &count);
 		if (size1 <= 0)
 			break;
 		size -= size1;
 		result += size1;
 		buffer += size1;
-		if (virt->out_event.type == SND_SEQ_EVENT_NONE)
+		if (!count)
 			continue;
-		snd_seq_ev_set_subs(&virt->out_event);
-		snd_seq_ev_set_source(&virt->out_event, virt->port);
-		snd_seq_ev_set_direct(&virt->out_event);
-		err = snd_seq_event_output(virt->handle, &virt->out_event);
-		if (err < 0) {
-			virt->pending = 1;
-			return result > 0 ? result : err;
+		for (i = 0; i < count; i++) {
+			snd_seq_ev_set_subs(&virt->out_events[i]);
+			snd_seq_ev_set_source(&virt->out_events[i], virt->port);
+			snd_seq_ev_set_direct(&virt->out_events[i]);
+		}
+		for (i = 0; i < count; i++) {
+			err = snd_seq_event_output(virt->handle,
+						   &virt->out_events[i]);
+			if (err < 0)
+				break;
+		}
+		if (i < count) {
+			if (err != -EAGAIN)
+				return result > 0 ? result : err;
+			err = snd_rawmidi_virtual_keep(virt, i, count);
+			if (err < 0)
+				return err;
+			break;
 		}
 	}
 
 	if (result > 0)
 		snd_seq_drain_output(virt->handle);
-
 	return result;
 }
 
 static ssize_t snd_rawmidi_virtual_read(snd_rawmidi_t *rmidi, void *buffer, size_t size)
 {
 	snd_rawmidi_virtual_t *virt = rmidi->private_data;
+	snd_seq_event_t *ev;
 	ssize_t result = 0;
 	int size1, err;
 
 	while (size > 0) {
 		if (! virt->in_buf_ofs) {
-			err = snd_seq_event_input_pending(virt->handle, 1);
-			if (err <= 0 && result > 0)
-				return result;
-			err = snd_seq_event_input(virt->handle, &virt->in_event);
-			if (err < 0)
-				return result > 0 ? result : err;
+			if (virt->in_pos >= virt->in_count) {
+				err = snd_seq_event_input_pending(virt->handle, 1);
+				if (err <= 0 && result > 0)
+					return result;
+				err = snd_seq_event_input_batch(virt->handle,
+								virt->in_events,
+								VIRT_IN_EVENTS);
+				if (err <= 0)
+					return result > 0 ? result : err;
+				virt->in_count = err;
+				virt->in_pos = 0;
+			}
+			ev = virt->in_events[virt->in_pos++];
 
-			if (virt->in_event->type == SND_SEQ_EVENT_SYSEX) {
-				virt->in_buf_ptr = virt->in_event->data.ext.ptr;
-				virt->in_buf_size = virt->in_event->data.ext.len;
+			if (ev->type == SND_SEQ_EVENT_SYSEX ?
+			    ev->data.ext.len <= size :
+			    size >= sizeof(virt->in_tmp_buf)) {
+				/* the whole message fits; decode it right
+				 * into the caller's buffer
+				 */
+				size1 = snd_midi_event_decode(virt->midi_event,
+							      buffer, size, ev);
+				if (size1 > 0) {
+					size -= size1;
+					result += size1;
+					buffer += size1;
+				}
+				continue;
+			}
+			if (ev->type == SND_SEQ_EVENT_SYSEX) {
+				snd_midi_event_reset_decode(virt->midi_event);
+				virt->in_buf_ptr = ev->data.ext.ptr;
+				virt->in_buf_size = ev->data.ext.len;
 			} else {
 				virt->in_buf_ptr = virt->in_tmp_buf;
 				virt->in_buf_size = snd_midi_event_decode(virt->midi_event,
 									  (unsigned char *)virt->in_tmp_buf,
 									  sizeof(virt->in_tmp_buf),
-									  virt->in_event);
+									  ev);
 			}
 			if (virt->in_buf_size <= 0)
 				continue;
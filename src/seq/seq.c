@@ -756,6 +756,36 @@ Otherwise, the event is enqueued on output queue of ALSA library
 (not in the kernel!), and will be never processed until
 this queue becomes full.
 
+\subsection seq_ex_shm Direct Delivery via Shared Memory
+
+When both the sender and the receiver open the sequencer with a handle
+of type \c shm (e.g. the \c "shm" name defined in alsa.conf), the events
+with direct delivery addressed to an explicit destination client are
+passed through a shared memory ring of the receiver without going
+through the kernel.  The clients, ports, subscriptions and queues are
+still handled by the kernel sequencer, and all other events
+(scheduled, variable-length, or addressed to subscribers) are sent
+to the kernel as usual.
+\code
+seq.mysynth {
+	type shm
+	ipc_key 0x53510000	# base key; the client number is added
+	ring_size 1024		# number of events, power of two
+}
+\endcode
+A full ring is handled like a full output pool: the write blocks, or
+fails with \c -EAGAIN in non-blocking mode.  A sender of type \c shm
+provides an extra poll descriptor for output, which is signalled when
+the ring has room again.
+The ring delivery skips the port checks of the kernel (existence,
+permissions, event filters and timestamping of the destination port).
+The events of a sender written before an event for the ring are passed
+to the kernel first, but the receiver may still see the events from the
+ring before older events arriving through the kernel.  The input
+alternates between the ring and the kernel, so a busy ring does not
+hold back the kernel events.  A receiver of type \c shm provides two
+poll descriptors for input.
+
 \subsection seq_ex_filter Filter Application
 
 A typical filter program, which receives an event and sends it immediately
@@ -1073,7 +1103,14 @@ int snd_seq_poll_descriptors_count(snd_seq_t *seq, short events)
 		assert(seq->streams & SND_SEQ_OPEN_OUTPUT);
 		result++;
 	}
-	return result ? 1 : 0;
+	if (!result)
+		return 0;
+	result = 1;
+	if ((events & POLLIN) && seq->poll_fd_in >= 0)
+		result++;
+	if ((events & POLLOUT) && seq->poll_fd_out >= 0)
+		result++;
+	return result;
 }
 
 /**
@@ -1097,6 +1134,7 @@ int snd_seq_poll_descriptors_count(snd_seq_t *seq, short events)
 int snd_seq_poll_descriptors(snd_seq_t *seq, struct pollfd *pfds, unsigned int space, short events)
 {
 	short revents = 0;
+	unsigned int count = 1;
 
 	assert(seq);
 	if ((events & POLLIN) && space >= 1) {
@@ -1105,13 +1143,26 @@ int snd_seq_poll_descriptors(snd_seq_t *seq, struct pollfd *pfds, unsigned int s
 	}
 	if ((events & POLLOUT) && space >= 1) {
 		assert(seq->streams & SND_SEQ_OPEN_OUTPUT);
-		revents |= POLLOUT|POLLERR|POLLNVAL;
+		/* the output is signalled by poll_fd_out instead, if any */
+		if (seq->poll_fd_out < 0)
+			revents |= POLLOUT;
+		revents |= POLLERR|POLLNVAL;
 	}
 	if (!revents)
 		return 0;
 	pfds->fd = seq->poll_fd;
 	pfds->events = revents;
-	return 1;
+	if ((events & POLLIN) && seq->poll_fd_in >= 0 && space > count) {
+		pfds[count].fd = seq->poll_fd_in;
+		pfds[count].events = POLLIN|POLLERR|POLLNVAL;
+		count++;
+	}
+	if ((events & POLLOUT) && seq->poll_fd_out >= 0 && space > count) {
+		pfds[count].fd = seq->poll_fd_out;
+		pfds[count].events = POLLIN|POLLERR|POLLNVAL;
+		count++;
+	}
+	return count;
 }
 
 /**
@@ -1126,12 +1177,25 @@ int snd_seq_poll_descriptors(snd_seq_t *seq, struct pollfd *pfds, unsigned int s
  */
 int snd_seq_poll_descriptors_revents(snd_seq_t *seq, struct pollfd *pfds, unsigned int nfds, unsigned short *revents)
 {
+        unsigned int i;
+
         assert(seq && pfds && revents);
-        if (nfds == 1) {
-                *revents = pfds->revents;
-                return 0;
+        if (nfds < 1 || nfds > 3)
+                return -EINVAL;
+        *revents = 0;
+        for (i = 0; i < nfds; i++) {
+                if (i > 0 && pfds[i].fd == seq->poll_fd_out) {
+                        /* readable when the output may proceed */
+                        *revents |= pfds[i].revents & ~POLLIN;
+                        if (pfds[i].revents & POLLIN)
+                                *revents |= POLLOUT;
+                } else if (i == 0 || pfds[i].fd == seq->poll_fd_in) {
+                        *revents |= pfds[i].revents;
+                } else {
+                        return -EINVAL;
+                }
         }
-        return -EINVAL;
+        return 0;
 }
 
 /**
@@ -1268,6 +1332,49 @@ int snd_seq_set_input_buffer_size(snd_seq_t *seq, size_t size)
 		seq->ibuf = newbuf;
 		seq->ibufsize = size;
 	}
+	if (seq->ibufmax < size)
+		seq->ibufmax = size;
+	seq->ibuffull = 0;
+	return 0;
+}
+
+/**
+ * \brief Return the max size of input buffer for adaptive growth
+ * \param seq sequencer handle
+ * \return the max size of input buffer in bytes
+ *
+ * \sa snd_seq_set_input_buffer_max_size()
+ */
+size_t snd_seq_get_input_buffer_max_size(snd_seq_t *seq)
+{
+	assert(seq);
+	if (!seq->ibuf)
+		return 0;
+	return seq->ibufmax * sizeof(snd_seq_event_t);
+}
+
+/**
+ * \brief Set the max size of input buffer for adaptive growth
+ * \param seq sequencer handle
+ * \param size the max size of input buffer in bytes
+ * \return 0 on success otherwise a negative error code
+ *
+ * When the max size is bigger than the current input buffer size,
+ * the input buffer is enlarged twice each time the sequencer fills it
+ * up completely for several reads in a row, until it reaches the
+ * given size.  The buffer is never shrunk automatically.
+ * A size not bigger than the current size disables the growth.
+ *
+ * \sa snd_seq_set_input_buffer_size()
+ */
+int snd_seq_set_input_buffer_max_size(snd_seq_t *seq, size_t size)
+{
+	assert(seq && seq->ibuf);
+	size = (size + sizeof(snd_seq_event_t) - 1) / sizeof(snd_seq_event_t);
+	if (size < seq->ibufsize)
+		size = seq->ibufsize;
+	seq->ibufmax = size;
+	seq->ibuffull = 0;
 	return 0;
 }
 
@@ -3997,6 +4104,150 @@ int snd_seq_event_output_direct(snd_seq_t *seq, snd_seq_event_t *ev)
 	return seq->ops->write(seq, buf, (size_t) len);
 }
 
+/*
+ * keep the unsent part of the iovecs on the output buffer, in order;
+ * the first skip bytes were already accepted by the sequencer.  The
+ * vectors on the output buffer lie at or after their target position,
+ * so they're moved before being overwritten.
+ */
+static void keep_iov(snd_seq_t *seq, const struct iovec *iov, int iovcnt,
+		     size_t skip)
+{
+	size_t pos = 0;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		size_t len = iov[i].iov_len;
+		if (skip >= len) {
+			skip -= len;
+			continue;
+		}
+		len -= skip;
+		memmove(seq->obuf + pos, (const char *)iov[i].iov_base + skip,
+			len);
+		pos += len;
+		skip = 0;
+	}
+	seq->obufused = pos;
+}
+
+/**
+ * \brief output an array of events with a single scatter-gather write
+ * \param seq sequencer handle
+ * \param evs the array of events to be output
+ * \param count the number of events
+ * \return the number of events sent to the sequencer or kept on the
+ *         output buffer, or a negative error code
+ *
+ * The pending events on the output buffer are sent first, then the given
+ * events follow.  The fixed-length event records are passed to the
+ * sequencer directly via an I/O vector; only the variable-length events
+ * are copied to the output buffer, each record together with its data,
+ * since the sequencer takes each vector as whole events.
+ *
+ * The output buffer is not enlarged.  When the sequencer doesn't accept
+ * all events, the rest is kept on the output buffer as far as it fits,
+ * to be sent by #snd_seq_drain_output(), and fewer events than \p count
+ * are returned.  \c -EAGAIN is returned when not even the first event
+ * could be sent or kept.  An event not fitting to the output buffer at
+ * all gives \c -EINVAL, like #snd_seq_event_output_buffer().
+ *
+ * \sa snd_seq_event_output(), snd_seq_drain_output()
+ */
+int snd_seq_event_output_batch(snd_seq_t *seq, snd_seq_event_t *evs,
+			       unsigned int count)
+{
+	struct iovec iov[SND_SEQ_BATCH_IOV];
+	unsigned int i, next, k;
+	int iovcnt, err;
+	ssize_t result, len;
+	size_t total, obufused, var;
+	char *rec;
+
+	assert(seq && (evs || !count));
+	for (i = 0; i < count; i++) {
+		len = snd_seq_event_length(&evs[i]);
+		if (len < 0 || (size_t)len >= seq->obufsize)
+			return -EINVAL;
+	}
+	if (!seq->ops->writev) {
+		for (i = 0; i < count; i++) {
+			err = snd_seq_event_output(seq, &evs[i]);
+			if (err < 0)
+				return i > 0 ? (int)i : err;
+		}
+		snd_seq_drain_output(seq);
+		return count;
+	}
+
+	i = 0;
+	while (i < count) {
+		iovcnt = 0;
+		obufused = seq->obufused;
+		if (obufused) {
+			iov[iovcnt].iov_base = seq->obuf;
+			iov[iovcnt++].iov_len = obufused;
+		}
+		/* take the events fitting to the output buffer together
+		 * with the pending ones, so that the unsent rest can be
+		 * always kept there
+		 */
+		total = obufused;
+		var = 0;
+		for (next = i; next < count && iovcnt + next - i < SND_SEQ_BATCH_IOV;
+		     next++) {
+			len = snd_seq_event_length(&evs[next]);
+			if (total + len > seq->obufsize)
+				break;
+			total += len;
+			if (snd_seq_ev_is_variable(&evs[next]))
+				var += len;
+		}
+		/* the variable-length records go to the end of the buffer */
+		var = seq->obufsize - var;
+		for (k = i; k < next; k++) {
+			snd_seq_event_t *ev = &evs[k];
+			rec = (char *)ev;
+			len = sizeof(*ev);
+			if (snd_seq_ev_is_variable(ev)) {
+				rec = seq->obuf + var;
+				memcpy(rec, ev, sizeof(*ev));
+				memcpy(rec + sizeof(*ev), ev->data.ext.ptr,
+				       ev->data.ext.len);
+				len += ev->data.ext.len;
+				var += len;
+			}
+			/* consecutive records share one vector */
+			if (iovcnt > 0 &&
+			    (char *)iov[iovcnt - 1].iov_base +
+			    iov[iovcnt - 1].iov_len == rec)
+				iov[iovcnt - 1].iov_len += len;
+			else {
+				iov[iovcnt].iov_base = rec;
+				iov[iovcnt++].iov_len = len;
+			}
+		}
+		result = seq->ops->writev(seq, iov, iovcnt);
+		if (result < 0) {
+			if (result != -EAGAIN)
+				return i > 0 ? (int)i : result;
+			result = 0;
+		}
+		if ((size_t)result == total) {
+			seq->obufused = 0;
+			i = next;
+			continue;
+		}
+		/* partially sent: keep the rest, then queue what fits */
+		keep_iov(seq, iov, iovcnt, result);
+		for (i = next; i < count; i++)
+			if (snd_seq_event_output_buffer(seq, &evs[i]) < 0)
+				break;
+		return i > 0 ? (int)i : -EAGAIN;
+	}
+	return count;
+}
+
 /**
  * \brief return the size of pending events on output buffer
  * \param seq sequencer handle
@@ -4089,11 +4340,31 @@ int snd_seq_extract_output(snd_seq_t *seq, snd_seq_event_t **ev_res)
 static ssize_t snd_seq_event_read_buffer(snd_seq_t *seq)
 {
 	ssize_t len;
+
+	/* grow the buffer under sustained load; the old contents are
+	 * already consumed at this point
+	 */
+	if (seq->ibuffull >= SND_SEQ_IBUF_GROW && seq->ibufsize < seq->ibufmax) {
+		size_t size = seq->ibufsize * 2;
+		snd_seq_event_t *newbuf;
+		if (size > seq->ibufmax)
+			size = seq->ibufmax;
+		newbuf = realloc(seq->ibuf, size * sizeof(snd_seq_event_t));
+		if (newbuf) {
+			seq->ibuf = newbuf;
+			seq->ibufsize = size;
+		}
+		seq->ibuffull = 0;
+	}
 	len = (seq->ops->read)(seq, seq->ibuf, seq->ibufsize * sizeof(snd_seq_event_t));
 	if (len < 0)
 		return len;
 	seq->ibuflen = len / sizeof(snd_seq_event_t);
 	seq->ibufptr = 0;
+	if (seq->ibuflen == seq->ibufsize)
+		seq->ibuffull++;
+	else
+		seq->ibuffull = 0;
 	return seq->ibuflen;
 }
 
@@ -4162,21 +4433,70 @@ int snd_seq_event_input(snd_seq_t *seq, snd_seq_event_t **ev)
 	return snd_seq_event_retrieve_buffer(seq, ev);
 }
 
+/**
+ * \brief retrieve multiple events from sequencer at once
+ * \param seq sequencer handle
+ * \param evs array to store the event pointers
+ * \param max the max number of events to retrieve
+ * \return the number of retrieved events or a negative error code
+ *
+ * Like snd_seq_event_input(), but stores the pointers of up to \p max
+ * events available on the input buffer to \p evs.  The sequencer is read
+ * at most once, only when the input buffer is empty.
+ * The events are parsed in place on the input buffer, so the pointers
+ * remain valid only until the next input call on the handle.
+ *
+ * The blocking behavior and the error codes are the same as
+ * snd_seq_event_input().  When a malformed variable-length event is found
+ * after some events have been retrieved, the number of those events is
+ * returned and the rest of the input buffer is dropped.
+ *
+ * \sa snd_seq_event_input(), snd_seq_set_input_buffer_max_size()
+ */
+int snd_seq_event_input_batch(snd_seq_t *seq, snd_seq_event_t **evs,
+			      unsigned int max)
+{
+	unsigned int count = 0;
+	int err;
+
+	assert(seq && evs);
+	if (!max)
+		return 0;
+	if (seq->ibuflen <= 0) {
+		if ((err = snd_seq_event_read_buffer(seq)) < 0)
+			return err;
+	}
+	while (count < max && seq->ibuflen > 0) {
+		err = snd_seq_event_retrieve_buffer(seq, &evs[count]);
+		if (err < 0)
+			return count ? (int)count : err;
+		count++;
+	}
+	return count;
+}
+
 /*
  * read input data from sequencer if available
  */
 static int snd_seq_event_input_feed(snd_seq_t *seq, int timeout)
 {
-	struct pollfd pfd;
-	int err;
-	pfd.fd = seq->poll_fd;
-	pfd.events = POLLIN;
-	err = poll(&pfd, 1, timeout);
+	struct pollfd pfd[2];
+	int err, nfds = 1;
+	pfd[0].fd = seq->poll_fd;
+	pfd[0].events = POLLIN;
+	pfd[0].revents = 0;
+	if (seq->poll_fd_in >= 0) {
+		pfd[1].fd = seq->poll_fd_in;
+		pfd[1].events = POLLIN;
+		pfd[1].revents = 0;
+		nfds++;
+	}
+	err = poll(pfd, nfds, timeout);
 	if (err < 0) {
 		SYSERR("poll");
 		return -errno;
 	}
-	if (pfd.revents & POLLIN) 
+	if ((pfd[0].revents | (nfds > 1 ? pfd[1].revents : 0)) & POLLIN)
 		return snd_seq_event_read_buffer(seq);
 	return seq->ibuflen;
 }
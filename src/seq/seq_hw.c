@@ -33,11 +33,6 @@ const char *_snd_module_seq_hw = "";
 #define SNDRV_FILE_SEQ		ALSA_DEVICE_DIRECTORY "seq"
 #define SNDRV_FILE_ALOADSEQ	ALOAD_DEVICE_DIRECTORY "aloadSEQ"
 #define SNDRV_SEQ_VERSION_MAX	SNDRV_PROTOCOL_VERSION(1, 0, 2)
-
-typedef struct {
-	int fd;
-	int version;
-} snd_seq_hw_t;
 #endif /* DOC_HIDDEN */
 
 static int snd_seq_hw_close(snd_seq_t *seq)
@@ -327,6 +322,15 @@ static ssize_t snd_seq_hw_write(snd_seq_t *seq, void *buf, size_t len)
 	return result;
 }
 
+static ssize_t snd_seq_hw_writev(snd_seq_t *seq, const struct iovec *iov, int iovcnt)
+{
+	snd_seq_hw_t *hw = seq->private_data;
+	ssize_t result = writev(hw->fd, iov, iovcnt);
+	if (result < 0)
+		return -errno;
+	return result;
+}
+
 static ssize_t snd_seq_hw_read(snd_seq_t *seq, void *buf, size_t len)
 {
 	snd_seq_hw_t *hw = seq->private_data;
@@ -390,7 +394,7 @@ static int snd_seq_hw_query_next_port(snd_seq_t *seq, snd_seq_port_info_t *info)
 	return 0;
 }
 
-static const snd_seq_ops_t snd_seq_hw_ops = {
+const snd_seq_ops_t snd_seq_hw_ops = {
 	.close = snd_seq_hw_close,
 	.nonblock = snd_seq_hw_nonblock,
 	.system_info = snd_seq_hw_system_info,
@@ -417,6 +421,7 @@ static const snd_seq_ops_t snd_seq_hw_ops = {
 	.set_queue_info = snd_seq_hw_set_queue_info,
 	.get_named_queue = snd_seq_hw_get_named_queue,
 	.write = snd_seq_hw_write,
+	.writev = snd_seq_hw_writev,
 	.read = snd_seq_hw_read,
 	.remove_events = snd_seq_hw_remove_events,
 	.get_client_pool = snd_seq_hw_get_client_pool,
@@ -508,6 +513,7 @@ int snd_seq_hw_open(snd_seq_t **handle, const char *name, int streams, int mode)
 			close(fd);
 			return -ENOMEM;
 		}
+		seq->ibufmax = seq->ibufsize;
 	}
 	if (name)
 		seq->name = strdup(name);
@@ -517,6 +523,8 @@ int snd_seq_hw_open(snd_seq_t **handle, const char *name, int streams, int mode)
 	seq->tmpbuf = NULL;
 	seq->tmpbufsize = 0;
 	seq->poll_fd = fd;
+	seq->poll_fd_in = -1;
+	seq->poll_fd_out = -1;
 	seq->ops = &snd_seq_hw_ops;
 	seq->private_data = hw;
 	client = snd_seq_hw_client_id(seq);
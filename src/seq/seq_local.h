@@ -26,11 +26,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <sys/uio.h>
 #include "local.h"
 
 #define SND_SEQ_OBUF_SIZE	(16*1024)	/* default size */
 #define SND_SEQ_IBUF_SIZE	500		/* in event_size aligned */
+#define SND_SEQ_IBUF_GROW	4		/* full reads in a row to grow ibuf */
 #define DEFAULT_TMPBUF_SIZE	20
+#define SND_SEQ_BATCH_IOV	64		/* iovecs per writev call */
 
 typedef struct snd_seq_queue_client snd_seq_queue_client_t;
 
@@ -62,6 +65,7 @@ typedef struct {
 	int (*set_queue_info)(snd_seq_t *seq, snd_seq_queue_info_t *info);
 	int (*get_named_queue)(snd_seq_t *seq, snd_seq_queue_info_t *info);
 	ssize_t (*write)(snd_seq_t *seq, void *buf, size_t len);
+	ssize_t (*writev)(snd_seq_t *seq, const struct iovec *iov, int iovcnt);
 	ssize_t (*read)(snd_seq_t *seq, void *buf, size_t len);
 	int (*remove_events)(snd_seq_t *seq, snd_seq_remove_events_t *rmp);
 	int (*get_client_pool)(snd_seq_t *seq, snd_seq_client_pool_t *info);
@@ -70,12 +74,22 @@ typedef struct {
 	int (*query_next_port)(snd_seq_t *seq, snd_seq_port_info_t *info);
 } snd_seq_ops_t;
 
+/* private data of the hw backend */
+typedef struct {
+	int fd;
+	int version;
+} snd_seq_hw_t;
+
+extern const snd_seq_ops_t snd_seq_hw_ops;
+
 struct _snd_seq {
 	char *name;
 	snd_seq_type_t type;
 	int streams;
 	int mode;
 	int poll_fd;
+	int poll_fd_in;		/* additional fd polled for input, -1 if none */
+	int poll_fd_out;	/* fd readable when output may proceed, -1 if none */
 	void *dl_handle;
 	const snd_seq_ops_t *ops;
 	void *private_data;
@@ -88,10 +102,14 @@ struct _snd_seq {
 	size_t ibufptr;		/* current pointer of input buffer */
 	size_t ibuflen;		/* queued length */
 	size_t ibufsize;		/* input buffer size */
+	size_t ibufmax;		/* max size for adaptive growth */
+	unsigned int ibuffull;	/* count of buffer-full reads in a row */
 	snd_seq_event_t *tmpbuf;	/* temporary event for extracted event */
 	size_t tmpbufsize;		/* size of errbuf */
 };
 
 int snd_seq_hw_open(snd_seq_t **handle, const char *name, int streams, int mode);
+int snd_seq_shm_open(snd_seq_t **handle, const char *name, int streams, int mode,
+		     key_t ipc_key, unsigned int ring_size);
 
 #endif
@@ -113,6 +113,43 @@ static const struct status_event_list_t {
 	{SND_SEQ_EVENT_RESET, 		 0, NULL, NULL}, /* 0xff */
 };
 
+/* status_event[] index of each byte of the MIDI stream; ST_DATA for data bytes */
+#define ST_DATA		16
+#define ST_X16(x)	x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x
+static const unsigned char status_type[256] = {
+	ST_X16(ST_DATA), ST_X16(ST_DATA), ST_X16(ST_DATA), ST_X16(ST_DATA),
+	ST_X16(ST_DATA), ST_X16(ST_DATA), ST_X16(ST_DATA), ST_X16(ST_DATA),
+	ST_X16(0), ST_X16(1), ST_X16(2), ST_X16(3),
+	ST_X16(4), ST_X16(5), ST_X16(6),
+	ST_SPECIAL + 0, ST_SPECIAL + 1, ST_SPECIAL + 2, ST_SPECIAL + 3,
+	ST_SPECIAL + 4, ST_SPECIAL + 5, ST_SPECIAL + 6, ST_SPECIAL + 7,
+	ST_SPECIAL + 8, ST_SPECIAL + 9, ST_SPECIAL + 10, ST_SPECIAL + 11,
+	ST_SPECIAL + 12, ST_SPECIAL + 13, ST_SPECIAL + 14, ST_SPECIAL + 15,
+};
+#undef ST_X16
+
+/* status_event[] index + 1 of each sequencer event type, 0 if none */
+static const unsigned char event_status[256] = {
+	[SND_SEQ_EVENT_NOTEOFF] = 0 + 1,
+	[SND_SEQ_EVENT_NOTEON] = 1 + 1,
+	[SND_SEQ_EVENT_KEYPRESS] = 2 + 1,
+	[SND_SEQ_EVENT_CONTROLLER] = 3 + 1,
+	[SND_SEQ_EVENT_PGMCHANGE] = 4 + 1,
+	[SND_SEQ_EVENT_CHANPRESS] = 5 + 1,
+	[SND_SEQ_EVENT_PITCHBEND] = 6 + 1,
+	[SND_SEQ_EVENT_SYSEX] = ST_SPECIAL + 0x0 + 1,
+	[SND_SEQ_EVENT_QFRAME] = ST_SPECIAL + 0x1 + 1,
+	[SND_SEQ_EVENT_SONGPOS] = ST_SPECIAL + 0x2 + 1,
+	[SND_SEQ_EVENT_SONGSEL] = ST_SPECIAL + 0x3 + 1,
+	[SND_SEQ_EVENT_TUNE_REQUEST] = ST_SPECIAL + 0x6 + 1,
+	[SND_SEQ_EVENT_CLOCK] = ST_SPECIAL + 0x8 + 1,
+	[SND_SEQ_EVENT_START] = ST_SPECIAL + 0xa + 1,
+	[SND_SEQ_EVENT_CONTINUE] = ST_SPECIAL + 0xb + 1,
+	[SND_SEQ_EVENT_STOP] = ST_SPECIAL + 0xc + 1,
+	[SND_SEQ_EVENT_SENSING] = ST_SPECIAL + 0xe + 1,
+	[SND_SEQ_EVENT_RESET] = ST_SPECIAL + 0xf + 1,
+};
+
 static int extra_decode_ctrl14(snd_midi_event_t *dev, unsigned char *buf, int len, const snd_seq_event_t *ev);
 static int extra_decode_xrpn(snd_midi_event_t *dev, unsigned char *buf, int count, const snd_seq_event_t *ev);
 
@@ -502,6 +539,163 @@ static void songpos_event(snd_midi_event_t *dev, snd_seq_event_t *ev)
 	ev->data.control.value = (int)dev->buf[2] * 128 + (int)dev->buf[1];
 }
 
+/* encode a complete channel message; d points to the data bytes */
+static void encode_channel(snd_seq_event_t *ev, int type, unsigned char cmd,
+			   const unsigned char *d)
+{
+	ev->type = status_event[type].event;
+	ev->flags &= ~SND_SEQ_EVENT_LENGTH_MASK;
+	ev->flags |= SND_SEQ_EVENT_LENGTH_FIXED;
+	switch (type) {
+	case 0: case 1: case 2:	/* note off, note on, key pressure */
+		ev->data.note.channel = cmd & 0x0f;
+		ev->data.note.note = d[0];
+		ev->data.note.velocity = d[1];
+		break;
+	case 3:			/* controller */
+		ev->data.control.channel = cmd & 0x0f;
+		ev->data.control.param = d[0];
+		ev->data.control.value = d[1];
+		break;
+	case 4: case 5:		/* program change, channel pressure */
+		ev->data.control.channel = cmd & 0x0f;
+		ev->data.control.value = d[0];
+		break;
+	case 6:			/* pitch bend */
+		ev->data.control.channel = cmd & 0x0f;
+		ev->data.control.value = (int)d[1] * 128 + (int)d[0] - 8192;
+		break;
+	}
+}
+
+/* check that the n bytes are all data bytes */
+static inline int all_data(const unsigned char *p, long n)
+{
+	while (n-- > 0)
+		if (*p++ & 0x80)
+			return 0;
+	return 1;
+}
+
+/**
+ * \brief Encodes a block of bytes to sequencer events.
+ * \param[in] dev MIDI event parser.
+ * \param[in] buf Buffer containing bytes of a raw MIDI stream.
+ * \param[in] count Number of bytes in \a buf.
+ * \param[out] evs Array of sequencer events.
+ * \param[in] max Number of events in \a evs.
+ * \param[out] nevs The number of events written to \a evs.
+ * \return The number of bytes consumed, or a negative error code.
+ *
+ * This function encodes as many complete MIDI messages from \a buf as
+ * fit into \a evs, with the same results as calling
+ * #snd_midi_event_encode repeatedly.  Messages lying entirely in \a buf
+ * (including running status) are parsed in one step via a lookup table
+ * instead of byte by byte.  Only the type, the length flags and the data
+ * of each event are set.
+ *
+ * System Exclusive messages (or chunks of them up to the buffer size of
+ * \a dev) that lie entirely in \a buf are not copied: the data pointer of
+ * the event points into \a buf.  Otherwise the message is collected in the
+ * buffer of \a dev, and this function returns after such an event, since
+ * the next one would overwrite it.
+ *
+ * \sa snd_midi_event_encode, snd_midi_event_decode_block
+ */
+long snd_midi_event_encode_block(snd_midi_event_t *dev, const unsigned char *buf,
+				 long count, snd_seq_event_t *evs,
+				 unsigned int max, unsigned int *nevs)
+{
+	long pos = 0, len, qlen;
+	unsigned int n = 0;
+	int type, rc;
+	unsigned char c;
+
+	while (pos < count && n < max) {
+		c = buf[pos];
+		type = status_type[c];
+		if (type >= ST_SPECIAL + 8 && type < ST_DATA) {
+			/* real-time */
+			if (status_event[type].event != SND_SEQ_EVENT_NONE) {
+				evs[n].type = status_event[type].event;
+				evs[n].flags &= ~SND_SEQ_EVENT_LENGTH_MASK;
+				evs[n].flags |= SND_SEQ_EVENT_LENGTH_FIXED;
+				n++;
+			}
+			pos++;
+			continue;
+		}
+		if (type < ST_INVALID) {
+			/* complete channel message */
+			qlen = status_event[type].qlen;
+			if (pos + qlen < count &&
+			    all_data(buf + pos + 1, qlen)) {
+				encode_channel(&evs[n++], type, c,
+					       buf + pos + 1);
+				dev->buf[0] = c;
+				dev->type = type;
+				dev->read = qlen + 1;
+				dev->qlen = 0;
+				pos += qlen + 1;
+				continue;
+			}
+		} else if (type == ST_DATA && dev->qlen == 0 &&
+			   dev->type < ST_INVALID) {
+			/* complete message in running status */
+			qlen = status_event[dev->type].qlen;
+			if (pos + qlen <= count &&
+			    all_data(buf + pos, qlen)) {
+				encode_channel(&evs[n++], dev->type,
+					       dev->buf[0], buf + pos);
+				pos += qlen;
+				continue;
+			}
+		}
+		if (type == ST_SYSEX ||
+		    (type == ST_DATA && dev->type == ST_SYSEX && dev->read == 0)) {
+			/* SysEx (chunk) lying in buf; sent as is */
+			for (len = 1; pos + len <= count; len++) {
+				c = buf[pos + len - 1];
+				if (len > 1 && (c & 0x80))
+					break;
+				if ((size_t)len >= dev->bufsize)
+					break;
+			}
+			if (pos + len <= count &&
+			    (c == MIDI_CMD_COMMON_SYSEX_END ||
+			     (!(c & 0x80) && (size_t)len >= dev->bufsize))) {
+				evs[n].flags &= ~SND_SEQ_EVENT_LENGTH_MASK;
+				evs[n].flags |= SND_SEQ_EVENT_LENGTH_VARIABLE;
+				evs[n].type = SND_SEQ_EVENT_SYSEX;
+				evs[n].data.ext.len = len;
+				evs[n].data.ext.ptr = (void *)(buf + pos);
+				n++;
+				pos += len;
+				if (c == MIDI_CMD_COMMON_SYSEX_END) {
+					reset_encode(dev);
+				} else {
+					/* continue to parse */
+					dev->type = ST_SYSEX;
+					dev->qlen = status_event[ST_SYSEX].qlen;
+					dev->read = 0;
+				}
+				continue;
+			}
+		}
+		/* anything else goes byte by byte */
+		rc = snd_midi_event_encode_byte(dev, buf[pos++], &evs[n]);
+		if (rc < 0)
+			return rc;
+		if (rc > 0) {
+			n++;
+			if (evs[n - 1].type == SND_SEQ_EVENT_SYSEX)
+				break;
+		}
+	}
+	*nevs = n;
+	return pos;
+}
+
 /**
  * \brief Decodes sequencer event to MIDI byte stream.
  * \param[in] dev MIDI event parser.
@@ -563,9 +757,10 @@ long snd_midi_event_decode(snd_midi_event_t *dev, unsigned char *buf, long count
 	if (ev->type == SND_SEQ_EVENT_NONE)
 		return -ENOENT;
 
-	for (type = 0; type < numberof(status_event); type++) {
-		if (ev->type == status_event[type].event)
-			goto __found;
+	type = event_status[ev->type];
+	if (type) {
+		type--;
+		goto __found;
 	}
 	for (type = 0; type < numberof(extra_event); type++) {
 		if (ev->type == extra_event[type].event)
@@ -615,6 +810,72 @@ long snd_midi_event_decode(snd_midi_event_t *dev, unsigned char *buf, long count
 	}
 }
 
+/**
+ * \brief Decodes sequencer events to MIDI byte stream.
+ * \param[in] dev MIDI event parser.
+ * \param[out] buf Buffer for the resulting MIDI byte stream.
+ * \param[in] count Number of bytes in \a buf.
+ * \param[in] evs Array of sequencer events to decode.
+ * \param[in] nevs Number of events in \a evs.
+ * \param[out] done The number of events consumed from \a evs.
+ * \return The number of bytes written to \a buf, or a negative error code.
+ *
+ * This function decodes the events in order, with the same results
+ * as calling #snd_midi_event_decode for each of them, including the
+ * running status handling.  Events that do not correspond to MIDI
+ * messages are skipped.
+ *
+ * The function stops at the first event that does not fit into the rest
+ * of \a buf, or that is invalid.  An error is returned only when this is
+ * the first event.
+ *
+ * \sa snd_midi_event_decode, snd_midi_event_encode_block
+ */
+long snd_midi_event_decode_block(snd_midi_event_t *dev, unsigned char *buf,
+				 long count, const snd_seq_event_t *evs,
+				 unsigned int nevs, unsigned int *done)
+{
+	const snd_seq_event_t *ev;
+	long pos = 0, len;
+	unsigned int i;
+	int type, cmd;
+
+	for (i = 0; i < nevs; i++) {
+		ev = &evs[i];
+		type = event_status[ev->type] - 1;
+		if (type >= 0 && type != ST_SYSEX) {
+			/* fixed-size messages are written in place */
+			if (type >= ST_SPECIAL)
+				cmd = 0xf0 + (type - ST_SPECIAL);
+			else
+				cmd = 0x80 | (type << 4) | (ev->data.note.channel & 0x0f);
+			len = status_event[type].qlen;
+			if ((cmd & 0xf0) == 0xf0 || dev->lastcmd != cmd || dev->nostat)
+				len++;
+			if (count - pos < len)
+				break;
+			if (len > status_event[type].qlen) {
+				dev->lastcmd = cmd;
+				buf[pos++] = cmd;
+			}
+			if (status_event[type].decode)
+				status_event[type].decode(ev, buf + pos);
+			pos += status_event[type].qlen;
+			continue;
+		}
+		len = snd_midi_event_decode(dev, buf + pos, count - pos, ev);
+		if (len == -ENOENT)
+			continue;
+		if (len < 0) {
+			if (!i)
+				return len;
+			break;
+		}
+		pos += len;
+	}
+	*done = i;
+	return pos;
+}
 
 /* decode note event */
 static void note_decode(const snd_seq_event_t *ev, unsigned char *buf)
@@ -0,0 +1,642 @@
+/*
+ *  Sequencer Interface - shared memory backend for direct delivery
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * The client is a normal kernel sequencer client (all ioctls go to the
+ * hw backend), but each client opened for input additionally publishes
+ * a ring of events in a SysV shared memory segment with the key
+ * ipc_key + client number.  Events with direct delivery to an explicit
+ * destination client owning such a ring are put there by the sender
+ * instead of being written to the kernel.  The receiver is woken up via
+ * a datagram on an abstract unix socket only when it sleeps.  A sender
+ * finding the ring full marks itself in the ring and waits for a datagram
+ * on its own socket, which the receiver sends after taking events.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "seq_local.h"
+
+#ifndef PIC
+/* entry for static linking */
+const char *_snd_module_seq_shm = "";
+#endif
+
+#ifndef DOC_HIDDEN
+#define SEQ_SHM_MAGIC		0x53514d52	/* "SQMR" */
+#define SEQ_SHM_MAX_CLIENTS	192
+#define SEQ_SHM_DEFAULT_KEY	0x53510000
+#define SEQ_SHM_DEFAULT_SLOTS	1024
+#define SEQ_SHM_FULL_WAIT	1000		/* ms between checks of the owner */
+#define SEQ_SHM_WAITER_WORDS	((SEQ_SHM_MAX_CLIENTS + 31) / 32)
+
+/* ring placed in the shared segment; multiple producers, one consumer */
+typedef struct {
+	unsigned int magic;
+	unsigned int size;		/* number of slots, power of two */
+	int pid;			/* owner process */
+	int closed;			/* set when the owner closes */
+	unsigned int head;		/* consumer position */
+	unsigned int tail;		/* producer reservation */
+	int armed;			/* consumer sleeps, send a wakeup */
+	unsigned int reserved;
+	unsigned int waiters[SEQ_SHM_WAITER_WORDS]; /* producers on a full ring */
+	struct {
+		unsigned int seq;	/* slot sequence, see ring_push() */
+		snd_seq_event_t ev;
+	} slot[0];
+} snd_seq_shm_ring_t;
+
+/* ring of another client, attached on demand */
+typedef struct {
+	snd_seq_shm_ring_t *ring;
+	time_t retry;			/* next attach attempt */
+} snd_seq_shm_peer_t;
+
+typedef struct {
+	snd_seq_hw_t hw;		/* must be first; the hw ops are reused */
+	snd_seq_ops_t ops;
+	key_t ipc_key;
+	unsigned int ring_size;
+	int shmid;			/* own ring, -1 if none */
+	snd_seq_shm_ring_t *ring;
+	int sock;			/* wakeup socket */
+	int wsock;			/* wakeup socket for a full ring */
+	int blocked;			/* wsock token taken, see seq_shm_push() */
+	int kernel_turn;		/* check the kernel before the ring */
+	snd_seq_shm_peer_t *peers;
+} snd_seq_shm_t;
+#endif
+
+static socklen_t seq_shm_sockaddr(struct sockaddr_un *addr, key_t key,
+				  int out)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	/* abstract namespace, vanishes with the owner */
+	snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1,
+		 out ? "alsa-seq-shm-%x-out" : "alsa-seq-shm-%x",
+		 (unsigned int)key);
+	return offsetof(struct sockaddr_un, sun_path) + 1 +
+		strlen(addr->sun_path + 1);
+}
+
+static int ring_push(snd_seq_shm_ring_t *ring, const snd_seq_event_t *ev)
+{
+	unsigned int pos, seq;
+	int diff;
+
+	pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		seq = __atomic_load_n(&ring->slot[pos & (ring->size - 1)].seq,
+				      __ATOMIC_ACQUIRE);
+		diff = (int)(seq - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&ring->tail, &pos,
+							pos + 1, 1,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			return -EAGAIN;	/* full */
+		} else {
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		}
+	}
+	ring->slot[pos & (ring->size - 1)].ev = *ev;
+	__atomic_store_n(&ring->slot[pos & (ring->size - 1)].seq, pos + 1,
+			 __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int ring_pop(snd_seq_shm_ring_t *ring, snd_seq_event_t *ev)
+{
+	unsigned int head = ring->head;
+	unsigned int idx = head & (ring->size - 1);
+
+	if (__atomic_load_n(&ring->slot[idx].seq, __ATOMIC_ACQUIRE) != head + 1)
+		return 0;
+	*ev = ring->slot[idx].ev;
+	__atomic_store_n(&ring->slot[idx].seq, head + ring->size,
+			 __ATOMIC_RELEASE);
+	ring->head = head + 1;
+	return 1;
+}
+
+static void seq_shm_ring_free(snd_seq_shm_t *shm)
+{
+	if (shm->ring) {
+		__atomic_store_n(&shm->ring->closed, 1, __ATOMIC_SEQ_CST);
+		shmdt(shm->ring);
+		shm->ring = NULL;
+	}
+	if (shm->shmid >= 0) {
+		shmctl(shm->shmid, IPC_RMID, NULL);
+		shm->shmid = -1;
+	}
+}
+
+/* check whether the segment belongs to a dead client */
+static int seq_shm_stale(int shmid)
+{
+	struct shmid_ds buf;
+	snd_seq_shm_ring_t *ring;
+	int stale;
+
+	if (shmctl(shmid, IPC_STAT, &buf) < 0)
+		return 0;
+	if (buf.shm_nattch == 0)
+		return 1;
+	ring = shmat(shmid, NULL, SHM_RDONLY);
+	if (ring == (void *)-1)
+		return 0;
+	stale = ring->magic != SEQ_SHM_MAGIC || ring->closed ||
+		(kill(ring->pid, 0) < 0 && errno == ESRCH);
+	shmdt(ring);
+	return stale;
+}
+
+static int seq_shm_ring_create(snd_seq_t *seq)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+	key_t key = shm->ipc_key + seq->client;
+	size_t size;
+	unsigned int i;
+	int id;
+
+	size = sizeof(*shm->ring) + shm->ring_size * sizeof(shm->ring->slot[0]);
+	for (;;) {
+		shm->shmid = shmget(key, size, IPC_CREAT | IPC_EXCL | 0600);
+		if (shm->shmid >= 0)
+			break;
+		if (errno != EEXIST)
+			return -errno;
+		/* left over by a client with the same number */
+		id = shmget(key, 0, 0600);
+		if (id < 0 || !seq_shm_stale(id)) {
+			SNDERR("seq shm segment 0x%x is busy", (unsigned int)key);
+			return -EBUSY;
+		}
+		shmctl(id, IPC_RMID, NULL);
+	}
+	shm->ring = shmat(shm->shmid, NULL, 0);
+	if (shm->ring == (void *)-1) {
+		shm->ring = NULL;
+		return -errno;
+	}
+	shm->ring->size = shm->ring_size;
+	shm->ring->pid = getpid();
+	for (i = 0; i < shm->ring_size; i++)
+		shm->ring->slot[i].seq = i;
+	shm->ring->armed = 1;
+	__atomic_store_n(&shm->ring->magic, SEQ_SHM_MAGIC, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static snd_seq_shm_ring_t *seq_shm_peer(snd_seq_t *seq, int client)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+	snd_seq_shm_peer_t *peer;
+	snd_seq_shm_ring_t *ring;
+	struct timespec now;
+	int id;
+
+	if (!shm->peers) {
+		shm->peers = calloc(SEQ_SHM_MAX_CLIENTS, sizeof(*shm->peers));
+		if (!shm->peers)
+			return NULL;
+	}
+	peer = &shm->peers[client];
+	if (peer->ring) {
+		if (!__atomic_load_n(&peer->ring->closed, __ATOMIC_RELAXED))
+			return peer->ring;
+		shmdt(peer->ring);
+		peer->ring = NULL;
+		peer->retry = 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec < peer->retry)
+		return NULL;
+	peer->retry = now.tv_sec + 1;
+	id = shmget(shm->ipc_key + client, 0, 0600);
+	if (id < 0)
+		return NULL;
+	ring = shmat(id, NULL, 0);
+	if (ring == (void *)-1)
+		return NULL;
+	if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != SEQ_SHM_MAGIC ||
+	    ring->closed || (kill(ring->pid, 0) < 0 && errno == ESRCH)) {
+		shmdt(ring);
+		return NULL;
+	}
+	peer->ring = ring;
+	return ring;
+}
+
+static void seq_shm_peers_free(snd_seq_shm_t *shm)
+{
+	int i;
+
+	if (!shm->peers)
+		return;
+	for (i = 0; i < SEQ_SHM_MAX_CLIENTS; i++)
+		if (shm->peers[i].ring)
+			shmdt(shm->peers[i].ring);
+	free(shm->peers);
+	shm->peers = NULL;
+}
+
+/* ring of the destination if the event can be delivered there */
+static snd_seq_shm_ring_t *seq_shm_target(snd_seq_t *seq,
+					  const snd_seq_event_t *ev)
+{
+	if ((ev->flags & SND_SEQ_EVENT_LENGTH_MASK) != SND_SEQ_EVENT_LENGTH_FIXED ||
+	    ev->queue != SND_SEQ_QUEUE_DIRECT ||
+	    ev->type >= SND_SEQ_EVENT_CLIENT_START ||
+	    ev->dest.client == SND_SEQ_CLIENT_SYSTEM ||
+	    ev->dest.client >= SEQ_SHM_MAX_CLIENTS)
+		return NULL;
+	return seq_shm_peer(seq, ev->dest.client);
+}
+
+static void seq_shm_drain_socket(int sock)
+{
+	char buf[16];
+
+	while (recv(sock, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+		;
+}
+
+static void seq_shm_send_wakeup(snd_seq_shm_t *shm, key_t key, int out)
+{
+	struct sockaddr_un addr;
+	socklen_t len;
+
+	if (shm->sock < 0)
+		shm->sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC |
+				   SOCK_NONBLOCK, 0);
+	if (shm->sock < 0)
+		return;
+	len = seq_shm_sockaddr(&addr, key, out);
+	sendto(shm->sock, "", 1, MSG_DONTWAIT, (struct sockaddr *)&addr, len);
+}
+
+/*
+ * The wsock of a sender holds a token datagram unless the sender waits
+ * for space in a ring, so it polls for POLLIN exactly when the output
+ * may proceed.
+ */
+static void seq_shm_unblock(snd_seq_t *seq)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+
+	if (!shm->blocked)
+		return;
+	shm->blocked = 0;
+	seq_shm_drain_socket(shm->wsock);
+	seq_shm_send_wakeup(shm, shm->ipc_key + seq->client, 1);
+}
+
+/*
+ * Put the event on the ring.  On a full ring the sender marks itself in
+ * the ring and waits for the wakeup of the consumer, unless in nonblock
+ * mode.  Returns -ENOENT when the owner of the ring went away.
+ */
+static int seq_shm_push(snd_seq_t *seq, snd_seq_shm_ring_t *ring,
+			snd_seq_event_t *ev)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+	unsigned int *waiter = &ring->waiters[seq->client / 32];
+	unsigned int bit = 1U << (seq->client % 32);
+	int client = ev->dest.client;
+	struct pollfd pfd;
+
+	ev->source.client = seq->client;
+	while (ring_push(ring, ev) < 0) {
+		if (__atomic_load_n(&ring->closed, __ATOMIC_RELAXED) ||
+		    (kill(ring->pid, 0) < 0 && errno == ESRCH)) {
+			/* nobody consumes the ring any longer */
+			shmdt(ring);
+			shm->peers[client].ring = NULL;
+			seq_shm_unblock(seq);
+			return -ENOENT;
+		}
+		if (!shm->blocked) {
+			shm->blocked = 1;
+			seq_shm_drain_socket(shm->wsock);
+		}
+		__atomic_fetch_or(waiter, bit, __ATOMIC_SEQ_CST);
+		/* the consumer may have taken events before it saw the mark */
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (ring_push(ring, ev) == 0)
+			break;
+		if (seq->mode & SND_SEQ_NONBLOCK)
+			return -EAGAIN;
+		pfd.fd = shm->wsock;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, SEQ_SHM_FULL_WAIT) < 0)
+			return -errno;
+		seq_shm_drain_socket(shm->wsock);
+	}
+	seq_shm_unblock(seq);
+	if (__atomic_exchange_n(&ring->armed, 0, __ATOMIC_SEQ_CST))
+		seq_shm_send_wakeup(shm, shm->ipc_key + client, 0);
+	return 0;
+}
+
+static ssize_t seq_shm_write_kernel(snd_seq_t *seq, char *buf, size_t len)
+{
+	if (!len)
+		return 0;
+	return snd_seq_hw_ops.write(seq, buf, len);
+}
+
+/*
+ * The events before an event for a ring are written to the kernel first,
+ * so the events of a sender arrive in order.  An event put on a ring is
+ * counted as written, so the caller never sends it again.
+ */
+static ssize_t snd_seq_shm_write(snd_seq_t *seq, void *buf, size_t len)
+{
+	char *ptr = buf;
+	size_t pos = 0, kpos = 0, elen;
+	snd_seq_shm_ring_t *ring;
+	snd_seq_event_t ev;
+	ssize_t result;
+	int err;
+
+	while (pos + sizeof(ev) <= len) {
+		/* the records in the output buffer may be unaligned */
+		memcpy(&ev, ptr + pos, sizeof(ev));
+		elen = snd_seq_event_length(&ev);
+		if (pos + elen > len)
+			break;
+		ring = seq_shm_target(seq, &ev);
+		if (!ring) {
+			pos += elen;
+			continue;
+		}
+		if (kpos < pos) {
+			result = seq_shm_write_kernel(seq, ptr + kpos, pos - kpos);
+			if (result < 0)
+				return kpos ? (ssize_t)kpos : result;
+			kpos += result;
+			if (kpos < pos)
+				return kpos;
+		}
+		err = seq_shm_push(seq, ring, &ev);
+		if (err == -ENOENT) {
+			/* goes to the kernel with the next events */
+			pos += elen;
+			continue;
+		}
+		if (err < 0)
+			return pos ? (ssize_t)pos : err;
+		pos += elen;
+		kpos = pos;
+	}
+	result = seq_shm_write_kernel(seq, ptr + kpos, len - kpos);
+	if (result < 0)
+		return kpos ? (ssize_t)kpos : result;
+	return kpos + result;
+}
+
+/* wake up the senders waiting for space in the own ring */
+static void seq_shm_wake_senders(snd_seq_t *seq)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+	unsigned int i, bits;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (i = 0; i < SEQ_SHM_WAITER_WORDS; i++) {
+		if (!__atomic_load_n(&shm->ring->waiters[i], __ATOMIC_RELAXED))
+			continue;
+		bits = __atomic_exchange_n(&shm->ring->waiters[i], 0,
+					   __ATOMIC_SEQ_CST);
+		while (bits) {
+			seq_shm_send_wakeup(shm, shm->ipc_key + i * 32 +
+					    __builtin_ctz(bits), 1);
+			bits &= bits - 1;
+		}
+	}
+}
+
+static size_t seq_shm_read_ring(snd_seq_t *seq, void *buf, size_t len)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+	snd_seq_event_t *ev = buf;
+	size_t count = 0;
+
+	while ((count + 1) * sizeof(*ev) <= len && ring_pop(shm->ring, ev)) {
+		ev++;
+		count++;
+	}
+	if (count)
+		seq_shm_wake_senders(seq);
+	return count * sizeof(*ev);
+}
+
+/*
+ * The ring and the kernel are read in turns, so the ring traffic does not
+ * starve the events delivered by the kernel (scheduled events,
+ * announcements, non-shm senders).
+ */
+static ssize_t snd_seq_shm_read(snd_seq_t *seq, void *buf, size_t len)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+	struct pollfd pfd[2];
+	size_t result;
+
+	if (shm->kernel_turn) {
+		shm->kernel_turn = 0;
+		pfd[0].fd = shm->hw.fd;
+		pfd[0].events = POLLIN;
+		if (poll(pfd, 1, 0) > 0 && (pfd[0].revents & POLLIN))
+			return snd_seq_hw_ops.read(seq, buf, len);
+	}
+	for (;;) {
+		result = seq_shm_read_ring(seq, buf, len);
+		if (result) {
+			shm->kernel_turn = 1;
+			return result;
+		}
+		/* going to sleep; let the producers wake us up */
+		seq_shm_drain_socket(shm->sock);
+		__atomic_store_n(&shm->ring->armed, 1, __ATOMIC_SEQ_CST);
+		result = seq_shm_read_ring(seq, buf, len);
+		if (result) {
+			shm->kernel_turn = 1;
+			return result;
+		}
+		if (seq->mode & SND_SEQ_NONBLOCK)
+			return snd_seq_hw_ops.read(seq, buf, len);
+		pfd[0].fd = shm->hw.fd;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = shm->sock;
+		pfd[1].events = POLLIN;
+		if (poll(pfd, 2, -1) < 0)
+			return -errno;
+		if (pfd[0].revents & POLLIN)
+			return snd_seq_hw_ops.read(seq, buf, len);
+	}
+}
+
+static int snd_seq_shm_close(snd_seq_t *seq)
+{
+	snd_seq_shm_t *shm = seq->private_data;
+
+	seq_shm_ring_free(shm);
+	seq_shm_peers_free(shm);
+	if (shm->sock >= 0)
+		close(shm->sock);
+	if (shm->wsock >= 0)
+		close(shm->wsock);
+	/* frees shm, too */
+	return snd_seq_hw_ops.close(seq);
+}
+
+int snd_seq_shm_open(snd_seq_t **handle, const char *name, int streams, int mode,
+		     key_t ipc_key, unsigned int ring_size)
+{
+	struct sockaddr_un addr;
+	snd_seq_shm_t *shm;
+	snd_seq_t *seq;
+	socklen_t len;
+	int err;
+
+	if (ring_size < 2 || (ring_size & (ring_size - 1))) {
+		SNDERR("ring_size must be a power of two");
+		return -EINVAL;
+	}
+	err = snd_seq_hw_open(&seq, name, streams, mode);
+	if (err < 0)
+		return err;
+	shm = calloc(1, sizeof(*shm));
+	if (!shm) {
+		snd_seq_close(seq);
+		return -ENOMEM;
+	}
+	shm->hw = *(snd_seq_hw_t *)seq->private_data;
+	free(seq->private_data);
+	shm->ops = snd_seq_hw_ops;
+	shm->ops.close = snd_seq_shm_close;
+	shm->ops.write = snd_seq_shm_write;
+	shm->ops.writev = NULL;
+	shm->ops.read = snd_seq_shm_read;
+	shm->ipc_key = ipc_key;
+	shm->ring_size = ring_size;
+	shm->shmid = -1;
+	shm->sock = -1;
+	shm->wsock = -1;
+	/* the events via the kernel were sent before those still on the ring */
+	shm->kernel_turn = 1;
+	seq->private_data = shm;
+	seq->ops = &shm->ops;
+	seq->type = SND_SEQ_TYPE_SHM;
+
+	if (streams & SND_SEQ_OPEN_INPUT) {
+		shm->sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC |
+				   SOCK_NONBLOCK, 0);
+		if (shm->sock < 0) {
+			err = -errno;
+			goto _err;
+		}
+		len = seq_shm_sockaddr(&addr, ipc_key + seq->client, 0);
+		if (bind(shm->sock, (struct sockaddr *)&addr, len) < 0) {
+			err = -errno;
+			SYSERR("cannot bind the seq shm socket");
+			goto _err;
+		}
+		err = seq_shm_ring_create(seq);
+		if (err < 0)
+			goto _err;
+		seq->poll_fd_in = shm->sock;
+	}
+	if (streams & SND_SEQ_OPEN_OUTPUT) {
+		shm->wsock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC |
+				    SOCK_NONBLOCK, 0);
+		if (shm->wsock < 0) {
+			err = -errno;
+			goto _err;
+		}
+		len = seq_shm_sockaddr(&addr, ipc_key + seq->client, 1);
+		if (bind(shm->wsock, (struct sockaddr *)&addr, len) < 0) {
+			err = -errno;
+			SYSERR("cannot bind the seq shm socket");
+			goto _err;
+		}
+		/* the token, output may proceed */
+		shm->blocked = 1;
+		seq_shm_unblock(seq);
+		seq->poll_fd_out = shm->wsock;
+	}
+	*handle = seq;
+	return 0;
+
+ _err:
+	snd_seq_close(seq);
+	return err;
+}
+
+int _snd_seq_shm_open(snd_seq_t **handlep, char *name,
+		      snd_config_t *root ATTRIBUTE_UNUSED, snd_config_t *conf,
+		      int streams, int mode)
+{
+	snd_config_iterator_t i, next;
+	long ipc_key = SEQ_SHM_DEFAULT_KEY;
+	long ring_size = SEQ_SHM_DEFAULT_SLOTS;
+	int err;
+
+	snd_config_for_each(i, next, conf) {
+		snd_config_t *n = snd_config_iterator_entry(i);
+		const char *id;
+		if (snd_config_get_id(n, &id) < 0)
+			continue;
+		if (_snd_conf_generic_id(id))
+			continue;
+		if (strcmp(id, "ipc_key") == 0) {
+			err = snd_config_get_integer(n, &ipc_key);
+			if (err < 0) {
+				SNDERR("The field ipc_key must be an integer type");
+				return err;
+			}
+			continue;
+		}
+		if (strcmp(id, "ring_size") == 0) {
+			err = snd_config_get_integer(n, &ring_size);
+			if (err < 0 || ring_size <= 0) {
+				SNDERR("Invalid ring_size");
+				return -EINVAL;
+			}
+			continue;
+		}
+		SNDERR("Unknown field %s", id);
+		return -EINVAL;
+	}
+	return snd_seq_shm_open(handlep, name, streams, mode,
+				(key_t)ipc_key, ring_size);
+}
+SND_DLSYM_BUILD_VERSION(_snd_seq_shm_open, SND_SEQ_DLSYM_VERSION);
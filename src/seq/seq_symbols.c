@@ -21,9 +21,11 @@
 #ifndef PIC
 
 extern const char *_snd_module_seq_hw;
+extern const char *_snd_module_seq_shm;
 
 static const char **snd_seq_open_objects[] = {
-	&_snd_module_seq_hw
+	&_snd_module_seq_hw,
+	&_snd_module_seq_shm
 };
 	
 void *snd_seq_open_symbols(void)
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include "seq_local.h"
 
@@ -439,3 +440,390 @@ int snd_seq_parse_address(snd_seq_t *seq, snd_seq_addr_t *addr, const char *arg)
 	return 0;
 }
 
+
+#ifndef DOC_HIDDEN
+struct _snd_seq_queue_clock {
+	snd_seq_t *seq;
+	int queue;
+	int running;
+	unsigned int tempo;		/* us per quarter note */
+	int ppq;
+	unsigned int skew_value;
+	unsigned int skew_base;
+	snd_seq_tick_time_t tick;	/* queue position at the anchor */
+	unsigned long long tick_rem;	/* part of the next tick, in ns * ppq */
+	unsigned long long time;	/* queue time at the anchor, in ns */
+	unsigned long long mono;	/* CLOCK_MONOTONIC at the anchor, in ns */
+};
+#endif
+
+static unsigned long long clock_mono_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* a * b / c, split so that a large a doesn't overflow the product */
+static unsigned long long clock_muldiv(unsigned long long a, unsigned long long b,
+				       unsigned long long c)
+{
+	return a / c * b + a % c * b / c;
+}
+
+static int clock_skewed(snd_seq_queue_clock_t *clock)
+{
+	return clock->skew_base && clock->skew_value &&
+		clock->skew_value != clock->skew_base;
+}
+
+/* queue time elapsed since the anchor, in ns */
+static unsigned long long clock_elapsed(snd_seq_queue_clock_t *clock,
+					unsigned long long now)
+{
+	unsigned long long delta;
+
+	if (!clock->running || now <= clock->mono)
+		return 0;
+	delta = now - clock->mono;
+	if (clock_skewed(clock))
+		delta = clock_muldiv(delta, clock->skew_value, clock->skew_base);
+	return delta;
+}
+
+/* the length of a tick is tempo * 1000 / ppq ns */
+static unsigned long long clock_tick_div(snd_seq_queue_clock_t *clock)
+{
+	return (unsigned long long)clock->tempo * 1000;
+}
+
+/* ticks for the queue time ns after the anchor, optionally the remainder */
+static unsigned long long clock_ns_to_ticks(snd_seq_queue_clock_t *clock,
+					    unsigned long long ns,
+					    unsigned long long *rem)
+{
+	unsigned long long div = clock_tick_div(clock), part;
+
+	if (!div || clock->ppq <= 0) {
+		if (rem)
+			*rem = clock->tick_rem;
+		return 0;
+	}
+	part = ns % div * clock->ppq + clock->tick_rem;
+	if (rem)
+		*rem = part % div;
+	return ns / div * clock->ppq + part / div;
+}
+
+/* queue time in ns from the anchor to the given number of ticks after it */
+static unsigned long long clock_ticks_to_ns(snd_seq_queue_clock_t *clock,
+					    unsigned long long ticks)
+{
+	unsigned long long div = clock_tick_div(clock), ns;
+
+	if (!div || clock->ppq <= 0)
+		return 0;
+	if (!ticks)
+		return 0;
+	ns = clock_muldiv(ticks, div, clock->ppq);
+	/* the anchor lies already tick_rem / ppq ns into the next tick */
+	return ns - clock->tick_rem / clock->ppq;
+}
+
+/* move the anchor by the given queue time, keeping the position */
+static void clock_advance(snd_seq_queue_clock_t *clock, unsigned long long ns)
+{
+	unsigned long long rem;
+
+	clock->tick += clock_ns_to_ticks(clock, ns, &rem);
+	clock->tick_rem = rem;
+	clock->time += ns;
+	if (clock_skewed(clock))
+		ns = clock_muldiv(ns, clock->skew_base, clock->skew_value);
+	clock->mono += ns;
+}
+
+/*
+ * Move the anchor to the position of a queue control event.  The
+ * announcements of the system timer are stamped with the queue position
+ * at which the change took effect; without a usable stamp the time of
+ * the receipt is taken.
+ */
+static void clock_reanchor(snd_seq_queue_clock_t *clock, const snd_seq_event_t *ev)
+{
+	unsigned long long ns, now;
+	long long stamp;
+
+	if (!clock->running)
+		return;
+	if (ev && snd_seq_ev_is_abstime(ev) && ev->queue == clock->queue) {
+		if (snd_seq_ev_is_tick(ev)) {
+			if (ev->time.tick <= clock->tick)
+				return;
+			ns = clock_ticks_to_ns(clock, ev->time.tick - clock->tick);
+			clock->time += ns;
+			if (clock_skewed(clock))
+				ns = clock_muldiv(ns, clock->skew_base,
+						  clock->skew_value);
+			clock->mono += ns;
+			clock->tick = ev->time.tick;
+			clock->tick_rem = 0;
+			return;
+		}
+		stamp = (long long)ev->time.time.tv_sec * 1000000000LL +
+			ev->time.time.tv_nsec;
+		if (stamp > (long long)clock->time)
+			clock_advance(clock, stamp - clock->time);
+		return;
+	}
+	now = clock_mono_ns();
+	clock_advance(clock, clock_elapsed(clock, now));
+	clock->mono = now;
+}
+
+/**
+ * \brief create a client-side clock of a queue
+ * \param clockp the pointer to store the created clock
+ * \param seq sequencer handle
+ * \param q queue id
+ * \return 0 on success otherwise a negative error code
+ *
+ * The clock caches the tempo and a snapshot of the queue status, and
+ * extrapolates the current queue position from \c CLOCK_MONOTONIC without
+ * system calls.  The snapshot is taken at creation and refreshed only by
+ * #snd_seq_queue_clock_sync(); the queue control events (start, stop,
+ * tempo changes...) received by the application should be passed to
+ * #snd_seq_queue_clock_update() to keep the clock in step.
+ *
+ * The extrapolation assumes that the queue timer runs at the speed of
+ * the system clock (corrected by the queue skew).
+ *
+ * \sa snd_seq_queue_clock_free(), snd_seq_get_queue_status()
+ */
+int snd_seq_queue_clock_new(snd_seq_queue_clock_t **clockp, snd_seq_t *seq, int q)
+{
+	snd_seq_queue_clock_t *clock;
+	int err;
+
+	assert(clockp && seq);
+	clock = calloc(1, sizeof(*clock));
+	if (!clock)
+		return -ENOMEM;
+	clock->seq = seq;
+	clock->queue = q;
+	err = snd_seq_queue_clock_sync(clock);
+	if (err < 0) {
+		free(clock);
+		return err;
+	}
+	*clockp = clock;
+	return 0;
+}
+
+/**
+ * \brief free a queue clock
+ * \param clock the queue clock
+ */
+void snd_seq_queue_clock_free(snd_seq_queue_clock_t *clock)
+{
+	free(clock);
+}
+
+/**
+ * \brief resynchronize a queue clock with the sequencer
+ * \param clock the queue clock
+ * \return 0 on success otherwise a negative error code
+ *
+ * Reads the tempo and the status of the queue from the sequencer and
+ * re-anchors the clock to them.
+ */
+int snd_seq_queue_clock_sync(snd_seq_queue_clock_t *clock)
+{
+	snd_seq_queue_tempo_t tempo;
+	snd_seq_queue_status_t status;
+	unsigned long long before, after;
+	int err;
+
+	assert(clock);
+	memset(&tempo, 0, sizeof(tempo));
+	err = snd_seq_get_queue_tempo(clock->seq, clock->queue, &tempo);
+	if (err < 0)
+		return err;
+	memset(&status, 0, sizeof(status));
+	before = clock_mono_ns();
+	err = snd_seq_get_queue_status(clock->seq, clock->queue, &status);
+	if (err < 0)
+		return err;
+	after = clock_mono_ns();
+	clock->tempo = tempo.tempo;
+	clock->ppq = tempo.ppq;
+	clock->skew_value = tempo.skew_value;
+	clock->skew_base = tempo.skew_base;
+	clock->running = status.running;
+	clock->tick = status.tick;
+	clock->tick_rem = 0;
+	clock->time = (unsigned long long)status.time.tv_sec * 1000000000ULL +
+		status.time.tv_nsec;
+	clock->mono = before + (after - before) / 2;
+	return 0;
+}
+
+/**
+ * \brief update a queue clock by a received event
+ * \param clock the queue clock
+ * \param ev the received event
+ * \return 1 if the clock was updated, 0 if the event doesn't concern
+ *         the clock, or a negative error code
+ *
+ * Handles the queue control events (#SND_SEQ_EVENT_START,
+ * #SND_SEQ_EVENT_CONTINUE, #SND_SEQ_EVENT_STOP, #SND_SEQ_EVENT_TEMPO,
+ * #SND_SEQ_EVENT_QUEUE_SKEW, #SND_SEQ_EVENT_SETPOS_TICK and
+ * #SND_SEQ_EVENT_SETPOS_TIME) of the clock's queue, as announced by the
+ * system timer port.  Only the position changes resynchronize via
+ * #snd_seq_queue_clock_sync(); the others are applied locally, at the
+ * queue position stamped on the event (as by the system timer), so the
+ * delay until the event is received doesn't matter.  Start and continue
+ * are anchored at the time of the receipt.
+ */
+int snd_seq_queue_clock_update(snd_seq_queue_clock_t *clock, const snd_seq_event_t *ev)
+{
+	assert(clock && ev);
+	switch (ev->type) {
+	case SND_SEQ_EVENT_START:
+	case SND_SEQ_EVENT_CONTINUE:
+	case SND_SEQ_EVENT_STOP:
+	case SND_SEQ_EVENT_TEMPO:
+	case SND_SEQ_EVENT_QUEUE_SKEW:
+	case SND_SEQ_EVENT_SETPOS_TICK:
+	case SND_SEQ_EVENT_SETPOS_TIME:
+		break;
+	default:
+		return 0;
+	}
+	if (ev->data.queue.queue != clock->queue)
+		return 0;
+	switch (ev->type) {
+	case SND_SEQ_EVENT_START:
+		clock->tick = 0;
+		clock->tick_rem = 0;
+		clock->time = 0;
+		clock->mono = clock_mono_ns();
+		clock->running = 1;
+		break;
+	case SND_SEQ_EVENT_CONTINUE:
+		if (!clock->running)
+			clock->mono = clock_mono_ns();
+		clock->running = 1;
+		break;
+	case SND_SEQ_EVENT_STOP:
+		clock_reanchor(clock, ev);
+		clock->running = 0;
+		break;
+	case SND_SEQ_EVENT_TEMPO:
+		clock_reanchor(clock, ev);
+		/* the part of the tick scales with the tick length */
+		if (clock->tempo)
+			clock->tick_rem = clock_muldiv(clock->tick_rem,
+						       ev->data.queue.param.value,
+						       clock->tempo);
+		clock->tempo = ev->data.queue.param.value;
+		break;
+	case SND_SEQ_EVENT_QUEUE_SKEW:
+		clock_reanchor(clock, ev);
+		clock->skew_value = ev->data.queue.param.skew.value;
+		clock->skew_base = ev->data.queue.param.skew.base;
+		break;
+	default:
+		return snd_seq_queue_clock_sync(clock) < 0 ? -EIO : 1;
+	}
+	return 1;
+}
+
+/**
+ * \brief get the current tick position of a queue clock
+ * \param clock the queue clock
+ * \return the extrapolated tick position
+ */
+snd_seq_tick_time_t snd_seq_queue_clock_get_tick(snd_seq_queue_clock_t *clock)
+{
+	assert(clock);
+	return clock->tick +
+		clock_ns_to_ticks(clock, clock_elapsed(clock, clock_mono_ns()),
+				  NULL);
+}
+
+/**
+ * \brief get the current real-time position of a queue clock
+ * \param clock the queue clock
+ * \param rt the pointer to store the extrapolated time
+ */
+void snd_seq_queue_clock_get_time(snd_seq_queue_clock_t *clock, snd_seq_real_time_t *rt)
+{
+	unsigned long long ns;
+
+	assert(clock && rt);
+	ns = clock->time + clock_elapsed(clock, clock_mono_ns());
+	rt->tv_sec = ns / 1000000000ULL;
+	rt->tv_nsec = ns % 1000000000ULL;
+}
+
+/**
+ * \brief convert a tick position to the real time of a queue clock
+ * \param clock the queue clock
+ * \param tick the tick position
+ * \param rt the pointer to store the real time
+ *
+ * The conversion uses the current tempo, i.e. it's valid until the
+ * next tempo change.
+ */
+void snd_seq_queue_clock_tick_to_time(snd_seq_queue_clock_t *clock,
+				      snd_seq_tick_time_t tick,
+				      snd_seq_real_time_t *rt)
+{
+	unsigned long long ns, delta;
+
+	assert(clock && rt);
+	if (tick >= clock->tick) {
+		ns = clock->time + clock_ticks_to_ns(clock, tick - clock->tick);
+	} else if (clock->ppq > 0) {
+		/* back to the start of the anchor tick, then whole ticks */
+		delta = clock_muldiv(clock->tick - tick, clock_tick_div(clock),
+				     clock->ppq) + clock->tick_rem / clock->ppq;
+		ns = delta < clock->time ? clock->time - delta : 0;
+	} else {
+		ns = clock->time;
+	}
+	rt->tv_sec = ns / 1000000000ULL;
+	rt->tv_nsec = ns % 1000000000ULL;
+}
+
+/**
+ * \brief convert a real time to the tick position of a queue clock
+ * \param clock the queue clock
+ * \param rt the real time
+ * \return the tick position
+ *
+ * The conversion uses the current tempo, i.e. it's valid until the
+ * next tempo change.
+ */
+snd_seq_tick_time_t snd_seq_queue_clock_time_to_tick(snd_seq_queue_clock_t *clock,
+						     const snd_seq_real_time_t *rt)
+{
+	unsigned long long ns, div, part, back;
+
+	assert(clock && rt);
+	ns = (unsigned long long)rt->tv_sec * 1000000000ULL + rt->tv_nsec;
+	if (ns >= clock->time)
+		return clock->tick + clock_ns_to_ticks(clock, ns - clock->time, NULL);
+	div = clock_tick_div(clock);
+	if (!div || clock->ppq <= 0)
+		return clock->tick;
+	/* whole ticks back, and one more if it leaves the anchor tick */
+	ns = clock->time - ns;
+	back = ns / div * clock->ppq;
+	part = ns % div * clock->ppq;
+	if (part > clock->tick_rem)
+		back += (part - clock->tick_rem + div - 1) / div;
+	return back < clock->tick ? clock->tick - back : 0;
+}
@@ -51,6 +51,18 @@ device until resources are not free.
 
 Events are read via snd_timer_read() function.
 
+\section timer_group Timer groups
+
+An application serving many timers (for example a server hosting several
+direct plugin PCM devices) can collect them in a group created with
+snd_timer_group_new(). The timers must be opened with #SND_TIMER_OPEN_TREAD.
+All timers of the group are watched through one epoll descriptor, returned
+by snd_timer_group_poll_descriptor(). snd_timer_group_dispatch() reads the
+queued events of every ready timer in large batches and passes each batch
+to the callback given to snd_timer_group_add().
+snd_timer_group_get_stats() reports how many ticks were merged into later
+tick events (missed wakeups) and how many events the kernel queue dropped.
+
 \section timer_examples Examples
 
 The full featured examples with cross-links:
@@ -403,9 +415,9 @@ int snd_timer_nonblock(snd_timer_t *timer, int nonblock)
 	if ((err = timer->ops->nonblock(timer, nonblock)) < 0)
 		return err;
 	if (nonblock)
-		timer->mode |= SND_TIMER_OPEN_NONBLOCK;
+		timer->mode |= O_NONBLOCK;
 	else
-		timer->mode &= ~SND_TIMER_OPEN_NONBLOCK;
+		timer->mode &= ~O_NONBLOCK;
 	return 0;
 }
 
@@ -0,0 +1,304 @@
+/**
+ * \file timer/timer_group.c
+ * \brief Timer Group Interface
+ * \date 2026
+ *
+ * Timer Group Interface multiplexes the events of many timers.
+ * See \ref timer_group section for more details.
+ */
+/*
+ *  Timer Group Interface - main file
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "timer_local.h"
+#include <sys/epoll.h>
+
+#ifndef DOC_HIDDEN
+#define SND_TIMER_GROUP_BATCH	64	/* tread records per read */
+#define SND_TIMER_GROUP_WAIT	16	/* ready timers per epoll_wait */
+
+typedef struct {
+	struct list_head list;
+	snd_timer_t *timer;		/* NULL = removed while dispatching */
+	snd_timer_group_callback_t callback;
+	void *private_data;
+	snd_timer_group_stats_t stats;
+} snd_timer_group_entry_t;
+
+struct _snd_timer_group {
+	int epoll_fd;
+	int dispatching;
+	struct list_head timers;
+	snd_timer_tread_t buf[SND_TIMER_GROUP_BATCH];
+};
+#endif
+
+static snd_timer_group_entry_t *find_entry(snd_timer_group_t *group,
+					   snd_timer_t *timer)
+{
+	struct list_head *pos;
+	snd_timer_group_entry_t *entry;
+
+	list_for_each(pos, &group->timers) {
+		entry = list_entry(pos, snd_timer_group_entry_t, list);
+		if (entry->timer == timer)
+			return entry;
+	}
+	return NULL;
+}
+
+/**
+ * \brief create a new timer group
+ * \param group returned group handle
+ * \return 0 on success otherwise a negative error code
+ */
+int snd_timer_group_new(snd_timer_group_t **group)
+{
+	snd_timer_group_t *g;
+
+	assert(group);
+	g = calloc(1, sizeof(*g));
+	if (!g)
+		return -ENOMEM;
+	g->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (g->epoll_fd < 0) {
+		int err = -errno;
+		SYSERR("epoll_create1 failed");
+		free(g);
+		return err;
+	}
+	INIT_LIST_HEAD(&g->timers);
+	*group = g;
+	return 0;
+}
+
+/**
+ * \brief free a timer group
+ * \param group group handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * The timers in the group are not closed.
+ */
+int snd_timer_group_free(snd_timer_group_t *group)
+{
+	struct list_head *pos, *npos;
+
+	assert(group);
+	assert(!group->dispatching);
+	list_for_each_safe(pos, npos, &group->timers)
+		free(list_entry(pos, snd_timer_group_entry_t, list));
+	close(group->epoll_fd);
+	free(group);
+	return 0;
+}
+
+/**
+ * \brief add a timer to the group
+ * \param group group handle
+ * \param timer timer handle opened with #SND_TIMER_OPEN_TREAD
+ * \param callback function called with the events read from the timer
+ * \param private_data value passed to the callback
+ * \return 0 on success otherwise a negative error code
+ *
+ * The timer is switched to the nonblocking mode.
+ */
+int snd_timer_group_add(snd_timer_group_t *group, snd_timer_t *timer,
+			snd_timer_group_callback_t callback, void *private_data)
+{
+	snd_timer_group_entry_t *entry;
+	struct epoll_event ev;
+	struct pollfd pfd;
+	int err;
+
+	assert(group && timer && callback);
+	if (!timer->tread)
+		return -EINVAL;
+	if (find_entry(group, timer))
+		return -EBUSY;
+	err = snd_timer_poll_descriptors(timer, &pfd, 1);
+	if (err < 1)
+		return err < 0 ? err : -EIO;
+	err = snd_timer_nonblock(timer, 1);
+	if (err < 0)
+		return err;
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return -ENOMEM;
+	entry->timer = timer;
+	entry->callback = callback;
+	entry->private_data = private_data;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = entry;
+	if (epoll_ctl(group->epoll_fd, EPOLL_CTL_ADD, pfd.fd, &ev) < 0) {
+		err = -errno;
+		SYSERR("EPOLL_CTL_ADD failed");
+		free(entry);
+		return err;
+	}
+	list_add_tail(&entry->list, &group->timers);
+	return 0;
+}
+
+/**
+ * \brief remove a timer from the group
+ * \param group group handle
+ * \param timer timer handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * This function may be called from a callback.
+ */
+int snd_timer_group_remove(snd_timer_group_t *group, snd_timer_t *timer)
+{
+	snd_timer_group_entry_t *entry;
+
+	assert(group && timer);
+	entry = find_entry(group, timer);
+	if (!entry)
+		return -ENOENT;
+	epoll_ctl(group->epoll_fd, EPOLL_CTL_DEL, timer->poll_fd, NULL);
+	if (group->dispatching) {
+		/* the entry may still be in the ready list */
+		entry->timer = NULL;
+		return 0;
+	}
+	list_del(&entry->list);
+	free(entry);
+	return 0;
+}
+
+/**
+ * \brief get the poll descriptor of the group
+ * \param group group handle
+ * \return file descriptor which gets readable when any timer has events
+ *
+ * The descriptor can be added to an application poll loop; call
+ * snd_timer_group_dispatch() with zero timeout when it is readable.
+ */
+int snd_timer_group_poll_descriptor(snd_timer_group_t *group)
+{
+	assert(group);
+	return group->epoll_fd;
+}
+
+/* read all queued events of one timer */
+static int snd_timer_group_drain(snd_timer_group_t *group,
+				 snd_timer_group_entry_t *entry)
+{
+	snd_timer_tread_t *ev;
+	ssize_t result;
+	unsigned int i, count;
+	int total = 0;
+
+	while (entry->timer) {
+		result = snd_timer_read(entry->timer, group->buf, sizeof(group->buf));
+		if (result == -EAGAIN || result == 0)
+			break;
+		if (result < 0)
+			return result;
+		entry->stats.reads++;
+		count = result / sizeof(group->buf[0]);
+		for (i = 0; i < count; i++) {
+			ev = &group->buf[i];
+			if (ev->event != SND_TIMER_EVENT_TICK)
+				continue;
+			/* a tick event covers all ticks since the last one */
+			entry->stats.ticks += ev->val;
+			if (ev->val > 1)
+				entry->stats.missed += ev->val - 1;
+		}
+		entry->stats.events += count;
+		total += count;
+		entry->callback(entry->timer, group->buf, count, entry->private_data);
+		if ((size_t)result < sizeof(group->buf))
+			break;
+	}
+	return total;
+}
+
+/**
+ * \brief wait for timer events and dispatch them
+ * \param group group handle
+ * \param timeout maximum wait in milliseconds, -1 = infinite
+ * \return count of dispatched events otherwise a negative error code
+ *
+ * The events of each ready timer are read in batches and passed to the
+ * callback of the timer, one call per batch.
+ */
+int snd_timer_group_dispatch(snd_timer_group_t *group, int timeout)
+{
+	struct epoll_event evs[SND_TIMER_GROUP_WAIT];
+	struct list_head *pos, *npos;
+	snd_timer_group_entry_t *entry;
+	int i, n, err, total = 0;
+
+	assert(group);
+	n = epoll_wait(group->epoll_fd, evs, SND_TIMER_GROUP_WAIT, timeout);
+	if (n < 0)
+		return -errno;
+	group->dispatching = 1;
+	for (i = 0; i < n; i++) {
+		entry = evs[i].data.ptr;
+		err = snd_timer_group_drain(group, entry);
+		if (err < 0) {
+			total = err;
+			break;
+		}
+		total += err;
+	}
+	group->dispatching = 0;
+	list_for_each_safe(pos, npos, &group->timers) {
+		entry = list_entry(pos, snd_timer_group_entry_t, list);
+		if (!entry->timer) {
+			list_del(&entry->list);
+			free(entry);
+		}
+	}
+	return total;
+}
+
+/**
+ * \brief get the event statistics of a timer in the group
+ * \param group group handle
+ * \param timer timer handle
+ * \param stats returned statistics
+ * \return 0 on success otherwise a negative error code
+ *
+ * The overrun field is taken from the current timer status; it counts
+ * the events lost because the kernel queue was full.
+ */
+int snd_timer_group_get_stats(snd_timer_group_t *group, snd_timer_t *timer,
+			      snd_timer_group_stats_t *stats)
+{
+	snd_timer_group_entry_t *entry;
+	snd_timer_status_t status;
+	int err;
+
+	assert(group && timer && stats);
+	entry = find_entry(group, timer);
+	if (!entry)
+		return -ENOENT;
+	*stats = entry->stats;
+	memset(&status, 0, sizeof(status));
+	err = snd_timer_status(timer, &status);
+	if (err < 0)
+		return err;
+	stats->overrun = snd_timer_status_get_overrun(&status);
+	return 0;
+}
@@ -273,6 +273,7 @@ int snd_timer_hw_open(snd_timer_t **handle, const char *name, int dev_class, int
 	tmr->type = SND_TIMER_TYPE_HW;
 	tmr->version = ver;
 	tmr->mode = tmode;
+	tmr->tread = !!(mode & SND_TIMER_OPEN_TREAD);
 	tmr->name = strdup(name);
 	tmr->poll_fd = fd;
 	tmr->ops = &snd_timer_hw_ops;
@@ -44,6 +44,7 @@ struct _snd_timer {
 	snd_timer_type_t type;
 	int mode;
 	int poll_fd;
+	int tread;		/* reads snd_timer_tread_t records */
 	const snd_timer_ops_t *ops;
 	void *private_data;
 	struct list_head async_handlers;
@@ -72,6 +73,7 @@ int snd_timer_hw_open(snd_timer_t **handle, const char *name, int dev_class, int
 
 int snd_timer_query_hw_open(snd_timer_query_t **handle, const char *name, int mode);
 
+int snd_timer_nonblock(snd_timer_t *timer, int nonblock);
 int snd_timer_async(snd_timer_t *timer, int sig, pid_t pid);
 
 #ifdef INTERNAL
@@ -30,13 +30,31 @@ static ssize_t twrite(snd_tplg_t *tplg, void *data, size_t data_size)
 	return data_size;
 }
 
-/* write out block header to output file */
-static ssize_t write_block_header(snd_tplg_t *tplg, unsigned int type,
-				  unsigned int vendor_type,
-				  unsigned int version, unsigned int index,
-				  size_t payload_size, int count)
+/* reserve the block header, it is completed by finish_block() */
+static ssize_t reserve_block_header(snd_tplg_t *tplg)
+{
+	/* make sure file offset is aligned with the calculated HDR offset */
+	if (tplg->bin_pos != tplg->next_hdr_pos) {
+		SNDERR("New header is at offset 0x%zx but file"
+			" offset 0x%zx is %s by %ld bytes",
+			tplg->next_hdr_pos, tplg->bin_pos,
+			tplg->bin_pos > tplg->next_hdr_pos ? "ahead" : "behind",
+			labs(tplg->bin_pos - tplg->next_hdr_pos));
+		return -EINVAL;
+	}
+	if (tplg->bin_pos + sizeof(struct snd_soc_tplg_hdr) > tplg->bin_size)
+		return -EIO;
+	tplg->bin_pos += sizeof(struct snd_soc_tplg_hdr);
+	return sizeof(struct snd_soc_tplg_hdr);
+}
+
+/* patch the block header when the payload is written */
+static void finish_block(snd_tplg_t *tplg, size_t hdr_pos,
+			 unsigned int type, unsigned int vendor_type,
+			 unsigned int version, unsigned int index, int count)
 {
 	struct snd_soc_tplg_hdr hdr;
+	size_t payload_size = tplg->bin_pos - hdr_pos - sizeof(hdr);
 
 	memset(&hdr, 0, sizeof(hdr));
 	hdr.magic = SND_SOC_TPLG_MAGIC;
@@ -49,100 +67,114 @@ static ssize_t write_block_header(snd_tplg_t *tplg, unsigned int type,
 	hdr.size = sizeof(hdr);
 	hdr.count = count;
 
-	/* make sure file offset is aligned with the calculated HDR offset */
-	if (tplg->bin_pos != tplg->next_hdr_pos) {
-		SNDERR("New header is at offset 0x%zx but file"
-			" offset 0x%zx is %s by %ld bytes",
-			tplg->next_hdr_pos, tplg->bin_pos,
-			tplg->bin_pos > tplg->next_hdr_pos ? "ahead" : "behind",
-			labs(tplg->bin_pos - tplg->next_hdr_pos));
-		return -EINVAL;
-	}
-
-	tplg_log(tplg, 'B', tplg->bin_pos,
+	tplg_log(tplg, 'B', hdr_pos,
 		 "header index %d type %d count %d size 0x%lx/%ld vendor %d "
 		 "version %d", index, type, count,
 		 (long unsigned int)payload_size, (long int)payload_size,
 		 vendor_type, version);
 
-	tplg->next_hdr_pos += hdr.payload_size + sizeof(hdr);
+	memcpy(tplg->bin + hdr_pos, &hdr, sizeof(hdr));
+	tplg->next_hdr_pos = tplg->bin_pos;
+}
 
-	return twrite(tplg, &hdr, sizeof(hdr));
+static inline int elem_written(struct tplg_elem *elem)
+{
+	/* compound elems have already been copied to other elems */
+	return !elem->compound_elem && elem->size > 0;
 }
 
-static int write_elem_block(snd_tplg_t *tplg,
-			    struct list_head *base, size_t size,
-			    int tplg_type, const char *obj_name)
+/* the block of elems with the same index ends after this elem */
+static int block_ends(struct list_head *pos, struct list_head *base)
 {
-	struct list_head *pos, *sub_pos, *sub_base;
 	struct tplg_elem *elem, *elem_next;
-	size_t total_size = 0, count = 0, block_size = 0;
-	ssize_t ret, wsize;
 
-	sub_base = base;
+	elem = list_entry(pos, struct tplg_elem, list);
+	for (pos = pos->next; pos != base; pos = pos->next) {
+		elem_next = list_entry(pos, struct tplg_elem, list);
+		if (!elem_written(elem_next))
+			continue;
+		return elem_next->index != elem->index;
+	}
+	return 1;
+}
+
+/* the unchanged block decoded with the elem, copied verbatim */
+static struct tplg_base_block *kept_block(snd_tplg_t *tplg,
+					  struct tplg_elem *elem, int tplg_type)
+{
+	struct tplg_base_block *block;
+
+	if (!tplg_elem_kept(tplg, elem))
+		return NULL;
+	block = &tplg->base_blocks[elem->base_block];
+	return block->tsoc == tplg_type ? block : NULL;
+}
+
+/* stream the elems of one type, one block for each index */
+static int write_elem_block(snd_tplg_t *tplg, struct list_head *base,
+			    int tplg_type, const char *obj_name)
+{
+	struct list_head *pos;
+	struct tplg_elem *elem;
+	struct tplg_base_block *block;
+	size_t hdr_pos = 0;
+	ssize_t ret;
+	int count = 0;
+
 	list_for_each(pos, base) {
-		/* find elems with the same index to make a block */
 		elem = list_entry(pos, struct tplg_elem, list);
-
-		if (elem->compound_elem)
+		if (!elem_written(elem))
 			continue;
 
-		elem_next = list_entry(pos->next, struct tplg_elem, list);
-		block_size += elem->size;
-		count++;
+		if (count == 0 && (block = kept_block(tplg, elem, tplg_type))) {
+			if (tplg->bin_pos != tplg->next_hdr_pos)
+				return -EINVAL;
+			tplg_log(tplg, 'B', tplg->bin_pos,
+				 "%s index %d: copy %zd bytes", obj_name,
+				 elem->index, block->size);
+			ret = twrite(tplg, tplg->base_bin + block->pos,
+				     block->size);
+			if (ret < 0)
+				return ret;
+			tplg->next_hdr_pos = tplg->bin_pos;
+			while (!block_ends(pos, base))
+				pos = pos->next;
+			continue;
+		}
 
-		if ((pos->next == base) || (elem_next->index != elem->index)) {
-			/* write header for the block */
-			ret = write_block_header(tplg, tplg_type, elem->vendor_type,
-				tplg->version, elem->index, block_size, count);
+		if (count == 0) {
+			hdr_pos = tplg->bin_pos;
+			ret = reserve_block_header(tplg);
 			if (ret < 0) {
 				SNDERR("failed to write %s block %d",
 					obj_name, ret);
 				return ret;
 			}
+		}
 
-			/* write elems for the block */
-			list_for_each(sub_pos, sub_base) {
-				elem = list_entry(sub_pos, struct tplg_elem, list);
-				/* compound elems have already been copied to other elems */
-				if (elem->compound_elem)
-					continue;
-
-				if (elem->type != SND_TPLG_TYPE_DAPM_GRAPH)
-					tplg_log(tplg, 'B', tplg->bin_pos,
-						 "%s '%s': write %d bytes",
-						 obj_name, elem->id, elem->size);
-				else
-					tplg_log(tplg, 'B', tplg->bin_pos,
-						 "%s '%s -> %s -> %s': write %d bytes",
-						 obj_name, elem->route->source,
-						 elem->route->control,
-						 elem->route->sink, elem->size);
-
-				wsize = twrite(tplg, elem->obj, elem->size);
-				if (wsize < 0)
-					return size;
-
-				total_size += wsize;
-				/* get to the end of sub list */
-				if (sub_pos == pos)
-					break;
-			}
-			/* the last elem of the current sub list as the head of 
-			next sub list*/
-			sub_base = pos;
+		if (elem->type != SND_TPLG_TYPE_DAPM_GRAPH)
+			tplg_log(tplg, 'B', tplg->bin_pos,
+				 "%s '%s': write %d bytes",
+				 obj_name, elem->id, elem->size);
+		else
+			tplg_log(tplg, 'B', tplg->bin_pos,
+				 "%s '%s -> %s -> %s': write %d bytes",
+				 obj_name, elem->route->source,
+				 elem->route->control,
+				 elem->route->sink, elem->size);
+
+		ret = twrite(tplg, elem->obj, elem->size);
+		if (ret < 0)
+			return ret;
+		count++;
+
+		if (block_ends(pos, base)) {
+			finish_block(tplg, hdr_pos, tplg_type, elem->vendor_type,
+				     tplg->version, elem->index, count);
 			count = 0;
-			block_size = 0;
 		}
 	}
 
-	/* make sure we have written the correct size */
-	if (total_size != size) {
-		SNDERR("size mismatch. Expected %zu wrote %zu",
-			size, total_size);
-		return -EIO;
-	}
-
 	return 0;
 }
 
@@ -153,63 +185,43 @@ static size_t calc_manifest_size(snd_tplg_t *tplg)
 	       tplg->manifest.priv.size;
 }
 
-static size_t calc_real_size(struct list_head *base)
+static size_t calc_real_size(snd_tplg_t *tplg, struct list_head *base,
+			     int tplg_type)
 {
 	struct list_head *pos;
-	struct tplg_elem *elem, *elem_next;
+	struct tplg_elem *elem;
+	struct tplg_base_block *block;
 	size_t size = 0;
 
 	list_for_each(pos, base) {
 
 		elem = list_entry(pos, struct tplg_elem, list);
-
-		/* compound elems have already been copied to other elems */
-		if (elem->compound_elem)
+		if (!elem_written(elem))
 			continue;
 
-		if (elem->size <= 0)
+		block = kept_block(tplg, elem, tplg_type);
+		if (block) {
+			size += block->size;
+			while (!block_ends(pos, base))
+				pos = pos->next;
 			continue;
+		}
 
 		size += elem->size;
 
-		elem_next = list_entry(pos->next, struct tplg_elem, list);
-
-		if ((pos->next == base) || (elem_next->index != elem->index))
+		if (block_ends(pos, base))
 			size += sizeof(struct snd_soc_tplg_hdr);
 	}
 
 	return size;
 }
 
-static size_t calc_block_size(struct list_head *base)
-{
-	struct list_head *pos;
-	struct tplg_elem *elem;
-	size_t size = 0;
-
-	list_for_each(pos, base) {
-
-		elem = list_entry(pos, struct tplg_elem, list);
-
-		/* compound elems have already been copied to other elems */
-		if (elem->compound_elem)
-			continue;
-
-		size += elem->size;
-	}
-
-	return size;
-}
-
 /* write the manifest including its private data */
 static ssize_t write_manifest_data(snd_tplg_t *tplg)
 {
 	ssize_t ret;
 
-	/* write the header for this block */
-	ret = write_block_header(tplg, SND_SOC_TPLG_TYPE_MANIFEST, 0,
-		tplg->version, 0,
-		sizeof(tplg->manifest) + tplg->manifest.priv.size, 1);
+	ret = reserve_block_header(tplg);
 	if (ret < 0) {
 		SNDERR("failed to write manifest block");
 		return ret;
@@ -224,37 +236,45 @@ static ssize_t write_manifest_data(snd_tplg_t *tplg)
 			 tplg->manifest.priv.size);
 		ret = twrite(tplg, tplg->manifest_pdata, tplg->manifest.priv.size);
 	}
+	if (ret >= 0)
+		finish_block(tplg, 0, SND_SOC_TPLG_TYPE_MANIFEST, 0,
+			     tplg->version, 0, 1);
 	return ret;
 }
 
-int tplg_write_data(snd_tplg_t *tplg)
+/* calculate the size of the binary output */
+size_t tplg_calc_size(snd_tplg_t *tplg)
 {
 	struct tplg_table *tptr;
 	struct list_head *list;
-	ssize_t ret;
-	size_t total_size, size;
+	size_t total_size;
 	unsigned int index;
 
-	/* calculate total size */
 	total_size = calc_manifest_size(tplg);
 	for (index = 0; index < tplg_table_items; index++) {
 		tptr = &tplg_table[index];
 		if (!tptr->build)
 			continue;
 		list = (struct list_head *)((void *)tplg + tptr->loff);
-		size = calc_real_size(list);
-		total_size += size;
+		total_size += calc_real_size(tplg, list, tptr->tsoc);
 	}
+	return total_size;
+}
+
+/*
+ * Write the binary to tplg->bin of tplg->bin_size bytes (see
+ * tplg_calc_size()) in one pass; the block headers are patched when
+ * the block payload is known.
+ */
+int tplg_write_data(snd_tplg_t *tplg)
+{
+	struct tplg_table *tptr;
+	struct list_head *list;
+	ssize_t ret;
+	unsigned int index;
 
-	/* allocate new binary output */
-	free(tplg->bin);
-	tplg->bin = malloc(total_size);
 	tplg->bin_pos = 0;
-	tplg->bin_size = total_size;
-	if (tplg->bin == NULL) {
-		tplg->bin_size = 0;
-		return -ENOMEM;
-	}
+	tplg->next_hdr_pos = 0;
 
 	/* write manifest */
 	ret = write_manifest_data(tplg);
@@ -269,16 +289,11 @@ int tplg_write_data(snd_tplg_t *tplg)
 		if (!tptr->build)
 			continue;
 		list = (struct list_head *)((void *)tplg + tptr->loff);
-		/* calculate the block size in bytes for all elems in this list */
-		size = calc_block_size(list);
-		if (size == 0)
+		if (list_empty(list))
 			continue;
-		tplg_log(tplg, 'B', tplg->bin_pos,
-			 "block size for type %s (%d:%d) is 0x%zx/%zd",
-			 tptr->name, tptr->type,
-			 tptr->tsoc, size, size);
-		ret = write_elem_block(tplg, list, size,
-				       tptr->tsoc, tptr->name);
+		tplg_log(tplg, 'B', tplg->bin_pos, "blocks for type %s (%d:%d)",
+			 tptr->name, tptr->type, tptr->tsoc);
+		ret = write_elem_block(tplg, list, tptr->tsoc, tptr->name);
 		if (ret < 0) {
 			SNDERR("failed to write %s elements: %s",
 						tptr->name, snd_strerror(-ret));
@@ -289,9 +304,9 @@ int tplg_write_data(snd_tplg_t *tplg)
 	tplg_log(tplg, 'B', tplg->bin_pos, "total size is 0x%zx/%zd",
 		 tplg->bin_pos, tplg->bin_pos);
 
-	if (total_size != tplg->bin_pos) {
+	if (tplg->bin_size != tplg->bin_pos) {
 		SNDERR("total size mismatch (%zd != %zd)",
-		       total_size, tplg->bin_pos);
+		       tplg->bin_size, tplg->bin_pos);
 		return -EINVAL;
 	}
 
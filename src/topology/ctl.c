@@ -105,7 +105,7 @@ int parse_access(snd_config_t *cfg,
 
 /* Save Access */
 static int tplg_save_access(snd_tplg_t *tplg ATTRIBUTE_UNUSED,
-			    struct snd_soc_tplg_ctl_hdr *hdr, char **dst,
+			    struct snd_soc_tplg_ctl_hdr *hdr, struct tplg_buf *dst,
 			    const char *pfx)
 {
 	const char *last;
@@ -279,9 +279,11 @@ int tplg_build_controls(snd_tplg_t *tplg)
 	list_for_each(pos, base) {
 
 		elem = list_entry(pos, struct tplg_elem, list);
-		err = tplg_build_mixer_control(tplg, elem);
-		if (err < 0)
-			return err;
+		if (!tplg_elem_kept(tplg, elem)) {
+			err = tplg_build_mixer_control(tplg, elem);
+			if (err < 0)
+				return err;
+		}
 
 		/* add control to manifest */
 		tplg->manifest.control_elems++;
@@ -291,9 +293,11 @@ int tplg_build_controls(snd_tplg_t *tplg)
 	list_for_each(pos, base) {
 
 		elem = list_entry(pos, struct tplg_elem, list);
-		err = tplg_build_enum_control(tplg, elem);
-		if (err < 0)
-			return err;
+		if (!tplg_elem_kept(tplg, elem)) {
+			err = tplg_build_enum_control(tplg, elem);
+			if (err < 0)
+				return err;
+		}
 
 		/* add control to manifest */
 		tplg->manifest.control_elems++;
@@ -303,9 +307,11 @@ int tplg_build_controls(snd_tplg_t *tplg)
 	list_for_each(pos, base) {
 
 		elem = list_entry(pos, struct tplg_elem, list);
-		err = tplg_build_bytes_control(tplg, elem);
-		if (err < 0)
-			return err;
+		if (!tplg_elem_kept(tplg, elem)) {
+			err = tplg_build_bytes_control(tplg, elem);
+			if (err < 0)
+				return err;
+		}
 
 		/* add control to manifest */
 		tplg->manifest.control_elems++;
@@ -399,7 +405,7 @@ int tplg_parse_tlv(snd_tplg_t *tplg, snd_config_t *cfg,
 /* save TLV data */
 int tplg_save_tlv(snd_tplg_t *tplg ATTRIBUTE_UNUSED,
 		  struct tplg_elem *elem,
-		  char **dst, const char *pfx)
+		  struct tplg_buf *dst, const char *pfx)
 {
 	struct snd_soc_tplg_ctl_tlv *tlv = elem->tlv;
 	struct snd_soc_tplg_tlv_dbscale *scale;
@@ -601,7 +607,7 @@ int tplg_parse_control_bytes(snd_tplg_t *tplg,
 /* save control bytes */
 int tplg_save_control_bytes(snd_tplg_t *tplg ATTRIBUTE_UNUSED,
 			    struct tplg_elem *elem,
-			    char **dst, const char *pfx)
+			    struct tplg_buf *dst, const char *pfx)
 {
 	struct snd_soc_tplg_bytes_control *be = elem->bytes_ext;
 	char pfx2[16];
@@ -739,7 +745,7 @@ int tplg_parse_control_enum(snd_tplg_t *tplg, snd_config_t *cfg,
 /* save control eunm */
 int tplg_save_control_enum(snd_tplg_t *tplg ATTRIBUTE_UNUSED,
 			   struct tplg_elem *elem,
-			   char **dst, const char *pfx)
+			   struct tplg_buf *dst, const char *pfx)
 {
 	struct snd_soc_tplg_enum_control *ec = elem->enum_ctrl;
 	char pfx2[16];
@@ -900,7 +906,7 @@ int tplg_parse_control_mixer(snd_tplg_t *tplg,
 }
 
 int tplg_save_control_mixer(snd_tplg_t *tplg ATTRIBUTE_UNUSED,
-			    struct tplg_elem *elem, char **dst,
+			    struct tplg_elem *elem, struct tplg_buf *dst,
 			    const char *pfx)
 {
 	struct snd_soc_tplg_mixer_control *mc = elem->mixer_ctrl;
@@ -1372,7 +1378,7 @@ int tplg_decode_control_enum1(snd_tplg_t *tplg,
 			      void *bin, size_t size)
 {
 	struct snd_soc_tplg_enum_control *ec = bin;
-	struct snd_tplg_channel_map_template cmt;
+	struct snd_tplg_channel_map_template *cmt;
 	int i;
 
 	if (size < sizeof(*ec)) {
@@ -1410,23 +1416,33 @@ int tplg_decode_control_enum1(snd_tplg_t *tplg,
 		et->texts = tplg_calloc(heap, sizeof(char *) * ec->items);
 		if (!et->texts)
 			return -ENOMEM;
-		for (i = 0; ec->items; i++) {
+		et->values = tplg_calloc(heap, sizeof(int *) * ec->items);
+		if (!et->values)
+			return -ENOMEM;
+		for (i = 0; i < (int)ec->items; i++) {
 			unsigned int j = i * sizeof(int) * ENUM_VAL_SIZE;
 			et->texts[i] = ec->texts[i];
-			et->values[i] = (int *)&ec->values[j];
+			/* the same layout as tplg_add_enum(), within the array */
+			if (j + ENUM_VAL_SIZE <= ARRAY_SIZE(ec->values))
+				et->values[i] = (void *)ec->values +
+						j * sizeof(ec->values[0]);
 		}
 	}
 
-	et->map = &cmt;
-	memset(&cmt, 0, sizeof(cmt));
-	cmt.num_channels = ec->num_channels;
-	for (i = 0; i < cmt.num_channels; i++) {
-		struct snd_tplg_channel_elem *channel = &cmt.channel[i];
-		tplg_log(tplg, 'D', pos + ((void *)&ec->channel[i] - (void *)ec),
-			 "enum: channel size %d", ec->channel[i].size);
-		channel->reg = ec->channel[i].reg;
-		channel->shift = ec->channel[i].shift;
-		channel->id = ec->channel[i].id;
+	if (ec->num_channels > 0) {
+		cmt = tplg_calloc(heap, sizeof(*cmt));
+		if (cmt == NULL)
+			return -ENOMEM;
+		cmt->num_channels = ec->num_channels;
+		for (i = 0; i < cmt->num_channels; i++) {
+			struct snd_tplg_channel_elem *channel = &cmt->channel[i];
+			tplg_log(tplg, 'D', pos + ((void *)&ec->channel[i] - (void *)ec),
+				 "enum: channel size %d", ec->channel[i].size);
+			channel->reg = ec->channel[i].reg;
+			channel->shift = ec->channel[i].shift;
+			channel->id = ec->channel[i].id;
+		}
+		et->map = cmt;
 	}
 
 	et->priv = &ec->priv;
@@ -183,9 +183,11 @@ int tplg_build_widgets(snd_tplg_t *tplg)
 			return -EINVAL;
 		}
 
-		err = tplg_build_widget(tplg, elem);
-		if (err < 0)
-			return err;
+		if (!tplg_elem_kept(tplg, elem)) {
+			err = tplg_build_widget(tplg, elem);
+			if (err < 0)
+				return err;
+		}
 
 		/* add widget to manifest */
 		tplg->manifest.widget_elems++;
@@ -260,7 +262,7 @@ struct tplg_elem *tplg_elem_new_route(snd_tplg_t *tplg, int index)
 	struct tplg_elem *elem;
 	struct snd_soc_tplg_dapm_graph_elem *line;
 
-	elem = tplg_elem_new();
+	elem = tplg_elem_new(tplg);
 	if (!elem)
 		return NULL;
 
@@ -272,6 +274,8 @@ struct tplg_elem *tplg_elem_new_route(snd_tplg_t *tplg, int index)
 	strcpy(elem->id, "line");
 	elem->type = SND_TPLG_TYPE_DAPM_GRAPH;
 	elem->size = sizeof(*line);
+	if (tplg->base_blocks)
+		tplg_elem_set_base(tplg, elem, SND_SOC_TPLG_TYPE_DAPM_GRAPH);
 
 	line = calloc(1, sizeof(*line));
 	if (!line) {
@@ -416,7 +420,7 @@ int tplg_parse_dapm_graph(snd_tplg_t *tplg, snd_config_t *cfg,
 }
 
 /* save DAPM graph */
-int tplg_save_dapm_graph(snd_tplg_t *tplg, int index, char **dst, const char *pfx)
+int tplg_save_dapm_graph(snd_tplg_t *tplg, int index, struct tplg_buf *dst, const char *pfx)
 {
 	struct snd_soc_tplg_dapm_graph_elem *route;
 	struct list_head *pos;
@@ -669,7 +673,7 @@ int tplg_parse_dapm_widget(snd_tplg_t *tplg,
 /* save DAPM widget */
 int tplg_save_dapm_widget(snd_tplg_t *tplg ATTRIBUTE_UNUSED,
 			  struct tplg_elem *elem,
-			  char **dst, const char *pfx)
+			  struct tplg_buf *dst, const char *pfx)
 {
 	struct snd_soc_tplg_dapm_widget *widget = elem->widget;
 	const char *s;
@@ -956,7 +960,7 @@ next:
 							 bin, size2);
 			break;
 		case SND_SOC_TPLG_TYPE_ENUM:
-			et = tplg_calloc(&heap, sizeof(*mt));
+			et = tplg_calloc(&heap, sizeof(*et));
 			if (et == NULL) {
 				err = -ENOMEM;
 				goto retval;
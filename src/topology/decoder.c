@@ -15,9 +15,20 @@
   Authors: Jaroslav Kysela <perex@perex.cz>
 */
 
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "list.h"
 #include "tplg_local.h"
 
+#ifndef DOC_HIDDEN
+struct snd_tplg_view {
+	const void *bin;
+	size_t size;
+	size_t pos;		/* next block header */
+	unsigned mapped: 1;
+};
+#endif
+
 int tplg_decode_template(snd_tplg_t *tplg,
 			 size_t pos,
 			 struct snd_soc_tplg_hdr *hdr,
@@ -41,63 +52,136 @@ int tplg_decode_template(snd_tplg_t *tplg,
 	return 0;
 }
 
+/* block size including the header, without 32-bit wrap */
+static inline size_t tplg_block_size(const struct snd_soc_tplg_hdr *hdr)
+{
+	return (size_t)hdr->size + hdr->payload_size;
+}
+
+/* check the block header at pos, the payload follows it */
+static int tplg_decode_header(const void *bin, size_t size, size_t pos)
+{
+	const struct snd_soc_tplg_hdr *hdr;
+
+	if (size - pos < sizeof(*hdr)) {
+		SNDERR("incomplete header data to decode");
+		return -EINVAL;
+	}
+	hdr = bin + pos;
+	if (hdr->magic != SND_SOC_TPLG_MAGIC) {
+		SNDERR("bad block magic %08x", hdr->magic);
+		return -EINVAL;
+	}
+	if (hdr->abi != SND_SOC_TPLG_ABI_VERSION) {
+		SNDERR("unsupported ABI version %d", hdr->abi);
+		return -EINVAL;
+	}
+	if (hdr->size != sizeof(*hdr)) {
+		SNDERR("header size mismatch");
+		return -EINVAL;
+	}
+	if (tplg_block_size(hdr) == 0) {
+		SNDERR("zero block size");
+		return -EINVAL;
+	}
+	if (size - pos < tplg_block_size(hdr)) {
+		SNDERR("incomplete payload data to decode");
+		return -EINVAL;
+	}
+	if (hdr->payload_size < 8) {
+		SNDERR("wrong payload size %d", hdr->payload_size);
+		return -EINVAL;
+	}
+	/* first block must be manifest */
+	if (pos == 0 && hdr->type != SND_SOC_TPLG_TYPE_MANIFEST) {
+		SNDERR("first block must be manifest (value %d)", hdr->type);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/*
+ * Keep a copy of the binary and its blocks, so the blocks without
+ * changes are copied verbatim by the next build.
+ */
+static int tplg_decode_base(snd_tplg_t *tplg, void *bin, size_t size)
+{
+	struct tplg_base_block *blocks, *block;
+	struct snd_soc_tplg_hdr *hdr;
+	unsigned int count, i, j;
+	size_t pos;
+	int err;
+
+	if (tplg->base_bin)
+		return -EBUSY;
+	for (pos = 0, count = 1; pos < size; count++) {
+		err = tplg_decode_header(bin, size, pos);
+		if (err < 0)
+			return err;
+		hdr = bin + pos;
+		pos += tplg_block_size(hdr);
+	}
+	blocks = calloc(count, sizeof(*blocks));
+	if (blocks == NULL)
+		return -ENOMEM;
+	tplg->base_bin = malloc(size);
+	if (tplg->base_bin == NULL) {
+		free(blocks);
+		return -ENOMEM;
+	}
+	memcpy(tplg->base_bin, bin, size);
+	for (pos = 0, i = 1; i < count; i++) {
+		hdr = bin + pos;
+		block = &blocks[i];
+		block->pos = pos;
+		block->size = tplg_block_size(hdr);
+		block->tsoc = hdr->type;
+		block->index = hdr->index;
+		pos += block->size;
+		/* the build writes one block for the type and index */
+		for (j = 1; j < i; j++) {
+			if (blocks[j].tsoc == block->tsoc &&
+			    blocks[j].index == block->index)
+				blocks[j].dirty = block->dirty = 1;
+		}
+	}
+	tplg->base_blocks = blocks;
+	tplg->base_count = count;
+	return 0;
+}
+
 int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags)
 {
 	struct snd_soc_tplg_hdr *hdr;
 	struct tplg_table *tptr;
 	size_t pos;
 	void *b = bin;
-	unsigned int index;
+	unsigned int index, block = 0;
 	int err;
 
-	if (dflags != 0)
+	if (dflags & ~SND_TPLG_DECODE_INCREMENTAL)
 		return -EINVAL;
 	if (tplg == NULL || bin == NULL)
 		return -EINVAL;
+	if (dflags & SND_TPLG_DECODE_INCREMENTAL) {
+		err = tplg_decode_base(tplg, bin, size);
+		if (err < 0)
+			return err;
+	}
 	while (1) {
 		pos = b - bin;
 		if (size == pos) {
 			tplg_log(tplg, 'D', pos, "block: success (total %zd)", size);
 			return 0;
 		}
-		if (size - pos < sizeof(*hdr)) {
-			tplg_log(tplg, 'D', pos, "block: small size");
-			SNDERR("incomplete header data to decode");
-			return -EINVAL;
-		}
+		err = tplg_decode_header(bin, size, pos);
+		if (err < 0)
+			return err;
 		hdr = b;
-		if (hdr->magic != SND_SOC_TPLG_MAGIC) {
-			SNDERR("bad block magic %08x", hdr->magic);
-			return -EINVAL;
-		}
-
 		tplg_log(tplg, 'D', pos, "block: abi %d size %d payload size %d",
 			 hdr->abi, hdr->size, hdr->payload_size);
-		if (hdr->abi != SND_SOC_TPLG_ABI_VERSION) {
-			SNDERR("unsupported ABI version %d", hdr->abi);
-			return -EINVAL;
-		}
-		if (hdr->size != sizeof(*hdr)) {
-			SNDERR("header size mismatch");
-			return -EINVAL;
-		}
 
-		if (size - pos < hdr->size + hdr->payload_size) {
-			SNDERR("incomplete payload data to decode");
-			return -EINVAL;
-		}
-
-		if (hdr->payload_size < 8) {
-			SNDERR("wrong payload size %d", hdr->payload_size);
-			return -EINVAL;
-		}
-
-		/* first block must be manifest */
 		if (b == bin) {
-			if (hdr->type != SND_SOC_TPLG_TYPE_MANIFEST) {
-				SNDERR("first block must be manifest (value %d)", hdr->type);
-				return -EINVAL;
-			}
 			err = snd_tplg_set_version(tplg, hdr->version);
 			if (err < 0)
 				return err;
@@ -114,9 +198,274 @@ int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags)
 			return -EINVAL;
 		}
 		tplg_log(tplg, 'D', pos, "block: type %d - %s", hdr->type, tptr->name);
+		block++;
+		if (tplg->base_blocks)
+			tplg->base_decoding = block;
 		err = tptr->decod(tplg, pos, hdr, b + hdr->size, hdr->payload_size);
+		tplg->base_decoding = 0;
 		if (err < 0)
 			return err;
-		b += hdr->size + hdr->payload_size;
+		b += tplg_block_size(hdr);
+	}
+}
+
+/* map the whole file read-only */
+static int tplg_map_file(const char *filename, void **bin, size_t *size)
+{
+	struct stat st;
+	void *b;
+	int fd, err;
+
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		err = -errno;
+		SNDERR("failed to open %s: %s", filename, strerror(-err));
+		return err;
+	}
+	if (fstat(fd, &st) < 0) {
+		err = -errno;
+		close(fd);
+		return err;
+	}
+	if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+		SNDERR("%s: not a topology file", filename);
+		close(fd);
+		return -EINVAL;
+	}
+	/* private mapping, so the decoders may not write to the file */
+	b = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	err = -errno;
+	close(fd);
+	if (b == MAP_FAILED) {
+		SNDERR("failed to map %s: %s", filename, strerror(-err));
+		return err;
 	}
+	*bin = b;
+	*size = st.st_size;
+	return 0;
+}
+
+int snd_tplg_decode_file(snd_tplg_t *tplg, const char *filename, int dflags)
+{
+	void *bin;
+	size_t size;
+	int err;
+
+	if (tplg == NULL || filename == NULL)
+		return -EINVAL;
+	err = tplg_map_file(filename, &bin, &size);
+	if (err < 0)
+		return err;
+	err = snd_tplg_decode(tplg, bin, size, dflags);
+	munmap(bin, size);
+	return err;
+}
+
+int snd_tplg_view_open(snd_tplg_view_t **view, const char *filename)
+{
+	snd_tplg_view_t *v;
+	void *bin;
+	size_t size;
+	int err;
+
+	if (view == NULL || filename == NULL)
+		return -EINVAL;
+	v = calloc(1, sizeof(*v));
+	if (v == NULL)
+		return -ENOMEM;
+	err = tplg_map_file(filename, &bin, &size);
+	if (err < 0) {
+		free(v);
+		return err;
+	}
+	v->bin = bin;
+	v->size = size;
+	v->mapped = 1;
+	*view = v;
+	return 0;
+}
+
+int snd_tplg_view_open_bin(snd_tplg_view_t **view, const void *bin, size_t size)
+{
+	snd_tplg_view_t *v;
+
+	if (view == NULL || bin == NULL)
+		return -EINVAL;
+	v = calloc(1, sizeof(*v));
+	if (v == NULL)
+		return -ENOMEM;
+	v->bin = bin;
+	v->size = size;
+	*view = v;
+	return 0;
+}
+
+int snd_tplg_view_close(snd_tplg_view_t *view)
+{
+	if (view == NULL)
+		return -EINVAL;
+	if (view->mapped)
+		munmap((void *)view->bin, view->size);
+	free(view);
+	return 0;
+}
+
+void snd_tplg_view_rewind(snd_tplg_view_t *view)
+{
+	view->pos = 0;
+}
+
+int snd_tplg_view_next_block(snd_tplg_view_t *view, snd_tplg_view_block_t *block)
+{
+	const struct snd_soc_tplg_hdr *hdr;
+	unsigned int index;
+	int err;
+
+	if (view == NULL || block == NULL)
+		return -EINVAL;
+	if (view->pos == view->size)
+		return 0;
+	err = tplg_decode_header(view->bin, view->size, view->pos);
+	if (err < 0)
+		return err;
+	hdr = view->bin + view->pos;
+	block->type = -1;
+	for (index = 0; index < tplg_table_items; index++) {
+		if (tplg_table[index].tsoc == (int)hdr->type) {
+			block->type = tplg_table[index].type;
+			break;
+		}
+	}
+	block->asoc_type = hdr->type;
+	block->version = hdr->version;
+	block->vendor_type = hdr->vendor_type;
+	block->index = hdr->index;
+	block->count = hdr->count;
+	block->pos = view->pos;
+	block->payload = (const void *)hdr + hdr->size;
+	block->payload_size = hdr->payload_size;
+	view->pos += tplg_block_size(hdr);
+	return 1;
+}
+
+/* the size and the offset of the private data of an element type */
+#define ELEM_PRIV(type)	sizeof(type), offsetof(type, priv)
+
+/* element size of the given type including the private data */
+static inline int tplg_elem_priv_size(const void *data, size_t avail,
+				      size_t size, size_t priv_offset,
+				      size_t *res)
+{
+	const struct snd_soc_tplg_private *priv = data + priv_offset;
+
+	if (avail < size)
+		return -EINVAL;
+	*res = size + priv->size;
+	return 0;
+}
+
+/* element size including the private data */
+static int tplg_view_elem_size(unsigned int asoc_type, const void *data,
+			       size_t avail, size_t *res)
+{
+	const struct snd_soc_tplg_dapm_widget *w;
+	size_t size, size2;
+	unsigned int index;
+	int err = 0;
+
+	switch (asoc_type) {
+	case SND_SOC_TPLG_TYPE_MANIFEST:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_manifest), res);
+		break;
+	case SND_SOC_TPLG_TYPE_MIXER:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_mixer_control), res);
+		break;
+	case SND_SOC_TPLG_TYPE_ENUM:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_enum_control), res);
+		break;
+	case SND_SOC_TPLG_TYPE_BYTES:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_bytes_control), res);
+		break;
+	case SND_SOC_TPLG_TYPE_PCM:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_pcm), res);
+		break;
+	case SND_SOC_TPLG_TYPE_DAI:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_dai), res);
+		break;
+	case SND_SOC_TPLG_TYPE_DAI_LINK:
+	case SND_SOC_TPLG_TYPE_BACKEND_LINK:
+	case SND_SOC_TPLG_TYPE_CODEC_LINK:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_link_config), res);
+		break;
+	case SND_SOC_TPLG_TYPE_DAPM_GRAPH:
+		*res = sizeof(struct snd_soc_tplg_dapm_graph_elem);
+		break;
+	case SND_SOC_TPLG_TYPE_DAPM_WIDGET:
+		err = tplg_elem_priv_size(data, avail,
+				ELEM_PRIV(struct snd_soc_tplg_dapm_widget), &size);
+		if (err < 0)
+			return err;
+		w = data;
+		/* the kcontrols follow the widget */
+		for (index = 0; index < w->num_kcontrols; index++) {
+			const struct snd_soc_tplg_ctl_hdr *chdr = data + size;
+			if (size > avail || avail - size < sizeof(*chdr))
+				return -EINVAL;
+			if (chdr->type == SND_SOC_TPLG_TYPE_DAPM_WIDGET)
+				return -EINVAL;
+			err = tplg_view_elem_size(chdr->type, chdr,
+						  avail - size, &size2);
+			if (err < 0)
+				return err;
+			size += size2;
+		}
+		*res = size;
+		break;
+	default:
+		/* opaque data, one element */
+		*res = avail;
+		break;
+	}
+	if (err < 0)
+		return err;
+	return *res > avail ? -EINVAL : 0;
+}
+
+int snd_tplg_view_block_next_elem(const snd_tplg_view_block_t *block,
+				  size_t *offset, snd_tplg_view_elem_t *elem)
+{
+	size_t size;
+	int err;
+
+	if (block == NULL || offset == NULL || elem == NULL)
+		return -EINVAL;
+	if (*offset >= block->payload_size)
+		return 0;
+	err = tplg_view_elem_size(block->asoc_type, block->payload + *offset,
+				  block->payload_size - *offset, &size);
+	if (err < 0 || size == 0) {
+		SNDERR("block at %zd: wrong element at offset %zd",
+		       block->pos, *offset);
+		return -EINVAL;
+	}
+	elem->data = block->payload + *offset;
+	elem->size = size;
+	elem->pos = block->pos + sizeof(struct snd_soc_tplg_hdr) + *offset;
+	*offset += size;
+	return 1;
+}
+
+int snd_tplg_view_decode(snd_tplg_view_t *view, snd_tplg_t *tplg, int dflags)
+{
+	if (view == NULL)
+		return -EINVAL;
+	/* the decoders do not modify the input */
+	return snd_tplg_decode(tplg, (void *)view->bin, view->size, dflags);
 }
@@ -287,21 +287,106 @@ void tplg_ref_free_list(struct list_head *base)
 	}
 }
 
-struct tplg_elem *tplg_elem_new(void)
+/*
+ * The elements are allocated from slabs owned by the topology; the freed
+ * ones are kept for reuse until snd_tplg_free().
+ */
+#define TPLG_ELEM_SLAB	128
+
+struct tplg_elem_slab {
+	struct list_head list;
+	struct tplg_elem elem[TPLG_ELEM_SLAB];
+};
+
+struct tplg_elem *tplg_elem_new(snd_tplg_t *tplg)
 {
+	struct tplg_elem_slab *slab;
 	struct tplg_elem *elem;
 
-	elem = calloc(1, sizeof(*elem));
-	if (!elem)
-		return NULL;
+	if (!list_empty(&tplg->elem_free)) {
+		elem = list_entry(tplg->elem_free.next, struct tplg_elem, list);
+		list_del(&elem->list);
+	} else {
+		if (list_empty(&tplg->elem_slabs) ||
+		    tplg->elem_slab_used >= TPLG_ELEM_SLAB) {
+			slab = malloc(sizeof(*slab));
+			if (!slab)
+				return NULL;
+			list_add(&slab->list, &tplg->elem_slabs);
+			tplg->elem_slab_used = 0;
+		}
+		slab = list_entry(tplg->elem_slabs.next,
+				  struct tplg_elem_slab, list);
+		elem = &slab->elem[tplg->elem_slab_used++];
+	}
 
+	memset(elem, 0, sizeof(*elem));
+	elem->tplg = tplg;
 	INIT_LIST_HEAD(&elem->ref_list);
 	return elem;
 }
 
+/* return an element which is not in any list to the slab */
+static void tplg_elem_release(struct tplg_elem *elem)
+{
+	list_add(&elem->list, &elem->tplg->elem_free);
+}
+
+void tplg_elem_slabs_free(snd_tplg_t *tplg)
+{
+	struct list_head *pos, *npos;
+
+	list_for_each_safe(pos, npos, &tplg->elem_slabs) {
+		list_del(pos);
+		free(list_entry(pos, struct tplg_elem_slab, list));
+	}
+	INIT_LIST_HEAD(&tplg->elem_free);
+	tplg->elem_slab_used = 0;
+}
+
+static unsigned int tplg_elem_hash(struct list_head *base, const char *id)
+{
+	unsigned int h = 2166136261u;
+	uintptr_t p = (uintptr_t)base;
+
+	for (; *id; id++)
+		h = (h ^ (unsigned char)*id) * 16777619u;
+	h ^= (unsigned int)(p ^ (p >> 12));
+	return (h ^ (h >> 15)) % TPLG_ELEM_HASH;
+}
+
+/* add the element to the id hash of its list */
+static void tplg_elem_hash_add(struct tplg_elem *elem, struct list_head *base)
+{
+	snd_tplg_t *tplg = elem->tplg;
+	unsigned int h = tplg_elem_hash(base, elem->id);
+
+	elem->hash_base = base;
+	elem->seq = tplg->elem_seq++;
+	elem->hash_next = tplg->elem_hash[h];
+	tplg->elem_hash[h] = elem;
+}
+
+static void tplg_elem_hash_del(struct tplg_elem *elem)
+{
+	struct tplg_elem **e;
+
+	if (!elem->hash_base)
+		return;
+	e = &elem->tplg->elem_hash[tplg_elem_hash(elem->hash_base, elem->id)];
+	for (; *e; e = &(*e)->hash_next) {
+		if (*e == elem) {
+			*e = elem->hash_next;
+			break;
+		}
+	}
+	elem->hash_base = NULL;
+}
+
 void tplg_elem_free(struct tplg_elem *elem)
 {
 	list_del(&elem->list);
+	tplg_elem_hash_del(elem);
 
 	tplg_ref_free_list(&elem->ref_list);
 
@@ -315,7 +400,7 @@ void tplg_elem_free(struct tplg_elem *elem)
 		free(elem->obj);
 	}
 
-	free(elem);
+	tplg_elem_release(elem);
 }
 
 void tplg_elem_free_list(struct list_head *base)
@@ -329,29 +414,128 @@ void tplg_elem_free_list(struct list_head *base)
 	}
 }
 
-struct tplg_elem *tplg_elem_lookup(struct list_head *base, const char* id,
-				   unsigned int type, int index)
+/*
+ * Remember the kept block of the decoded element, or mark the kept block
+ * of the new element type and index as changed. The elements decoded as
+ * a part of another element (widget controls, private data) are not
+ * written on their own.
+ */
+void tplg_elem_set_base(snd_tplg_t *tplg, struct tplg_elem *elem, int tsoc)
+{
+	struct tplg_base_block *block;
+	unsigned int b;
+
+	if (tplg->base_decoding) {
+		elem->base_block = tplg->base_decoding;
+		if (tplg->base_blocks[elem->base_block].tsoc != tsoc)
+			elem->compound_elem = 1;
+		return;
+	}
+	for (b = 1; b < tplg->base_count; b++) {
+		block = &tplg->base_blocks[b];
+		if (block->tsoc == tsoc && block->index == elem->index)
+			block->dirty = 1;
+	}
+}
+
+/* the element is written from its kept block, no build is required */
+int tplg_elem_kept(snd_tplg_t *tplg, struct tplg_elem *elem)
+{
+	return elem->base_block && !tplg->base_blocks[elem->base_block].dirty;
+}
+
+/* count (and clear) the resolved references to the element */
+static int tplg_elem_unref(snd_tplg_t *tplg, struct tplg_elem *elem, int clear)
+{
+	struct list_head *list, *pos, *rpos;
+	struct tplg_elem *e;
+	struct tplg_ref *ref;
+	unsigned int index;
+	int count = 0;
+
+	for (index = 0; index < tplg_table_items; index++) {
+		list = (struct list_head *)((void *)tplg + tplg_table[index].loff);
+		list_for_each(pos, list) {
+			e = list_entry(pos, struct tplg_elem, list);
+			list_for_each(rpos, &e->ref_list) {
+				ref = list_entry(rpos, struct tplg_ref, list);
+				if (ref->elem != elem)
+					continue;
+				count++;
+				if (!clear)
+					continue;
+				/* resolved again by the build */
+				ref->elem = NULL;
+				if (e->base_block)
+					tplg->base_blocks[e->base_block].dirty = 1;
+			}
+		}
+	}
+	return count;
+}
+
+/*
+ * Remove the element. The controls of a widget are removed with it
+ * unless another element uses them.
+ */
+void tplg_elem_remove(snd_tplg_t *tplg, struct tplg_elem *elem)
 {
 	struct list_head *pos;
-	struct tplg_elem *elem;
+	struct tplg_ref *ref;
+	struct tplg_elem *ctl;
+
+	if (elem->base_block)
+		tplg->base_blocks[elem->base_block].dirty = 1;
+	tplg_elem_unref(tplg, elem, 1);
+
+	if (elem->type == SND_TPLG_TYPE_DAPM_WIDGET) {
+		list_for_each(pos, &elem->ref_list) {
+			ref = list_entry(pos, struct tplg_ref, list);
+			ctl = ref->elem;
+			if (ctl == NULL ||
+			    (ref->type != SND_TPLG_TYPE_MIXER &&
+			     ref->type != SND_TPLG_TYPE_ENUM &&
+			     ref->type != SND_TPLG_TYPE_BYTES))
+				continue;
+			ref->elem = NULL;
+			if (tplg_elem_unref(tplg, ctl, 0) == 0)
+				tplg_elem_remove(tplg, ctl);
+		}
+	}
 
-	if (!base || !id)
-		return NULL;
+	tplg_elem_free(elem);
+}
 
-	list_for_each(pos, base) {
+/*
+ * Find the element using the id hash. The lists are sorted by the index,
+ * so the result is the first one in the list order: the lowest index,
+ * then the oldest one.
+ */
+struct tplg_elem *tplg_elem_lookup(struct list_head *base, const char* id,
+				   unsigned int type, int index)
+{
+	snd_tplg_t *tplg;
+	struct tplg_elem *elem, *found = NULL;
 
-		elem = list_entry(pos, struct tplg_elem, list);
+	if (!base || !id || list_empty(base))
+		return NULL;
 
-		if (!strcmp(elem->id, id) && elem->type == type)
-			return elem;
-		/* SND_TPLG_INDEX_ALL is the default value "0" and applicable
-		   for all use cases */
-		if ((index != SND_TPLG_INDEX_ALL)
-			&& (elem->index > index))
-			break;
+	tplg = list_entry(base->next, struct tplg_elem, list)->tplg;
+	elem = tplg->elem_hash[tplg_elem_hash(base, id)];
+	for (; elem; elem = elem->hash_next) {
+		if (elem->hash_base != base || elem->type != type ||
+		    strcmp(elem->id, id))
+			continue;
+		if (!found || elem->index < found->index ||
+		    (elem->index == found->index && elem->seq < found->seq))
+			found = elem;
 	}
 
-	return NULL;
+	/* SND_TPLG_INDEX_ALL is the default value "0" and applicable
+	   for all use cases */
+	if (found && index != SND_TPLG_INDEX_ALL && found->index > index)
+		return NULL;
+	return found;
 }
 
 /* find an element by type */
@@ -390,13 +574,14 @@ void tplg_elem_insert(struct tplg_elem *elem_p, struct list_head *list)
 	struct list_head *pos, *p = &(elem_p->list);
 	struct tplg_elem *elem;
 
-	list_for_each(pos, list) {
+	/* the elements come mostly in order, search from the tail */
+	for (pos = list->prev; pos != list; pos = pos->prev) {
 		elem = list_entry(pos, struct tplg_elem, list);
-		if (elem_p->index < elem->index)
+		if (elem->index <= elem_p->index)
 			break;
 	}
-	/* insert item before pos */
-	list_insert(p, pos->prev, pos);
+	/* insert item after pos */
+	list_insert(p, pos, pos->next);
 }
 
 /* create a new common element and object */
@@ -418,7 +603,7 @@ struct tplg_elem* tplg_elem_new_common(snd_tplg_t *tplg,
 	if (!cfg && !name)
 		return NULL;
 
-	elem = tplg_elem_new();
+	elem = tplg_elem_new(tplg);
 	if (!elem)
 		return NULL;
 
@@ -435,17 +620,20 @@ struct tplg_elem* tplg_elem_new_common(snd_tplg_t *tplg,
 				continue;
 			if (strcmp(id, "index") == 0) {
 				if (tplg_get_integer(n, &elem->index, 0)) {
-					free(elem);
+					tplg_elem_release(elem);
 					return NULL;
 				}
 				if (elem->index < 0) {
-					free(elem);
+					tplg_elem_release(elem);
 					return NULL;
 				}
 			}
 		}
-	} else if (name != NULL)
+	} else if (name != NULL) {
 		snd_strlcpy(elem->id, name, SNDRV_CTL_ELEM_ID_NAME_MAXLEN);
+		/* index of the object template being added */
+		elem->index = tplg->index;
+	}
 
 	for (index = 0; index < tplg_table_items; index++) {
 		tptr = &tplg_table[index];
@@ -456,12 +644,15 @@ struct tplg_elem* tplg_elem_new_common(snd_tplg_t *tplg,
 		break;
 	}
 	if (index >= tplg_table_items) {
-		free(elem);
+		tplg_elem_release(elem);
 		return NULL;
 	}
 
 	list = (struct list_head *)((void *)tplg + tptr->loff);
 	tplg_elem_insert(elem, list);
+	tplg_elem_hash_add(elem, list);
+	if (tplg->base_blocks)
+		tplg_elem_set_base(tplg, elem, tptr->tsoc);
 	obj_size = tptr->size;
 	elem->free = tptr->free;
 	elem->table = tptr;
@@ -470,7 +661,7 @@ struct tplg_elem* tplg_elem_new_common(snd_tplg_t *tplg,
 	if (obj_size > 0) {
 		obj = calloc(1, obj_size);
 		if (obj == NULL) {
-			free(elem);
+			tplg_elem_free(elem);
 			return NULL;
 		}
 
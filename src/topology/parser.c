@@ -18,6 +18,7 @@
 */
 
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include "list.h"
 #include "tplg_local.h"
 
@@ -280,12 +281,28 @@ static int tplg_build(snd_tplg_t *tplg)
 {
 	int err;
 
+	/* the element counts are accumulated by the build */
+	tplg->manifest.control_elems = 0;
+	tplg->manifest.widget_elems = 0;
+	tplg->manifest.graph_elems = 0;
+	tplg->manifest.pcm_elems = 0;
+	tplg->manifest.dai_link_elems = 0;
+	tplg->manifest.dai_elems = 0;
+
 	err = tplg_build_integ(tplg);
 	if (err < 0) {
 		SNDERR("failed to check topology integrity");
 		return err;
 	}
 
+	return 0;
+}
+
+/* write the binary to the prepared tplg->bin area */
+static int tplg_build_write(snd_tplg_t *tplg)
+{
+	int err;
+
 	err = tplg_write_data(tplg);
 	if (err < 0) {
 		SNDERR("failed to write data %d", err);
@@ -294,6 +311,55 @@ static int tplg_build(snd_tplg_t *tplg)
 	return 0;
 }
 
+/* allocate the binary output in memory and write it */
+static int tplg_build_alloc(snd_tplg_t *tplg, size_t size)
+{
+	free(tplg->bin);
+	tplg->bin = malloc(size);
+	tplg->bin_pos = 0;
+	tplg->bin_size = size;
+	if (tplg->bin == NULL) {
+		tplg->bin_size = 0;
+		return -ENOMEM;
+	}
+	return tplg_build_write(tplg);
+}
+
+/*
+ * Write the binary directly to the memory mapped output file.
+ * The file blocks are allocated first, so a full disk is an error here
+ * and not a SIGBUS later. Returns -ENODEV when the file cannot be mapped
+ * or its space cannot be reserved.
+ */
+static int tplg_build_mmap(snd_tplg_t *tplg, int fd, size_t size)
+{
+	struct stat st;
+	void *map;
+	int err;
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || size == 0)
+		return -ENODEV;
+	if (posix_fallocate(fd, 0, size) != 0)
+		return -ENODEV;
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		return -ENODEV;
+	free(tplg->bin);
+	tplg->bin = map;
+	tplg->bin_pos = 0;
+	tplg->bin_size = size;
+	err = tplg_build_write(tplg);
+	if (munmap(map, size) < 0 && err >= 0) {
+		err = -errno;
+		SNDERR("munmap error: %s", strerror(errno));
+	}
+	tplg->bin = NULL;
+	tplg->bin_size = tplg->bin_pos = 0;
+	if (err < 0 && ftruncate(fd, 0) < 0)
+		err = -errno;
+	return err;
+}
+
 int snd_tplg_build_file(snd_tplg_t *tplg,
 			const char *infile,
 			const char *outfile)
@@ -323,7 +389,7 @@ int snd_tplg_build_file(snd_tplg_t *tplg,
 	return snd_tplg_build(tplg, outfile);
 }
 
-int snd_tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t)
+static int tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t)
 {
 	switch (t->type) {
 	case SND_TPLG_TYPE_MIXER:
@@ -350,10 +416,132 @@ int snd_tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t)
 	};
 }
 
+int snd_tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t)
+{
+	int err;
+
+	tplg->index = t->index;
+	err = tplg_add_object(tplg, t);
+	tplg->index = 0;
+	return err;
+}
+
+/* find the element with the exact index */
+static struct tplg_elem *tplg_remove_lookup(struct list_head *base,
+					    const char *id,
+					    unsigned int type, int index)
+{
+	struct list_head *pos;
+	struct tplg_elem *elem;
+
+	if (id == NULL)
+		return NULL;
+	list_for_each(pos, base) {
+		elem = list_entry(pos, struct tplg_elem, list);
+		if (elem->type == type && elem->index == index &&
+		    strcmp(elem->id, id) == 0)
+			return elem;
+	}
+	return NULL;
+}
+
+static int tplg_remove_graph_object(snd_tplg_t *tplg,
+				    snd_tplg_obj_template_t *t)
+{
+	struct snd_tplg_graph_template *gt = t->graph;
+	struct snd_tplg_graph_elem *ge;
+	struct snd_soc_tplg_dapm_graph_elem *route;
+	struct list_head *pos, *npos;
+	struct tplg_elem *elem;
+	int i, found;
+
+	for (i = 0; i < gt->count; i++) {
+		ge = &gt->elem[i];
+		found = 0;
+		list_for_each_safe(pos, npos, &tplg->route_list) {
+			elem = list_entry(pos, struct tplg_elem, list);
+			route = elem->route;
+			if (elem->index != t->index ||
+			    strcmp(route->source, ge->src) ||
+			    strcmp(route->sink, ge->sink) ||
+			    strcmp(route->control, ge->ctl ? ge->ctl : ""))
+				continue;
+			tplg_elem_remove(tplg, elem);
+			found = 1;
+			break;
+		}
+		if (!found) {
+			SNDERR("route %s -> %s -> %s not found", ge->src,
+			       ge->ctl ? ge->ctl : "", ge->sink);
+			return -ENOENT;
+		}
+	}
+	return 0;
+}
+
+int snd_tplg_remove_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t)
+{
+	struct list_head *base;
+	struct tplg_elem *elem;
+	unsigned int type = t->type;
+	const char *id;
+
+	switch (t->type) {
+	case SND_TPLG_TYPE_MIXER:
+		base = &tplg->mixer_list;
+		id = t->mixer->hdr.name;
+		break;
+	case SND_TPLG_TYPE_ENUM:
+		base = &tplg->enum_list;
+		id = t->enum_ctl->hdr.name;
+		break;
+	case SND_TPLG_TYPE_BYTES:
+		base = &tplg->bytes_ext_list;
+		id = t->bytes_ctl->hdr.name;
+		break;
+	case SND_TPLG_TYPE_DAPM_WIDGET:
+		base = &tplg->widget_list;
+		id = t->widget->name;
+		break;
+	case SND_TPLG_TYPE_DAPM_GRAPH:
+		return tplg_remove_graph_object(tplg, t);
+	case SND_TPLG_TYPE_PCM:
+		base = &tplg->pcm_list;
+		id = t->pcm->pcm_name;
+		break;
+	case SND_TPLG_TYPE_DAI:
+		base = &tplg->dai_list;
+		id = t->dai->dai_name;
+		break;
+	case SND_TPLG_TYPE_LINK:
+	case SND_TPLG_TYPE_BE:
+		base = &tplg->be_list;
+		type = SND_TPLG_TYPE_BE;
+		id = t->link->name;
+		break;
+	case SND_TPLG_TYPE_CC:
+		base = &tplg->cc_list;
+		id = t->link->name;
+		break;
+	default:
+		SNDERR("invalid object type %d", t->type);
+		return -EINVAL;
+	}
+
+	elem = tplg_remove_lookup(base, id, type, t->index);
+	if (elem == NULL) {
+		SNDERR("object '%s' not found", id ? id : "");
+		return -ENOENT;
+	}
+	tplg_elem_remove(tplg, elem);
+	return 0;
+}
+
 int snd_tplg_build(snd_tplg_t *tplg, const char *outfile)
 {
 	int fd, err;
 	ssize_t r;
+	size_t size;
 
 	err = tplg_build(tplg);
 	if (err < 0)
@@ -364,6 +552,22 @@ int snd_tplg_build(snd_tplg_t *tplg, const char *outfile)
 		SNDERR("failed to open %s err %d", outfile, -errno);
 		return -errno;
 	}
+	size = tplg_calc_size(tplg);
+	err = tplg_build_mmap(tplg, fd, size);
+	if (err != -ENODEV) {
+		/* the written-back pages may report an error only here */
+		if (close(fd) < 0 && err >= 0) {
+			err = -errno;
+			SNDERR("close error: %s", strerror(errno));
+		}
+		return err;
+	}
+	/* not a regular file or no space reserved, write it from memory */
+	err = tplg_build_alloc(tplg, size);
+	if (err < 0) {
+		close(fd);
+		return err;
+	}
 	r = write(fd, tplg->bin, tplg->bin_size);
 	close(fd);
 	if (r < 0) {
@@ -384,6 +588,9 @@ int snd_tplg_build_bin(snd_tplg_t *tplg,
 	int err;
 
 	err = tplg_build(tplg);
+	if (err < 0)
+		return err;
+	err = tplg_build_alloc(tplg, tplg_calc_size(tplg));
 	if (err < 0)
 		return err;
 
@@ -471,6 +678,8 @@ snd_tplg_t *snd_tplg_create(int flags)
 	INIT_LIST_HEAD(&tplg->token_list);
 	INIT_LIST_HEAD(&tplg->tuple_list);
 	INIT_LIST_HEAD(&tplg->hw_cfg_list);
+	INIT_LIST_HEAD(&tplg->elem_slabs);
+	INIT_LIST_HEAD(&tplg->elem_free);
 
 	return tplg;
 }
@@ -484,6 +693,8 @@ void snd_tplg_free(snd_tplg_t *tplg)
 {
 	free(tplg->bin);
 	free(tplg->manifest_pdata);
+	free(tplg->base_bin);
+	free(tplg->base_blocks);
 
 	tplg_elem_free_list(&tplg->tlv_list);
 	tplg_elem_free_list(&tplg->widget_list);
@@ -503,6 +714,7 @@ void snd_tplg_free(snd_tplg_t *tplg)
 	tplg_elem_free_list(&tplg->token_list);
 	tplg_elem_free_list(&tplg->tuple_list);
 	tplg_elem_free_list(&tplg->hw_cfg_list);
+	tplg_elem_slabs_free(tplg);
 
 	free(tplg);
 }
@@ -17,47 +17,98 @@
 
 #include "list.h"
 #include "tplg_local.h"
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #define SAVE_ALLOC_SHIFT	(13)	/* 8192 bytes */
+#define SAVE_FLUSH_SIZE		(1 << 16)	/* output chunk */
 
-int tplg_save_printf(char **dst, const char *pfx, const char *fmt, ...)
+void tplg_buf_init(struct tplg_buf *buf, snd_output_t *out)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->out = out;
+}
+
+void tplg_buf_free(struct tplg_buf *buf)
+{
+	free(buf->dst);
+	buf->dst = NULL;
+	buf->dst_len = 0;
+	buf->dst_size = 0;
+}
+
+/* pass the buffered text to the output */
+int tplg_buf_flush(struct tplg_buf *buf)
+{
+	if (buf->out == NULL || buf->dst_len == 0)
+		return buf->err;
+	if (buf->err == 0 && snd_output_puts(buf->out, buf->dst) < 0)
+		buf->err = -EIO;
+	buf->dst_len = 0;
+	buf->dst[0] = '\0';
+	return buf->err;
+}
+
+int tplg_buf_append(struct tplg_buf *buf, const char *s, size_t len)
+{
+	size_t size;
+	char *d;
+	int err;
+
+	if (buf->out && buf->dst_len + len >= SAVE_FLUSH_SIZE) {
+		err = tplg_buf_flush(buf);
+		if (err < 0)
+			return err;
+	}
+	if (buf->dst_len + len + 1 > buf->dst_size) {
+		size = buf->dst_size ? buf->dst_size : 1 << SAVE_ALLOC_SHIFT;
+		while (size < buf->dst_len + len + 1)
+			size <<= 1;
+		d = realloc(buf->dst, size);
+		if (d == NULL)
+			return -ENOMEM;
+		buf->dst = d;
+		buf->dst_size = size;
+	}
+	memcpy(buf->dst + buf->dst_len, s, len);
+	buf->dst_len += len;
+	buf->dst[buf->dst_len] = '\0';
+	return 0;
+}
+
+int tplg_save_printf(struct tplg_buf *dst, const char *pfx, const char *fmt, ...)
 {
 	va_list va;
-	char buf[1024], *s;
-	size_t n, l, t, pl;
+	char buf[1024], *s = buf;
+	int n, err;
 
-	if (pfx == NULL)
-		pfx = "";
+	if (pfx && *pfx) {
+		err = tplg_buf_append(dst, pfx, strlen(pfx));
+		if (err < 0)
+			return err;
+	}
 
 	va_start(va, fmt);
 	n = vsnprintf(buf, sizeof(buf), fmt, va);
 	va_end(va);
+	if (n < 0)
+		return -EINVAL;
 
-	if (n >= sizeof(buf))
-		return -EOVERFLOW;
-
-	pl = strlen(pfx);
-	l = *dst ? strlen(*dst) : 0;
-	t = l + pl + n + 1;
-	/* allocate chunks */
-	if (*dst == NULL ||
-	    (l >> SAVE_ALLOC_SHIFT) != (t >> SAVE_ALLOC_SHIFT)) {
-		s = realloc(*dst, ((t >> SAVE_ALLOC_SHIFT) + 1) <<
-							SAVE_ALLOC_SHIFT);
-		if (s == NULL) {
-			free(*dst);
-			*dst = NULL;
+	/* long lines (private data) */
+	if ((size_t)n >= sizeof(buf)) {
+		s = malloc(n + 1);
+		if (s == NULL)
 			return -ENOMEM;
-		}
-	} else {
-		s = *dst;
+		va_start(va, fmt);
+		vsnprintf(s, n + 1, fmt, va);
+		va_end(va);
 	}
 
-	if (pl > 0)
-		strcpy(s + l, pfx);
-	strcpy(s + l + pl, buf);
-	*dst = s;
-	return 0;
+	err = tplg_buf_append(dst, s, n);
+	if (s != buf)
+		free(s);
+	return err;
 }
 
 int tplg_nice_value_format(char *dst, size_t dst_size, unsigned int value)
@@ -130,15 +181,14 @@ static snd_config_t *sort_config(const char *id, snd_config_t *src)
 	a = malloc(sizeof(dst) * count);
 	if (a == NULL)
 		return NULL;
+	index = 0;
+	snd_config_for_each(i, next, src) {
+		snd_config_t *s = snd_config_iterator_entry(i);
+		a[index++] = s;
+	}
 	array = snd_config_is_array(src);
-	if (array <= 0) {
-		index = 0;
-		snd_config_for_each(i, next, src) {
-			snd_config_t *s = snd_config_iterator_entry(i);
-			a[index++] = s;
-		}
+	if (array <= 0)
 		qsort(a, count, sizeof(a[0]), _compar);
-	}
 	if (snd_config_make_compound(&dst, id, count == 1)) {
 		free(a);
 		return NULL;
@@ -187,7 +237,7 @@ static int tplg_check_quoted(const unsigned char *p)
 	return 0;
 }
 
-static int tplg_save_quoted(char **dst, const char *str)
+static int tplg_save_quoted(struct tplg_buf *dst, const char *str)
 {
 	static const char nibble[16] = "0123456789abcdef";
 	unsigned char *p, *d, *t;
@@ -241,7 +291,7 @@ static int tplg_save_quoted(char **dst, const char *str)
 	return tplg_save_printf(dst, NULL, "'%s'", d);
 }
 
-static int tplg_save_string(char **dst, const char *str, int id)
+static int tplg_save_string(struct tplg_buf *dst, const char *str, int id)
 {
 	const unsigned char *p = (const unsigned char *)str;
 
@@ -257,7 +307,7 @@ static int tplg_save_string(char **dst, const char *str, int id)
 	return tplg_save_printf(dst, NULL, "%s", str);
 }
 
-static int save_config(char **dst, int level, const char *delim, snd_config_t *src)
+static int save_config(struct tplg_buf *dst, int level, const char *delim, snd_config_t *src)
 {
 	snd_config_iterator_t i, next;
 	snd_config_t *s;
@@ -378,93 +428,197 @@ retval:
 	return 0;
 }
 
-static int tplg_save(snd_tplg_t *tplg, char **dst, int gindex, const char *prefix)
+/* save the elements of one table */
+static int tplg_save_block(snd_tplg_t *tplg, struct tplg_table *tptr,
+			   struct tplg_buf *dst, int gindex, const char *prefix)
 {
-	struct tplg_table *tptr;
 	struct tplg_elem *elem;
 	struct list_head *list, *pos;
 	char pfx2[16];
-	unsigned int index;
 	int err, count;
 
 	snprintf(pfx2, sizeof(pfx2), "%s\t", prefix ?: "");
+	list = (struct list_head *)((void *)tplg + tptr->loff);
 
-	/* write all blocks */
-	for (index = 0; index < tplg_table_items; index++) {
-		tptr = &tplg_table[index];
-		list = (struct list_head *)((void *)tplg + tptr->loff);
-
-		/* count elements */
-		count = 0;
-		list_for_each(pos, list) {
-			elem = list_entry(pos, struct tplg_elem, list);
-			if (gindex >= 0 && elem->index != gindex)
-				continue;
-			if (tptr->save == NULL && tptr->gsave == NULL) {
-				SNDERR("unable to create %s block (no callback)",
-				       tptr->id);
-				err = -ENXIO;
-				goto _err;
-			}
-			if (tptr->save)
-				count++;
+	/* count elements */
+	count = 0;
+	list_for_each(pos, list) {
+		elem = list_entry(pos, struct tplg_elem, list);
+		if (gindex >= 0 && elem->index != gindex)
+			continue;
+		if (tptr->save == NULL && tptr->gsave == NULL) {
+			SNDERR("unable to create %s block (no callback)",
+			       tptr->id);
+			return -ENXIO;
 		}
+		if (tptr->save)
+			count++;
+	}
 
-		if (count == 0)
-			continue;
+	if (count == 0)
+		return 0;
 
-		if (count > 1) {
-			err = tplg_save_printf(dst, prefix, "%s {\n",
-					       elem->table ?
-						elem->table->id : "_NOID_");
-		} else {
-			err = tplg_save_printf(dst, prefix, "%s.",
-					       elem->table ?
-						elem->table->id : "_NOID_");
-		}
+	if (count > 1) {
+		err = tplg_save_printf(dst, prefix, "%s {\n",
+				       elem->table ?
+					elem->table->id : "_NOID_");
+	} else {
+		err = tplg_save_printf(dst, prefix, "%s.",
+				       elem->table ?
+					elem->table->id : "_NOID_");
+	}
 
-		if (err < 0)
-			goto _err;
+	if (err < 0)
+		return err;
 
-		list_for_each(pos, list) {
-			elem = list_entry(pos, struct tplg_elem, list);
-			if (gindex >= 0 && elem->index != gindex)
-				continue;
-			if (count > 1) {
-				err = tplg_save_printf(dst, pfx2, "");
-				if (err < 0)
-					goto _err;
-			}
-			err = tptr->save(tplg, elem, dst, count > 1 ? pfx2 : prefix);
-			if (err < 0) {
-				SNDERR("failed to save %s elements: %s",
-				       tptr->id, snd_strerror(-err));
-				goto _err;
-			}
-		}
+	list_for_each(pos, list) {
+		elem = list_entry(pos, struct tplg_elem, list);
+		if (gindex >= 0 && elem->index != gindex)
+			continue;
 		if (count > 1) {
-			err = tplg_save_printf(dst, prefix, "}\n");
+			err = tplg_save_printf(dst, pfx2, "");
 			if (err < 0)
-				goto _err;
+				return err;
+		}
+		err = tptr->save(tplg, elem, dst, count > 1 ? pfx2 : prefix);
+		if (err < 0) {
+			SNDERR("failed to save %s elements: %s",
+			       tptr->id, snd_strerror(-err));
+			return err;
 		}
 	}
+	if (count > 1) {
+		err = tplg_save_printf(dst, prefix, "}\n");
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
 
-	/* save globals */
-	for (index = 0; index < tplg_table_items; index++) {
-		tptr = &tplg_table[index];
-		if (tptr->gsave) {
-			err = tptr->gsave(tplg, gindex, dst, prefix);
+/*
+ * Job index below tplg_table_items saves the elements of the table,
+ * the rest saves the globals.
+ */
+static int tplg_save_job(snd_tplg_t *tplg, unsigned int job,
+			 struct tplg_buf *dst, int gindex, const char *prefix)
+{
+	struct tplg_table *tptr;
+
+	if (job < tplg_table_items)
+		return tplg_save_block(tplg, &tplg_table[job], dst, gindex, prefix);
+	tptr = &tplg_table[job - tplg_table_items];
+	if (tptr->gsave)
+		return tptr->gsave(tplg, gindex, dst, prefix);
+	return 0;
+}
+
+#ifdef HAVE_LIBPTHREAD
+#define SAVE_THREADS		4
+#define SAVE_PARALLEL_MIN	256	/* elements */
+
+struct save_jobs {
+	snd_tplg_t *tplg;
+	const char *prefix;
+	unsigned int count;
+	unsigned int next;
+	struct tplg_buf *bufs;
+	int *errs;
+};
+
+static void *save_thread(void *arg)
+{
+	struct save_jobs *sj = arg;
+	unsigned int job;
+
+	while ((job = __atomic_fetch_add(&sj->next, 1, __ATOMIC_RELAXED)) < sj->count)
+		sj->errs[job] = tplg_save_job(sj->tplg, job, &sj->bufs[job],
+					      -1, sj->prefix);
+	return NULL;
+}
+
+/*
+ * Render the sections to separate buffers in parallel (the save
+ * callbacks only read the elements) and append them in the table order,
+ * so the output is the same as from the sequential save.
+ */
+static int tplg_save_parallel(snd_tplg_t *tplg, struct tplg_buf *dst,
+			      const char *prefix)
+{
+	struct save_jobs sj;
+	pthread_t threads[SAVE_THREADS];
+	unsigned int job, nthreads = 0;
+	int err = 0;
+
+	memset(&sj, 0, sizeof(sj));
+	sj.tplg = tplg;
+	sj.prefix = prefix;
+	sj.count = tplg_table_items * 2;
+	sj.bufs = calloc(sj.count, sizeof(sj.bufs[0]));
+	sj.errs = calloc(sj.count, sizeof(sj.errs[0]));
+	if (sj.bufs == NULL || sj.errs == NULL) {
+		err = -ENOMEM;
+		goto __free;
+	}
+	while (nthreads < SAVE_THREADS) {
+		if (pthread_create(&threads[nthreads], NULL, save_thread, &sj))
+			break;
+		nthreads++;
+	}
+	/* the remaining jobs, all when no thread was started */
+	save_thread(&sj);
+	for (job = 0; job < nthreads; job++)
+		pthread_join(threads[job], NULL);
+	for (job = 0; job < sj.count; job++) {
+		err = sj.errs[job];
+		if (err < 0)
+			break;
+		if (sj.bufs[job].dst_len > 0) {
+			err = tplg_buf_append(dst, sj.bufs[job].dst,
+					      sj.bufs[job].dst_len);
 			if (err < 0)
-				goto _err;
+				break;
 		}
 	}
+__free:
+	if (sj.bufs) {
+		for (job = 0; job < sj.count; job++)
+			tplg_buf_free(&sj.bufs[job]);
+		free(sj.bufs);
+	}
+	free(sj.errs);
+	return err;
+}
 
-	return 0;
+static unsigned int tplg_elem_count(snd_tplg_t *tplg)
+{
+	struct list_head *list, *pos;
+	unsigned int index, count = 0;
 
-_err:
-	free(*dst);
-	*dst = NULL;
-	return err;
+	for (index = 0; index < tplg_table_items; index++) {
+		list = (struct list_head *)((void *)tplg + tplg_table[index].loff);
+		list_for_each(pos, list)
+			count++;
+	}
+	return count;
+}
+#endif
+
+static int tplg_save(snd_tplg_t *tplg, struct tplg_buf *dst, int gindex, const char *prefix)
+{
+	unsigned int job;
+	int err;
+
+#ifdef HAVE_LIBPTHREAD
+	if (gindex < 0 && tplg_elem_count(tplg) >= SAVE_PARALLEL_MIN)
+		return tplg_save_parallel(tplg, dst, prefix);
+#endif
+	/* write all blocks, then the globals */
+	for (job = 0; job < tplg_table_items * 2; job++) {
+		err = tplg_save_job(tplg, job, dst, gindex, prefix);
+		if (err < 0)
+			return err;
+	}
+	return 0;
 }
 
 static int tplg_index_compar(const void *a, const void *b)
@@ -516,47 +670,53 @@ static int tplg_index_groups(snd_tplg_t *tplg, int **indexes)
 	return 0;
 }
 
-int snd_tplg_save(snd_tplg_t *tplg, char **dst, int flags)
+/* save the topology text, through the configuration tree unless NOCHECK */
+static int tplg_save_all(snd_tplg_t *tplg, struct tplg_buf *dst, int flags)
 {
+	struct tplg_buf buf, *tbuf;
 	snd_input_t *in;
 	snd_config_t *top, *top2;
-	char *dst2;
 	int *indexes, *a;
 	int err;
 
-	assert(tplg);
-	assert(dst);
-	*dst = NULL;
+	if (flags & SND_TPLG_SAVE_NOCHECK) {
+		tbuf = dst;
+	} else {
+		tplg_buf_init(&buf, NULL);
+		tbuf = &buf;
+	}
 
 	if (flags & SND_TPLG_SAVE_GROUPS) {
 		err = tplg_index_groups(tplg, &indexes);
 		if (err < 0)
-			return err;
+			goto _err;
 		for (a = indexes; err >= 0 && *a >= 0; a++) {
-			err = tplg_save_printf(dst, NULL,
+			err = tplg_save_printf(tbuf, NULL,
 					       "IndexGroup.%d {\n",
 					       *a);
 			if (err >= 0)
-				err = tplg_save(tplg, dst, *a, "\t");
+				err = tplg_save(tplg, tbuf, *a, "\t");
 			if (err >= 0)
-				err = tplg_save_printf(dst, NULL, "}\n");
+				err = tplg_save_printf(tbuf, NULL, "}\n");
 		}
 		free(indexes);
 	} else {
-		err = tplg_save(tplg, dst, -1, NULL);
+		err = tplg_save(tplg, tbuf, -1, NULL);
 	}
 
 	if (err < 0)
 		goto _err;
 
-	if (*dst == NULL)
-		return -EINVAL;
+	if (tbuf->dst == NULL) {
+		err = -EINVAL;
+		goto _err;
+	}
 
 	if (flags & SND_TPLG_SAVE_NOCHECK)
-		return 0;
+		return tplg_buf_flush(dst);
 
 	/* always load configuration - check */
-	err = snd_input_buffer_open(&in, *dst, strlen(*dst));
+	err = snd_input_buffer_open(&in, buf.dst, buf.dst_len);
 	if (err < 0) {
 		SNDERR("could not create input buffer");
 		goto _err;
@@ -570,10 +730,11 @@ int snd_tplg_save(snd_tplg_t *tplg, char **dst, int flags)
 
 	err = snd_config_load(top, in);
 	snd_input_close(in);
+	tplg_buf_free(&buf);
 	if (err < 0) {
 		SNDERR("could not load configuration");
 		snd_config_delete(top);
-		goto _err;
+		return err;
 	}
 
 	if (flags & SND_TPLG_SAVE_SORT) {
@@ -581,27 +742,55 @@ int snd_tplg_save(snd_tplg_t *tplg, char **dst, int flags)
 		if (top2 == NULL) {
 			SNDERR("could not sort configuration");
 			snd_config_delete(top);
-			err = -EINVAL;
-			goto _err;
+			return -EINVAL;
 		}
 		snd_config_delete(top);
 		top = top2;
 	}
 
-	dst2 = NULL;
-	err = save_config(&dst2, 0, NULL, top);
+	err = save_config(dst, 0, NULL, top);
 	snd_config_delete(top);
 	if (err < 0) {
 		SNDERR("could not save configuration");
-		goto _err;
+		return err;
 	}
-
-	free(*dst);
-	*dst = dst2;
-	return 0;
+	return tplg_buf_flush(dst);
 
 _err:
-	free(*dst);
+	if (tbuf != dst)
+		tplg_buf_free(tbuf);
+	return err;
+}
+
+int snd_tplg_save(snd_tplg_t *tplg, char **dst, int flags)
+{
+	struct tplg_buf buf;
+	int err;
+
+	assert(tplg);
+	assert(dst);
 	*dst = NULL;
+
+	tplg_buf_init(&buf, NULL);
+	err = tplg_save_all(tplg, &buf, flags);
+	if (err < 0) {
+		tplg_buf_free(&buf);
+		return err;
+	}
+	*dst = buf.dst;
+	return 0;
+}
+
+int snd_tplg_save_output(snd_tplg_t *tplg, snd_output_t *out, int flags)
+{
+	struct tplg_buf buf;
+	int err;
+
+	assert(tplg);
+	assert(out);
+
+	tplg_buf_init(&buf, out);
+	err = tplg_save_all(tplg, &buf, flags);
+	tplg_buf_free(&buf);
 	return err;
 }
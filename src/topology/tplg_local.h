@@ -30,6 +30,7 @@
 #endif
 
 #define TPLG_MAX_PRIV_SIZE	(1024 * 128)
+#define TPLG_ELEM_HASH		1024	/* buckets of the element id hash */
 
 /** The name of the environment variable containing the tplg directory */
 #define ALSA_CONFIG_TPLG_VAR "ALSA_CONFIG_TPLG"
@@ -58,6 +59,24 @@ typedef enum _snd_pcm_rates {
 	SND_PCM_RATE_LAST = SND_PCM_RATE_KNOT,
 } snd_pcm_rates_t;
 
+/* decoded block kept for the incremental build */
+struct tplg_base_block {
+	size_t pos;		/* header offset in base_bin */
+	size_t size;		/* header and payload */
+	int tsoc;
+	int index;
+	unsigned dirty: 1;	/* elements were added or removed */
+};
+
+/* text output buffer, flushed to out in chunks when set */
+struct tplg_buf {
+	char *dst;
+	size_t dst_len;
+	size_t dst_size;
+	snd_output_t *out;
+	int err;		/* sticky flush error */
+};
+
 struct snd_tplg {
 	/* out file */
 	unsigned char *bin;
@@ -98,6 +117,21 @@ struct snd_tplg {
 	struct list_head mixer_list;
 	struct list_head enum_list;
 	struct list_head bytes_ext_list;
+
+	/* element storage */
+	struct list_head elem_slabs;
+	struct list_head elem_free;
+	unsigned int elem_slab_used;
+
+	/* element id hash, see tplg_elem_lookup() */
+	struct tplg_elem *elem_hash[TPLG_ELEM_HASH];
+	unsigned int elem_seq;
+
+	/* decoded binary, see SND_TPLG_DECODE_INCREMENTAL */
+	void *base_bin;
+	struct tplg_base_block *base_blocks;	/* [0] is unused */
+	unsigned int base_count;
+	unsigned int base_decoding;	/* block being decoded, 0 = none */
 };
 
 /* object text references */
@@ -149,6 +183,7 @@ struct tplg_vendor_tuples {
 /* topology element */
 struct tplg_elem {
 
+	snd_tplg_t *tplg;
 	struct tplg_table *table;
 
 	char id[SNDRV_CTL_ELEM_ID_NAME_MAXLEN];
@@ -192,6 +227,13 @@ struct tplg_elem {
 	struct list_head ref_list;
 	struct list_head list; /* list of all elements with same type */
 
+	/* id hash */
+	struct tplg_elem *hash_next;
+	struct list_head *hash_base;	/* list the elem was hashed for */
+	unsigned int seq;		/* creation order */
+
+	unsigned int base_block;	/* decoded from this kept block */
+
 	void (*free)(void *obj);
 };
 
@@ -214,9 +256,9 @@ struct tplg_table {
 	void (*free)(void *);
 	int (*parse)(snd_tplg_t *tplg, snd_config_t *cfg, void *priv);
 	int (*save)(snd_tplg_t *tplg, struct tplg_elem *elem,
-		    char **dst, const char *prefix);
+		    struct tplg_buf *dst, const char *prefix);
 	int (*gsave)(snd_tplg_t *tplg, int index,
-		     char **dst, const char *prefix);
+		     struct tplg_buf *dst, const char *prefix);
 	int (*decod)(snd_tplg_t *tplg, size_t pos,
 		     struct snd_soc_tplg_hdr *hdr,
 		     void *bin, size_t size);
@@ -241,6 +283,7 @@ int tplg_parse_compound(snd_tplg_t *tplg, snd_config_t *cfg,
 	int (*fcn)(snd_tplg_t *, snd_config_t *, void *),
 	void *private);
 
+size_t tplg_calc_size(snd_tplg_t *tplg);
 int tplg_write_data(snd_tplg_t *tplg);
 
 int tplg_parse_tlv(snd_tplg_t *tplg, snd_config_t *cfg, void *priv);
@@ -280,8 +323,12 @@ int tplg_parse_refs(snd_config_t *cfg, struct tplg_elem *elem,
 int tplg_ref_add(struct tplg_elem *elem, int type, const char* id);
 int tplg_ref_add_elem(struct tplg_elem *elem, struct tplg_elem *elem_ref);
 
-struct tplg_elem *tplg_elem_new(void);
+struct tplg_elem *tplg_elem_new(snd_tplg_t *tplg);
 void tplg_elem_free(struct tplg_elem *elem);
+void tplg_elem_slabs_free(snd_tplg_t *tplg);
+void tplg_elem_set_base(snd_tplg_t *tplg, struct tplg_elem *elem, int tsoc);
+int tplg_elem_kept(snd_tplg_t *tplg, struct tplg_elem *elem);
+void tplg_elem_remove(snd_tplg_t *tplg, struct tplg_elem *elem);
 void tplg_elem_free_list(struct list_head *base);
 void tplg_elem_insert(struct tplg_elem *elem_p, struct list_head *list);
 struct tplg_elem *tplg_elem_lookup(struct list_head *base,
@@ -335,49 +382,53 @@ int tplg_add_dai_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t);
 
 int tplg_nice_value_format(char *dst, size_t dst_size, unsigned int value);
 
-int tplg_save_printf(char **dst, const char *prefix, const char *fmt, ...);
+void tplg_buf_init(struct tplg_buf *buf, snd_output_t *out);
+void tplg_buf_free(struct tplg_buf *buf);
+int tplg_buf_append(struct tplg_buf *buf, const char *s, size_t len);
+int tplg_buf_flush(struct tplg_buf *buf);
+int tplg_save_printf(struct tplg_buf *dst, const char *prefix, const char *fmt, ...);
 int tplg_save_refs(snd_tplg_t *tplg, struct tplg_elem *elem, unsigned int type,
-		   const char *id, char **dst, const char *pfx);
+		   const char *id, struct tplg_buf *dst, const char *pfx);
 int tplg_save_channels(snd_tplg_t *tplg, struct snd_soc_tplg_channel *channel,
-		       unsigned int channel_count, char **dst, const char *pfx);
+		       unsigned int channel_count, struct tplg_buf *dst, const char *pfx);
 int tplg_save_ops(snd_tplg_t *tplg, struct snd_soc_tplg_ctl_hdr *hdr,
-		  char **dst, const char *pfx);
+		  struct tplg_buf *dst, const char *pfx);
 int tplg_save_ext_ops(snd_tplg_t *tplg, struct snd_soc_tplg_bytes_control *be,
-		      char **dst, const char *pfx);
+		      struct tplg_buf *dst, const char *pfx);
 int tplg_save_manifest_data(snd_tplg_t *tplg, struct tplg_elem *elem,
-			    char **dst, const char *pfx);
+			    struct tplg_buf *dst, const char *pfx);
 int tplg_save_control_mixer(snd_tplg_t *tplg, struct tplg_elem *elem,
-			    char **dst, const char *pfx);
+			    struct tplg_buf *dst, const char *pfx);
 int tplg_save_control_enum(snd_tplg_t *tplg, struct tplg_elem *elem,
-			   char **dst, const char *pfx);
+			   struct tplg_buf *dst, const char *pfx);
 int tplg_save_control_bytes(snd_tplg_t *tplg, struct tplg_elem *elem,
-			    char **dst, const char *pfx);
+			    struct tplg_buf *dst, const char *pfx);
 int tplg_save_tlv(snd_tplg_t *tplg, struct tplg_elem *elem,
-		  char **dst, const char *pfx);
+		  struct tplg_buf *dst, const char *pfx);
 int tplg_save_data(snd_tplg_t *tplg, struct tplg_elem *elem,
-		   char **dst, const char *pfx);
+		   struct tplg_buf *dst, const char *pfx);
 int tplg_save_text(snd_tplg_t *tplg, struct tplg_elem *elem,
-		   char **dst, const char *pfx);
+		   struct tplg_buf *dst, const char *pfx);
 int tplg_save_tokens(snd_tplg_t *tplg, struct tplg_elem *elem,
-		     char **dst, const char *pfx);
+		     struct tplg_buf *dst, const char *pfx);
 int tplg_save_tuples(snd_tplg_t *tplg, struct tplg_elem *elem,
-		     char **dst, const char *pfx);
+		     struct tplg_buf *dst, const char *pfx);
 int tplg_save_dapm_graph(snd_tplg_t *tplg, int index,
-			 char **dst, const char *pfx);
+			 struct tplg_buf *dst, const char *pfx);
 int tplg_save_dapm_widget(snd_tplg_t *tplg, struct tplg_elem *elem,
-			  char **dst, const char *pfx);
+			  struct tplg_buf *dst, const char *pfx);
 int tplg_save_link(snd_tplg_t *tplg, struct tplg_elem *elem,
-		   char **dst, const char *pfx);
+		   struct tplg_buf *dst, const char *pfx);
 int tplg_save_cc(snd_tplg_t *tplg, struct tplg_elem *elem,
-		 char **dst, const char *pfx);
+		 struct tplg_buf *dst, const char *pfx);
 int tplg_save_pcm(snd_tplg_t *tplg, struct tplg_elem *elem,
-		  char **dst, const char *pfx);
+		  struct tplg_buf *dst, const char *pfx);
 int tplg_save_hw_config(snd_tplg_t *tplg, struct tplg_elem *elem,
-			char **dst, const char *pfx);
+			struct tplg_buf *dst, const char *pfx);
 int tplg_save_stream_caps(snd_tplg_t *tplg, struct tplg_elem *elem,
-			  char **dst, const char *pfx);
+			  struct tplg_buf *dst, const char *pfx);
 int tplg_save_dai(snd_tplg_t *tplg, struct tplg_elem *elem,
-		  char **dst, const char *pfx);
+		  struct tplg_buf *dst, const char *pfx);
 
 int tplg_decode_template(snd_tplg_t *tplg,
 			 size_t pos,
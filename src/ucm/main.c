@@ -250,71 +250,249 @@ extern int __snd_ctl_ascii_elem_id_parse(snd_ctl_elem_id_t *dst,
 					 const char *str,
 					 const char **ret_ptr);
 
-static int execute_cset(snd_ctl_t *ctl, const char *cset, unsigned int type)
+/* the parsed value keeps some channels or toggles the current one */
+static int cset_value_partial(const char *ascii)
 {
+	if (strchr(ascii, ','))
+		return 1;
+	for (; *ascii; ascii++)
+		if (strncasecmp(ascii, "toggle", 6) == 0)
+			return 1;
+	return 0;
+}
+
+/*
+ * Resolve the cset against the given control device: parse the element
+ * id, look up the numid and the element info, read the TLV or binary
+ * file and parse the value.  The result is cached in the sequence
+ * element, so the next executions are just writes.
+ */
+static int compile_cset(snd_use_case_mgr_t *uc_mgr, snd_ctl_t *ctl,
+			struct sequence_element *s)
+{
+	struct ctl_cset_op *op = s->cset_op;
 	const char *pos;
 	int err;
-	snd_ctl_elem_id_t *id;
-	snd_ctl_elem_value_t *value;
-	snd_ctl_elem_info_t *info;
-	unsigned int *res = NULL;
 
-	snd_ctl_elem_id_malloc(&id);
-	snd_ctl_elem_value_malloc(&value);
-	snd_ctl_elem_info_malloc(&info);
+	if (op == NULL) {
+		op = calloc(1, sizeof(*op));
+		if (op == NULL)
+			return -ENOMEM;
+		s->cset_op = op;
+	} else {
+		free(op->tlv);
+		memset(op, 0, sizeof(*op));
+	}
 
-	err = __snd_ctl_ascii_elem_id_parse(id, cset, &pos);
+	err = __snd_ctl_ascii_elem_id_parse(&op->id, s->data.cset, &pos);
 	if (err < 0)
-		goto __fail;
+		return err;
 	while (*pos && isspace(*pos))
 		pos++;
 	if (!*pos) {
-		uc_error("undefined value for cset >%s<", cset);
-		err = -EINVAL;
-		goto __fail;
+		uc_error("undefined value for cset >%s<", s->data.cset);
+		return -EINVAL;
 	}
-	snd_ctl_elem_info_set_id(info, id);
-	err = snd_ctl_elem_info(ctl, info);
+	op->ascii = pos;
+	snd_ctl_elem_info_set_id(&op->info, &op->id);
+	err = snd_ctl_elem_info(ctl, &op->info);
 	if (err < 0)
-		goto __fail;
-	if (type == SEQUENCE_ELEMENT_TYPE_CSET_TLV) {
-		if (!snd_ctl_elem_info_is_tlv_writable(info)) {
-			err = -EINVAL;
-			goto __fail;
-		}
-		err = read_tlv_file(&res, pos);
-		if (err < 0)
-			goto __fail;
-		err = snd_ctl_elem_tlv_write(ctl, id, res);
+		return err;
+	/* the id with numid makes the kernel lookups fast */
+	snd_ctl_elem_info_get_id(&op->info, &op->id);
+	if (s->type == SEQUENCE_ELEMENT_TYPE_CSET_TLV) {
+		if (!snd_ctl_elem_info_is_tlv_writable(&op->info))
+			return -EINVAL;
+		err = read_tlv_file(&op->tlv, pos);
 		if (err < 0)
-			goto __fail;
+			return err;
 	} else {
-		snd_ctl_elem_value_set_id(value, id);
-		err = snd_ctl_elem_read(ctl, value);
+		snd_ctl_elem_value_set_id(&op->value, &op->id);
+		err = snd_ctl_elem_read(ctl, &op->value);
 		if (err < 0)
-			goto __fail;
-		if (type == SEQUENCE_ELEMENT_TYPE_CSET_BIN_FILE)
-			err = binary_file_parse(value, info, pos);
-		else
-			err = snd_ctl_ascii_value_parse(ctl, value, info, pos);
+			return err;
+		if (s->type == SEQUENCE_ELEMENT_TYPE_CSET_BIN_FILE) {
+			err = binary_file_parse(&op->value, &op->info, pos);
+		} else {
+			op->partial = cset_value_partial(pos);
+			err = snd_ctl_ascii_value_parse(ctl, &op->value, &op->info, pos);
+		}
 		if (err < 0)
-			goto __fail;
-		err = snd_ctl_elem_write(ctl, value);
+			return err;
+	}
+	op->ctl = ctl;
+	op->ctl_gen = uc_mgr->ctl_gen;
+	return 1;
+}
+
+static inline int is_cset(unsigned int type)
+{
+	return type == SEQUENCE_ELEMENT_TYPE_CSET ||
+	       type == SEQUENCE_ELEMENT_TYPE_CSET_BIN_FILE ||
+	       type == SEQUENCE_ELEMENT_TYPE_CSET_TLV;
+}
+
+/* resolve the cset for the control device, if not done yet */
+static int prepare_cset(snd_use_case_mgr_t *uc_mgr, snd_ctl_t *ctl,
+			struct sequence_element *s)
+{
+	struct ctl_cset_op *op = s->cset_op;
+	int err;
+
+	if (op && op->ctl == ctl && op->ctl_gen == uc_mgr->ctl_gen)
+		return 0;
+	err = compile_cset(uc_mgr, ctl, s);
+	if (err < 0) {
+		/* try again next time */
+		if (s->cset_op)
+			s->cset_op->ctl = NULL;
+		return err;
+	}
+	return 0;
+}
+
+static int cset_value_equal(struct ctl_cset_op *op, snd_ctl_elem_value_t *cur)
+{
+	unsigned int count = snd_ctl_elem_info_get_count(&op->info);
+	size_t size;
+
+	switch (snd_ctl_elem_info_get_type(&op->info)) {
+	case SND_CTL_ELEM_TYPE_BOOLEAN:
+	case SND_CTL_ELEM_TYPE_INTEGER:
+		size = count * sizeof(cur->value.integer.value[0]);
+		break;
+	case SND_CTL_ELEM_TYPE_INTEGER64:
+		size = count * sizeof(cur->value.integer64.value[0]);
+		break;
+	case SND_CTL_ELEM_TYPE_ENUMERATED:
+		size = count * sizeof(cur->value.enumerated.item[0]);
+		break;
+	case SND_CTL_ELEM_TYPE_BYTES:
+		size = count * sizeof(cur->value.bytes.data[0]);
+		break;
+	case SND_CTL_ELEM_TYPE_IEC958:
+		size = sizeof(cur->value.iec958);
+		break;
+	default:
+		return 0;
+	}
+	if (size > sizeof(cur->value))
+		size = sizeof(cur->value);
+	return memcmp(&cur->value, &op->value.value, size) == 0;
+}
+
+static int write_cset(snd_ctl_t *ctl, struct sequence_element *s)
+{
+	struct ctl_cset_op *op = s->cset_op;
+	snd_ctl_elem_value_t cur;
+	int err;
+
+	if (s->type == SEQUENCE_ELEMENT_TYPE_CSET_TLV)
+		return snd_ctl_elem_tlv_write(ctl, &op->id, op->tlv);
+	if (op->partial) {
+		/* read-modify-write, the value depends on the current state */
+		err = snd_ctl_elem_read(ctl, &op->value);
+		if (err < 0)
+			return err;
+		err = snd_ctl_ascii_value_parse(ctl, &op->value, &op->info, op->ascii);
 		if (err < 0)
-			goto __fail;
+			return err;
+	} else {
+		/* skip the write when the element has the value already */
+		memset(&cur, 0, sizeof(cur));
+		snd_ctl_elem_value_set_id(&cur, &op->id);
+		if (snd_ctl_elem_read(ctl, &cur) >= 0 &&
+		    cset_value_equal(op, &cur))
+			return 0;
 	}
-	err = 0;
-      __fail:
-	if (id != NULL)
-		free(id);
-	if (value != NULL)
-		free(value);
-	if (info != NULL)
-		free(info);
-	if (res != NULL)
-		free(res);
+	err = snd_ctl_elem_write(ctl, &op->value);
+	return err < 0 ? err : 0;
+}
 
-	return err;
+/*
+ * Write the cset; when the cached numid went stale (the element was
+ * removed and added again), resolve the cset from the element name once
+ * more and retry.
+ */
+static int write_cset_retry(snd_use_case_mgr_t *uc_mgr, snd_ctl_t *ctl,
+			    struct sequence_element *s)
+{
+	int err;
+
+	err = write_cset(ctl, s);
+	if (err != -ENOENT && err != -EINVAL)
+		return err;
+	err = compile_cset(uc_mgr, ctl, s);
+	if (err < 0) {
+		/* try again next time */
+		s->cset_op->ctl = NULL;
+		return err;
+	}
+	return write_cset(ctl, s);
+}
+
+/* the value is overwritten later in the same run (last one wins) */
+static int cset_superseded(struct list_head *pos, struct list_head *last)
+{
+	struct sequence_element *s, *s2;
+
+	s = list_entry(pos, struct sequence_element, list);
+	if (s->type == SEQUENCE_ELEMENT_TYPE_CSET_TLV)
+		return 0;
+	while (pos != last) {
+		pos = pos->next;
+		s2 = list_entry(pos, struct sequence_element, list);
+		if (s2->cset_op->id.numid != s->cset_op->id.numid)
+			continue;
+		return s2->type != SEQUENCE_ELEMENT_TYPE_CSET_TLV &&
+		       !s2->cset_op->partial;
+	}
+	return 0;
+}
+
+/*
+ * Execute the run of consecutive csets starting at *_pos on one control
+ * device. The csets are resolved first; the writes overwritten later in
+ * the run and the writes of the current values are skipped. *_pos is
+ * set to the last executed element.
+ */
+static int execute_cset_run(snd_use_case_mgr_t *uc_mgr, snd_ctl_t *ctl,
+			    struct list_head *seq, struct list_head **_pos)
+{
+	struct list_head *pos, *last = NULL;
+	struct sequence_element *s, *failed = NULL;
+	int err = 0, err1;
+
+	for (pos = *_pos; pos != seq; pos = pos->next) {
+		s = list_entry(pos, struct sequence_element, list);
+		if (!is_cset(s->type))
+			break;
+		err = prepare_cset(uc_mgr, ctl, s);
+		if (err < 0) {
+			/* execute the previous ones, then fail */
+			failed = s;
+			break;
+		}
+		last = pos;
+	}
+	for (pos = *_pos; last; pos = pos->next) {
+		s = list_entry(pos, struct sequence_element, list);
+		if (!cset_superseded(pos, last)) {
+			err1 = write_cset_retry(uc_mgr, ctl, s);
+			if (err1 < 0) {
+				uc_error("unable to execute cset '%s'", s->data.cset);
+				return err1;
+			}
+		}
+		if (pos == last)
+			break;
+	}
+	if (failed) {
+		uc_error("unable to execute cset '%s'", failed->data.cset);
+		return err;
+	}
+	*_pos = last;
+	return 0;
 }
 
 /**
@@ -408,11 +586,9 @@ static int execute_sequence(snd_use_case_mgr_t *uc_mgr,
 				}
 				ctl = ctl_list->ctl;
 			}
-			err = execute_cset(ctl, s->data.cset, s->type);
-			if (err < 0) {
-				uc_error("unable to execute cset '%s'", s->data.cset);
+			err = execute_cset_run(uc_mgr, ctl, seq, &pos);
+			if (err < 0)
 				goto __fail;
-			}
 			break;
 		case SEQUENCE_ELEMENT_TYPE_SLEEP:
 			usleep(s->data.sleep);
@@ -568,35 +744,6 @@ static int import_master_config(snd_use_case_mgr_t *uc_mgr)
 	return add_auto_values(uc_mgr);
 }
 
-/**
- * \brief Universal find - string in a list
- * \param list List of structures
- * \param offset Offset of list structure
- * \param soffset Offset of string structure
- * \param match String to match
- * \return structure on success, otherwise a NULL (not found)
- */
-static void *find0(struct list_head *list,
-		   unsigned long offset,
-		   unsigned long soffset,
-		   const char *match)
-{
-	struct list_head *pos;
-	char *ptr, *str;
-
-	list_for_each(pos, list) {
-		ptr = list_entry_offset(pos, char, offset);
-		str = *((char **)(ptr + soffset));
-		if (strcmp(str, match) == 0)
-			return ptr;
-	}
-	return NULL;
-}
-
-#define find(list, type, member, value, match) \
-	find0(list, (unsigned long)(&((type *)0)->member), \
-		    (unsigned long)(&((type *)0)->value), match)
-
 /**
  * \brief Universal string list
  * \param list List of structures
@@ -712,9 +859,7 @@ static int get_list20(struct list_head *list,
 static inline struct use_case_verb *find_verb(snd_use_case_mgr_t *uc_mgr,
 					      const char *verb_name)
 {
-	return find(&uc_mgr->verb_list,
-		    struct use_case_verb, list, name,
-		    verb_name);
+	return uc_mgr_index_find(uc_mgr, UC_MGR_INDEX_VERB, NULL, verb_name);
 }
 
 static int is_devlist_supported(snd_use_case_mgr_t *uc_mgr, 
@@ -775,6 +920,12 @@ static inline struct use_case_device *
 	struct use_case_device *device;
 	struct list_head *pos;
 
+	device = uc_mgr_index_find(uc_mgr, UC_MGR_INDEX_DEVICE, verb, device_name);
+	if (device == NULL ||
+	    !check_supported || is_device_supported(uc_mgr, device))
+		return device;
+
+	/* a device with the same name may follow */
 	list_for_each(pos, &verb->device_list) {
 		device = list_entry(pos, struct use_case_device, list);
 
@@ -803,6 +954,13 @@ static struct use_case_modifier *
 	struct use_case_modifier *modifier;
 	struct list_head *pos;
 
+	modifier = uc_mgr_index_find(uc_mgr, UC_MGR_INDEX_MODIFIER, verb,
+				     modifier_name);
+	if (modifier == NULL ||
+	    !check_supported || is_modifier_supported(uc_mgr, modifier))
+		return modifier;
+
+	/* a modifier with the same name may follow */
 	list_for_each(pos, &verb->modifier_list) {
 		modifier = list_entry(pos, struct use_case_modifier, list);
 
@@ -1083,6 +1241,7 @@ int snd_use_case_mgr_reset(snd_use_case_mgr_t *uc_mgr)
         int err;
 
 	pthread_mutex_lock(&uc_mgr->mutex);
+	uc_mgr_value_memo_free(uc_mgr);
 	err = execute_sequence(uc_mgr, &uc_mgr->default_list,
 			       &uc_mgr->value_list, NULL, NULL);
 	INIT_LIST_HEAD(&uc_mgr->active_modifiers);
@@ -1615,20 +1774,12 @@ static int get_value3(snd_use_case_mgr_t *uc_mgr,
 	return -ENOENT;
 }
 
-/**
- * \brief Get value
- * \param uc_mgr Use case manager
- * \param identifier Value identifier (string)
- * \param value Returned value string
- * \param item Modifier or Device name (string)
- * \return Zero on success (value is filled), otherwise a negative error code
- */
-static int get_value(snd_use_case_mgr_t *uc_mgr,
-			const char *identifier,
-			char **value,
-			const char *mod_dev_name,
-			const char *verb_name,
-			int exact)
+static int get_value0(snd_use_case_mgr_t *uc_mgr,
+		      const char *identifier,
+		      char **value,
+		      const char *mod_dev_name,
+		      const char *verb_name,
+		      int exact)
 {
 	struct use_case_verb *verb;
 	struct use_case_modifier *mod;
@@ -1683,6 +1834,52 @@ static int get_value(snd_use_case_mgr_t *uc_mgr,
 	return -ENOENT;
 }
 
+/**
+ * \brief Get value
+ * \param uc_mgr Use case manager
+ * \param identifier Value identifier (string)
+ * \param value Returned value string
+ * \param item Modifier or Device name (string)
+ * \return Zero on success (value is filled), otherwise a negative error code
+ *
+ * The results (including the missing values) are remembered until
+ * the next snd_use_case_set() or reset call.
+ */
+static int get_value(snd_use_case_mgr_t *uc_mgr,
+			const char *identifier,
+			char **value,
+			const char *mod_dev_name,
+			const char *verb_name,
+			int exact)
+{
+	struct use_case_verb *verb;
+	struct ucm_value_memo *memo;
+	int err;
+
+	if (verb_name && strlen(verb_name))
+		verb = find_verb(uc_mgr, verb_name);
+	else
+		verb = uc_mgr->active_verb;
+	/* no verb name (global values only) and an empty one (the active
+	 * verb) are different lookups
+	 */
+	memo = uc_mgr_value_memo_find(uc_mgr, verb, verb_name != NULL,
+				      mod_dev_name, identifier, exact);
+	if (memo) {
+		if (memo->err < 0)
+			return memo->err;
+		*value = strdup(memo->value);
+		return *value ? 0 : -ENOMEM;
+	}
+	err = get_value0(uc_mgr, identifier, value, mod_dev_name,
+			 verb_name, exact);
+	if (err >= 0 || err == -ENOENT)
+		uc_mgr_value_memo_put(uc_mgr, verb, verb_name != NULL,
+				      mod_dev_name, identifier, exact, err,
+				      err >= 0 ? *value : NULL);
+	return err;
+}
+
 /**
  * \brief Get current - string
  * \param uc_mgr Use case manager
@@ -2088,6 +2285,8 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
 	int err = 0;
 
 	pthread_mutex_lock(&uc_mgr->mutex);
+	/* the values may depend on the state */
+	uc_mgr_value_memo_free(uc_mgr);
 	if (strcmp(identifier, "_boot") == 0)
 		err = set_boot_user(uc_mgr, value);
 	else if (strcmp(identifier, "_defaults") == 0)
@@ -1721,6 +1721,74 @@ __error:
 	return err;
 }
 
+#ifdef HAVE_LIBPTHREAD
+#define PREFETCH_FILES_MAX	32
+#define PREFETCH_THREADS	4
+
+struct prefetch_files {
+	int format;
+	unsigned int count;
+	unsigned int next;
+	char *filename[PREFETCH_FILES_MAX];
+};
+
+static void *prefetch_thread(void *arg)
+{
+	struct prefetch_files *pf = arg;
+	unsigned int idx;
+
+	while ((idx = __atomic_fetch_add(&pf->next, 1, __ATOMIC_RELAXED)) < pf->count)
+		uc_mgr_config_prefetch(pf->format, pf->filename[idx]);
+	return NULL;
+}
+
+/*
+ * Load the verb files to the file cache in parallel. The verb sections
+ * are evaluated later in order; the files which names depend on the
+ * evaluation are simply loaded there.
+ */
+static void prefetch_verb_files(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg)
+{
+	struct prefetch_files pf;
+	pthread_t threads[PREFETCH_THREADS];
+	snd_config_iterator_t i, next;
+	snd_config_t *n, *f;
+	const char *file;
+	char filename[PATH_MAX];
+	unsigned int idx, nthreads = 0;
+
+	memset(&pf, 0, sizeof(pf));
+	pf.format = uc_mgr->conf_format;
+	snd_config_for_each(i, next, cfg) {
+		n = snd_config_iterator_entry(i);
+		if (snd_config_search(n, "File", &f) < 0 ||
+		    snd_config_get_string(f, &file) < 0 ||
+		    strchr(file, '$'))
+			continue;
+		ucm_filename(filename, sizeof(filename), uc_mgr->conf_format,
+			     file[0] == '/' ? NULL : uc_mgr->conf_dir_name,
+			     file);
+		pf.filename[pf.count] = strdup(filename);
+		if (pf.filename[pf.count] == NULL)
+			break;
+		if (++pf.count >= PREFETCH_FILES_MAX)
+			break;
+	}
+	if (pf.count > 1) {
+		while (nthreads < PREFETCH_THREADS && nthreads < pf.count) {
+			if (pthread_create(&threads[nthreads], NULL,
+					   prefetch_thread, &pf))
+				break;
+			nthreads++;
+		}
+		for (idx = 0; idx < nthreads; idx++)
+			pthread_join(threads[idx], NULL);
+	}
+	for (idx = 0; idx < pf.count; idx++)
+		free(pf.filename[idx]);
+}
+#endif
+
 /*
  * parse controls which should be run only at initial boot
  */
@@ -1865,6 +1933,10 @@ static int parse_master_file(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg)
 
 		/* find use case section and parse it */
 		if (strcmp(id, "SectionUseCase") == 0) {
+#ifdef HAVE_LIBPTHREAD
+			if (snd_config_get_type(n) == SND_CONFIG_TYPE_COMPOUND)
+				prefetch_verb_files(uc_mgr, n);
+#endif
 			err = parse_compound(uc_mgr, n,
 					     parse_master_section,
 					     NULL, NULL);
@@ -65,6 +65,18 @@ struct component_sequence {
 	int enable; /* flag to choose enable or disable list of the device */
 };
 
+/* cset resolved against a control device on the first execution */
+struct ctl_cset_op {
+	snd_ctl_t *ctl;			/* handle used for the resolution */
+	unsigned int ctl_gen;		/* generation of the ctl list */
+	snd_ctl_elem_id_t id;		/* resolved id (with numid) */
+	snd_ctl_elem_info_t info;
+	snd_ctl_elem_value_t value;	/* complete value to be written */
+	unsigned int *tlv;		/* contents of the TLV file */
+	const char *ascii;		/* value part of the cset string */
+	unsigned int partial: 1;	/* value depends on the current one */
+};
+
 struct sequence_element {
 	struct list_head list;
 	unsigned int type;
@@ -75,6 +87,7 @@ struct sequence_element {
 		char *exec;
 		struct component_sequence cmpt_seq; /* component sequence */
 	} data;
+	struct ctl_cset_op *cset_op;	/* cset cache */
 };
 
 /*
@@ -209,6 +222,37 @@ struct use_case_verb {
 	struct list_head remove_list;
 };
 
+/*
+ * Lookup caches. The name index of verbs, devices and modifiers is
+ * built on the first lookup after the parsing. The resolved values are
+ * remembered until the state is changed by snd_use_case_set() or reset.
+ */
+#define UC_MGR_HASH_SIZE	64
+#define UC_MGR_VALUE_MEMO_MAX	1024
+
+#define UC_MGR_INDEX_VERB	0
+#define UC_MGR_INDEX_DEVICE	1
+#define UC_MGR_INDEX_MODIFIER	2
+
+struct ucm_index_entry {
+	struct ucm_index_entry *next;
+	unsigned int kind;
+	const void *parent;		/* verb for devices and modifiers */
+	const char *name;
+	void *obj;
+};
+
+struct ucm_value_memo {
+	struct ucm_value_memo *next;
+	const struct use_case_verb *verb;
+	int verb_given;			/* verb name passed, maybe empty */
+	char *mod_dev;
+	char *identifier;
+	int exact;
+	int err;			/* result of the lookup */
+	char *value;
+};
+
 /*
  *  Manages a sound card and all its use cases.
  */
@@ -245,6 +289,7 @@ struct snd_use_case_mgr {
 
 	/* list of opened control devices */
 	struct list_head ctl_list;
+	unsigned int ctl_gen;	/* bumped when the list is freed */
 
 	/* Components don't define cdev, the card device. When executing
 	 * a sequence of a component device, ucm manager enters component
@@ -253,6 +298,11 @@ struct snd_use_case_mgr {
 	 */
 	int in_component_domain;
 	char *cdev;
+
+	/* lookup caches */
+	struct ucm_index_entry **index;
+	struct ucm_value_memo *value_memo[UC_MGR_HASH_SIZE];
+	unsigned int value_memo_count;
 };
 
 #define uc_error SNDERR
@@ -268,6 +318,7 @@ void uc_mgr_stdout(const char *fmt, ...);
 
 const char *uc_mgr_config_dir(int format);
 int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg);
+void uc_mgr_config_prefetch(int format, const char *file);
 int uc_mgr_config_load_file(snd_use_case_mgr_t *uc_mgr,  const char *file, snd_config_t **cfg);
 int uc_mgr_import_master_config(snd_use_case_mgr_t *uc_mgr);
 int uc_mgr_scan_master_configs(const char **_list[]);
@@ -296,6 +347,21 @@ void uc_mgr_free_ctl_list(snd_use_case_mgr_t *uc_mgr);
 
 int uc_mgr_add_value(struct list_head *base, const char *key, char *val);
 
+void *uc_mgr_index_find(snd_use_case_mgr_t *uc_mgr, unsigned int kind,
+			const void *parent, const char *name);
+void uc_mgr_index_free(snd_use_case_mgr_t *uc_mgr);
+struct ucm_value_memo *uc_mgr_value_memo_find(snd_use_case_mgr_t *uc_mgr,
+					      const struct use_case_verb *verb,
+					      int verb_given,
+					      const char *mod_dev,
+					      const char *identifier,
+					      int exact);
+void uc_mgr_value_memo_put(snd_use_case_mgr_t *uc_mgr,
+			   const struct use_case_verb *verb, int verb_given,
+			   const char *mod_dev, const char *identifier,
+			   int exact, int err, const char *value);
+void uc_mgr_value_memo_free(snd_use_case_mgr_t *uc_mgr);
+
 const char *uc_mgr_get_variable(snd_use_case_mgr_t *uc_mgr,
 				const char *name);
 
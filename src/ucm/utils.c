@@ -31,6 +31,7 @@
  */
 
 #include "ucm_local.h"
+#include <sys/stat.h>
 
 void uc_mgr_error(const char *fmt,...)
 {
@@ -146,6 +147,8 @@ void uc_mgr_free_ctl_list(snd_use_case_mgr_t *uc_mgr)
 		list_del(&ctl_list->list);
 		uc_mgr_free_ctl(ctl_list);
 	}
+	/* invalidate the resolved csets */
+	uc_mgr->ctl_gen++;
 }
 
 static int uc_mgr_ctl_add_dev(struct ctl_list *ctl_list, const char *device)
@@ -320,24 +323,159 @@ const char *uc_mgr_config_dir(int format)
 	return path;
 }
 
-int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg)
+/*
+ * Cache of the parsed configuration files shared by all managers.
+ * The entries are validated using the file inode, size and mtime.
+ * Files using the <...> includes are not cached, because the included
+ * files are not tracked.
+ */
+#define UC_MGR_FILE_CACHE_MAX	128
+
+struct ucm_file_cache {
+	struct list_head list;
+	char *filename;
+	int format;
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	snd_config_t *cfg;
+};
+
+static LIST_HEAD(file_cache);
+static unsigned int file_cache_count;
+static pthread_mutex_t file_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int file_cache_match(struct ucm_file_cache *fc, int format,
+			    const struct stat *st)
+{
+	return fc->format == format &&
+	       fc->dev == st->st_dev && fc->ino == st->st_ino &&
+	       fc->size == st->st_size &&
+	       fc->mtime.tv_sec == st->st_mtim.tv_sec &&
+	       fc->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static void file_cache_free(struct ucm_file_cache *fc)
+{
+	list_del(&fc->list);
+	file_cache_count--;
+	snd_config_delete(fc->cfg);
+	free(fc->filename);
+	free(fc);
+}
+
+/* return a copy of the cached tree; 1 = hit */
+static int file_cache_get(const char *file, int format,
+			  const struct stat *st, snd_config_t **cfg)
+{
+	struct list_head *pos;
+	struct ucm_file_cache *fc;
+	int err = 0;
+
+	pthread_mutex_lock(&file_cache_mutex);
+	list_for_each(pos, &file_cache) {
+		fc = list_entry(pos, struct ucm_file_cache, list);
+		if (strcmp(fc->filename, file))
+			continue;
+		if (!file_cache_match(fc, format, st)) {
+			file_cache_free(fc);
+			break;
+		}
+		err = snd_config_copy(cfg, fc->cfg);
+		if (err >= 0) {
+			/* keep the recently used entries at the head */
+			list_del(&fc->list);
+			list_add(&fc->list, &file_cache);
+			err = 1;
+		}
+		break;
+	}
+	pthread_mutex_unlock(&file_cache_mutex);
+	return err;
+}
+
+static void file_cache_put(const char *file, int format,
+			   const struct stat *st, snd_config_t *cfg)
+{
+	struct list_head *pos;
+	struct ucm_file_cache *fc;
+
+	fc = calloc(1, sizeof(*fc));
+	if (fc == NULL)
+		return;
+	fc->filename = strdup(file);
+	if (fc->filename == NULL || snd_config_copy(&fc->cfg, cfg) < 0) {
+		free(fc->filename);
+		free(fc);
+		return;
+	}
+	fc->format = format;
+	fc->dev = st->st_dev;
+	fc->ino = st->st_ino;
+	fc->size = st->st_size;
+	fc->mtime = st->st_mtim;
+	pthread_mutex_lock(&file_cache_mutex);
+	/* another thread may have loaded the same file */
+	list_for_each(pos, &file_cache) {
+		if (strcmp(list_entry(pos, struct ucm_file_cache, list)->filename, file) == 0) {
+			file_cache_free(list_entry(pos, struct ucm_file_cache, list));
+			break;
+		}
+	}
+	if (file_cache_count >= UC_MGR_FILE_CACHE_MAX)
+		file_cache_free(list_entry(file_cache.prev, struct ucm_file_cache, list));
+	list_add(&fc->list, &file_cache);
+	file_cache_count++;
+	pthread_mutex_unlock(&file_cache_mutex);
+}
+
+static int config_load(int format, const char *file, snd_config_t **cfg,
+		       int verbose)
 {
-	FILE *fp;
 	snd_input_t *in;
 	snd_config_t *top;
 	const char *default_paths[2];
-	int err;
+	struct stat st;
+	char *buf;
+	ssize_t r;
+	int fd, err;
 
-	fp = fopen(file, "r");
-	if (!fp) {
+	fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
 		err = -errno;
-  __err0:
-		uc_error("could not open configuration file %s", file);
-		return err;
+		goto __err0;
 	}
-	err = snd_input_stdio_attach(&in, fp, 1);
-	if (err < 0)
+	if (fstat(fd, &st) < 0) {
+		err = -errno;
+		close(fd);
+		goto __err0;
+	}
+	err = file_cache_get(file, format, &st, cfg);
+	if (err != 0) {
+		close(fd);
+		return err < 0 ? err : 0;
+	}
+	buf = malloc(st.st_size + 1);
+	if (buf == NULL) {
+		close(fd);
+		return -ENOMEM;
+	}
+	r = read(fd, buf, st.st_size);
+	err = r < 0 ? -errno : 0;
+	close(fd);
+	if (r != st.st_size) {
+		if (err == 0)
+			err = -EIO;
+		free(buf);
 		goto __err0;
+	}
+	buf[r] = '\0';
+	err = snd_input_buffer_open(&in, buf, r);
+	if (err < 0) {
+		free(buf);
+		goto __err0;
+	}
 	err = snd_config_top(&top);
 	if (err < 0)
 		goto __err1;
@@ -346,7 +484,8 @@ int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg)
 	default_paths[1] = NULL;
 	err = _snd_config_load_with_include(top, in, 0, default_paths);
 	if (err < 0) {
-		uc_error("could not load configuration file %s", file);
+		if (verbose)
+			uc_error("could not load configuration file %s", file);
 		goto __err2;
 	}
 	err = snd_input_close(in);
@@ -354,6 +493,9 @@ int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg)
 		in = NULL;
 		goto __err2;
 	}
+	if (strchr(buf, '<') == NULL)
+		file_cache_put(file, format, &st, top);
+	free(buf);
 	*cfg = top;
 	return 0;
 
@@ -362,7 +504,29 @@ int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg)
  __err1:
 	if (in)
 		snd_input_close(in);
+	free(buf);
 	return err;
+ __err0:
+	if (verbose)
+		uc_error("could not open configuration file %s", file);
+	return err;
+}
+
+int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg)
+{
+	return config_load(format, file, cfg, 1);
+}
+
+/*
+ * Parse the file to the cache only. Called from the helper threads
+ * before the sequential parsing of the master file.
+ */
+void uc_mgr_config_prefetch(int format, const char *file)
+{
+	snd_config_t *cfg;
+
+	if (config_load(format, file, &cfg, 0) == 0)
+		snd_config_delete(cfg);
 }
 
 void uc_mgr_free_value(struct list_head *base)
@@ -467,6 +631,10 @@ void uc_mgr_free_sequence_element(struct sequence_element *seq)
 	case SEQUENCE_ELEMENT_TYPE_CSET_BIN_FILE:
 	case SEQUENCE_ELEMENT_TYPE_CSET_TLV:
 		free(seq->data.cset);
+		if (seq->cset_op) {
+			free(seq->cset_op->tlv);
+			free(seq->cset_op);
+		}
 		break;
 	case SEQUENCE_ELEMENT_TYPE_EXEC:
 		free(seq->data.exec);
@@ -565,6 +733,199 @@ void uc_mgr_free_device_list(struct list_head *base)
 	}
 }
 
+static unsigned int uc_mgr_hash(unsigned int kind, const void *parent,
+				const char *name)
+{
+	unsigned int h = 2166136261u ^ kind;
+	uintptr_t p = (uintptr_t)parent;
+
+	for (; *name; name++)
+		h = (h ^ (unsigned char)*name) * 16777619u;
+	h ^= (unsigned int)(p ^ (p >> 16));
+	return (h ^ (h >> 16)) % UC_MGR_HASH_SIZE;
+}
+
+static int uc_mgr_index_add(snd_use_case_mgr_t *uc_mgr, unsigned int kind,
+			    const void *parent, const char *name, void *obj)
+{
+	struct ucm_index_entry *e, **head;
+
+	head = &uc_mgr->index[uc_mgr_hash(kind, parent, name)];
+	/* the first one wins like in the list walks */
+	for (e = *head; e; e = e->next)
+		if (e->kind == kind && e->parent == parent &&
+		    strcmp(e->name, name) == 0)
+			return 0;
+	e = malloc(sizeof(*e));
+	if (e == NULL)
+		return -ENOMEM;
+	e->kind = kind;
+	e->parent = parent;
+	e->name = name;
+	e->obj = obj;
+	e->next = *head;
+	*head = e;
+	return 0;
+}
+
+static int uc_mgr_index_build(snd_use_case_mgr_t *uc_mgr)
+{
+	struct list_head *pos, *pos1;
+	struct use_case_verb *verb;
+	struct use_case_device *dev;
+	struct use_case_modifier *mod;
+	int err = 0;
+
+	uc_mgr->index = calloc(UC_MGR_HASH_SIZE, sizeof(*uc_mgr->index));
+	if (uc_mgr->index == NULL)
+		return -ENOMEM;
+	list_for_each(pos, &uc_mgr->verb_list) {
+		verb = list_entry(pos, struct use_case_verb, list);
+		err = uc_mgr_index_add(uc_mgr, UC_MGR_INDEX_VERB, NULL,
+				       verb->name, verb);
+		if (err < 0)
+			goto __error;
+		list_for_each(pos1, &verb->device_list) {
+			dev = list_entry(pos1, struct use_case_device, list);
+			err = uc_mgr_index_add(uc_mgr, UC_MGR_INDEX_DEVICE, verb,
+					       dev->name, dev);
+			if (err < 0)
+				goto __error;
+		}
+		list_for_each(pos1, &verb->modifier_list) {
+			mod = list_entry(pos1, struct use_case_modifier, list);
+			err = uc_mgr_index_add(uc_mgr, UC_MGR_INDEX_MODIFIER, verb,
+					       mod->name, mod);
+			if (err < 0)
+				goto __error;
+		}
+	}
+	return 0;
+      __error:
+	uc_mgr_index_free(uc_mgr);
+	return err;
+}
+
+/*
+ * Find a verb (parent is NULL), device or modifier (parent is the verb)
+ * using the name index.
+ */
+void *uc_mgr_index_find(snd_use_case_mgr_t *uc_mgr, unsigned int kind,
+			const void *parent, const char *name)
+{
+	struct ucm_index_entry *e;
+
+	if (uc_mgr->index == NULL && uc_mgr_index_build(uc_mgr) < 0)
+		return NULL;
+	for (e = uc_mgr->index[uc_mgr_hash(kind, parent, name)]; e; e = e->next)
+		if (e->kind == kind && e->parent == parent &&
+		    strcmp(e->name, name) == 0)
+			return e->obj;
+	return NULL;
+}
+
+void uc_mgr_index_free(snd_use_case_mgr_t *uc_mgr)
+{
+	struct ucm_index_entry *e, *next;
+	unsigned int i;
+
+	if (uc_mgr->index == NULL)
+		return;
+	for (i = 0; i < UC_MGR_HASH_SIZE; i++) {
+		for (e = uc_mgr->index[i]; e; e = next) {
+			next = e->next;
+			free(e);
+		}
+	}
+	free(uc_mgr->index);
+	uc_mgr->index = NULL;
+}
+
+static int value_memo_match(struct ucm_value_memo *m,
+			    const struct use_case_verb *verb, int verb_given,
+			    const char *mod_dev, const char *identifier,
+			    int exact)
+{
+	if (m->verb != verb || m->verb_given != verb_given ||
+	    m->exact != exact)
+		return 0;
+	if (strcmp(m->identifier, identifier))
+		return 0;
+	if (m->mod_dev == NULL || mod_dev == NULL)
+		return m->mod_dev == mod_dev;
+	return strcmp(m->mod_dev, mod_dev) == 0;
+}
+
+struct ucm_value_memo *uc_mgr_value_memo_find(snd_use_case_mgr_t *uc_mgr,
+					      const struct use_case_verb *verb,
+					      int verb_given,
+					      const char *mod_dev,
+					      const char *identifier,
+					      int exact)
+{
+	struct ucm_value_memo *m;
+
+	m = uc_mgr->value_memo[uc_mgr_hash(exact, verb, identifier)];
+	for (; m; m = m->next)
+		if (value_memo_match(m, verb, verb_given, mod_dev,
+				     identifier, exact))
+			return m;
+	return NULL;
+}
+
+void uc_mgr_value_memo_put(snd_use_case_mgr_t *uc_mgr,
+			   const struct use_case_verb *verb, int verb_given,
+			   const char *mod_dev, const char *identifier,
+			   int exact, int err, const char *value)
+{
+	struct ucm_value_memo *m, **head;
+
+	if (uc_mgr->value_memo_count >= UC_MGR_VALUE_MEMO_MAX)
+		uc_mgr_value_memo_free(uc_mgr);
+	m = calloc(1, sizeof(*m));
+	if (m == NULL)
+		return;
+	m->identifier = strdup(identifier);
+	if (mod_dev)
+		m->mod_dev = strdup(mod_dev);
+	if (value)
+		m->value = strdup(value);
+	if (m->identifier == NULL || (mod_dev && m->mod_dev == NULL) ||
+	    (value && m->value == NULL)) {
+		free(m->identifier);
+		free(m->mod_dev);
+		free(m->value);
+		free(m);
+		return;
+	}
+	m->verb = verb;
+	m->verb_given = verb_given;
+	m->exact = exact;
+	m->err = err;
+	head = &uc_mgr->value_memo[uc_mgr_hash(exact, verb, identifier)];
+	m->next = *head;
+	*head = m;
+	uc_mgr->value_memo_count++;
+}
+
+void uc_mgr_value_memo_free(snd_use_case_mgr_t *uc_mgr)
+{
+	struct ucm_value_memo *m, *next;
+	unsigned int i;
+
+	for (i = 0; i < UC_MGR_HASH_SIZE; i++) {
+		for (m = uc_mgr->value_memo[i]; m; m = next) {
+			next = m->next;
+			free(m->identifier);
+			free(m->mod_dev);
+			free(m->value);
+			free(m);
+		}
+		uc_mgr->value_memo[i] = NULL;
+	}
+	uc_mgr->value_memo_count = 0;
+}
+
 int uc_mgr_rename_device(struct use_case_verb *verb, const char *src,
 			 const char *dst)
 {
@@ -665,6 +1026,8 @@ void uc_mgr_free_verb(snd_use_case_mgr_t *uc_mgr)
 	struct list_head *pos, *npos;
 	struct use_case_verb *verb;
 
+	uc_mgr_index_free(uc_mgr);
+	uc_mgr_value_memo_free(uc_mgr);
 	list_for_each_safe(pos, npos, &uc_mgr->verb_list) {
 		verb = list_entry(pos, struct use_case_verb, list);
 		free(verb->name);
@@ -359,6 +359,107 @@ static void test_encode_byte(void)
 	snd_midi_event_free(midi_event);
 }
 
+static void test_encode_block(void)
+{
+	static const unsigned char stream[] = {
+		0x90, 0x3c, 0x40, 0x3e, 0x41,		/* note on + running status */
+		0xf8,					/* clock */
+		0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7,	/* sysex */
+		0xb1, 0x07, 0xf8, 0x64,			/* controller with clock */
+		0xe2, 0x00, 0x40,			/* pitch bend */
+		0xf0, 0x01, 0x02, 0x03, 0x04, 0x05,	/* chunked sysex */
+		0x06, 0xf7,
+		0xc3, 0x05, 0x06,			/* program change */
+		0xf0, 0x11, 0x12,			/* incomplete sysex */
+	};
+	snd_midi_event_t *block, *ref;
+	snd_seq_event_t evs[32], ev;
+	unsigned int i, n, nref = 0;
+	long pos;
+	int ok = 1;
+
+	if (ALSA_CHECK(snd_midi_event_new(4, &block)) < 0)
+		return;
+	if (ALSA_CHECK(snd_midi_event_new(4, &ref)) < 0) {
+		snd_midi_event_free(block);
+		return;
+	}
+	memset(evs, 0, sizeof(evs));
+	pos = snd_midi_event_encode_block(block, stream, sizeof(stream),
+					  evs, 32, &n);
+	TEST_CHECK(pos == sizeof(stream));
+	/* the result must be identical to the byte-wise encoder */
+	for (i = 0; i < sizeof(stream); i++) {
+		snd_seq_ev_clear(&ev);
+		if (snd_midi_event_encode_byte(ref, stream[i], &ev) <= 0)
+			continue;
+		if (nref >= n || evs[nref].type != ev.type) {
+			ok = 0;
+			break;
+		}
+		if (ev.type == SND_SEQ_EVENT_SYSEX)
+			ok &= evs[nref].data.ext.len == ev.data.ext.len &&
+			      !memcmp(evs[nref].data.ext.ptr, ev.data.ext.ptr,
+				      ev.data.ext.len);
+		else
+			ok &= !memcmp(&evs[nref].data, &ev.data, sizeof(ev.data));
+		nref++;
+	}
+	TEST_CHECK(ok);
+	TEST_CHECK(n == nref);
+	TEST_CHECK(n == 12);
+	/* sysex chunks lying in the stream are passed without copy */
+	TEST_CHECK(evs[3].type == SND_SEQ_EVENT_SYSEX);
+	TEST_CHECK(evs[3].data.ext.ptr == stream + 6);
+	TEST_CHECK(evs[4].data.ext.ptr == stream + 10);
+	/* events are limited by max */
+	snd_midi_event_reset_encode(block);
+	pos = snd_midi_event_encode_block(block, stream, sizeof(stream),
+					  evs, 2, &n);
+	TEST_CHECK(pos == 5);
+	TEST_CHECK(n == 2);
+
+	snd_midi_event_free(ref);
+	snd_midi_event_free(block);
+}
+
+static void test_decode_block(void)
+{
+	snd_midi_event_t *midi_event;
+	snd_seq_event_t evs[6];
+	unsigned char buf[32];
+	unsigned int done;
+	long count;
+
+	if (ALSA_CHECK(snd_midi_event_new(0, &midi_event)) < 0)
+		return;
+
+	memset(evs, 0, sizeof(evs));
+	snd_seq_ev_set_noteon(&evs[0], 1, 0x3c, 0x40);
+	snd_seq_ev_set_noteon(&evs[1], 1, 0x3e, 0x41);
+	evs[2].type = SND_SEQ_EVENT_ECHO;
+	snd_seq_ev_set_sysex(&evs[3], 4, "\xf0\x01\x02\xf7");
+	snd_seq_ev_set_noteoff(&evs[4], 1, 0x3c, 0);
+	snd_seq_ev_set_controller(&evs[5], 2, 7, 100);
+
+	count = snd_midi_event_decode_block(midi_event, buf, sizeof(buf),
+					    evs, 6, &done);
+	TEST_CHECK(done == 6);
+	TEST_CHECK(midi_matches_regex(buf, count,
+				      "913c403e41f00102f7813c00b20764"));
+
+	/* stop at the event not fitting into the buffer */
+	snd_midi_event_reset_decode(midi_event);
+	count = snd_midi_event_decode_block(midi_event, buf, 6,
+					    evs, 6, &done);
+	TEST_CHECK(done == 3);
+	TEST_CHECK(midi_matches_regex(buf, count, "913c403e41"));
+	TEST_CHECK(snd_midi_event_decode_block(midi_event, buf, 2,
+					       evs + 3, 3, &done) == -ENOMEM);
+
+	snd_midi_event_free(midi_event);
+}
+
 int main(void)
 {
 	test_decode();
@@ -367,5 +468,7 @@ int main(void)
 	test_reset_encode();
 	test_encode_byte();
 	test_init();
+	test_encode_block();
+	test_decode_block();
 	return TEST_EXIT_CODE();
 }
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+#define FRAMES		37
+#define MAX_CHANNELS	32
+
+static void fill(unsigned char *buf, size_t size, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = (unsigned char)(seed + i * 7 + (i >> 8));
+}
+
+static void set_interleaved(snd_pcm_channel_area_t *areas, void *buf,
+			    unsigned int channels, int width)
+{
+	unsigned int c;
+
+	for (c = 0; c < channels; c++) {
+		areas[c].addr = buf;
+		areas[c].first = c * width;
+		areas[c].step = channels * width;
+	}
+}
+
+static void set_planar(snd_pcm_channel_area_t *areas, unsigned char *buf,
+		       unsigned int channels, int width, size_t frames)
+{
+	unsigned int c;
+
+	for (c = 0; c < channels; c++) {
+		areas[c].addr = buf + c * frames * (width / 8);
+		areas[c].first = 0;
+		areas[c].step = width;
+	}
+}
+
+/*
+ * interleaved -> planar -> interleaved with snd_pcm_areas_copy(),
+ * compared with the per-channel snd_pcm_area_copy()
+ */
+static void test_transpose(snd_pcm_format_t format, unsigned int channels)
+{
+	snd_pcm_channel_area_t inter[MAX_CHANNELS], planar[MAX_CHANNELS];
+	int width = snd_pcm_format_physical_width(format);
+	size_t size = (FRAMES + 3) * channels * (width / 8);
+	unsigned char *src, *dst1, *dst2, *back;
+	unsigned int c;
+
+	src = malloc(size);
+	dst1 = calloc(1, size);
+	dst2 = calloc(1, size);
+	back = calloc(1, size);
+	if (!src || !dst1 || !dst2 || !back) {
+		TEST_CHECK(0);
+		goto __end;
+	}
+	fill(src, size, channels);
+
+	set_interleaved(inter, src, channels, width);
+	set_planar(planar, dst1, channels, width, FRAMES + 3);
+	ALSA_CHECK(snd_pcm_areas_copy(planar, 2, inter, 1, channels,
+				      FRAMES, format));
+	set_planar(planar, dst2, channels, width, FRAMES + 3);
+	for (c = 0; c < channels; c++)
+		ALSA_CHECK(snd_pcm_area_copy(&planar[c], 2, &inter[c], 1,
+					     FRAMES, format));
+	TEST_CHECK(memcmp(dst1, dst2, size) == 0);
+
+	set_planar(planar, dst1, channels, width, FRAMES + 3);
+	set_interleaved(inter, back, channels, width);
+	ALSA_CHECK(snd_pcm_areas_copy(inter, 1, planar, 2, channels,
+				      FRAMES, format));
+	TEST_CHECK(memcmp(back + channels * (width / 8),
+			  src + channels * (width / 8),
+			  FRAMES * channels * (width / 8)) == 0);
+
+      __end:
+	free(src);
+	free(dst1);
+	free(dst2);
+	free(back);
+}
+
+/* silence planar and interleaved areas, compared with one sample silence */
+static void test_silence(snd_pcm_format_t format, unsigned int channels)
+{
+	snd_pcm_channel_area_t areas[MAX_CHANNELS], one;
+	int width = snd_pcm_format_physical_width(format);
+	size_t size = (FRAMES + 2) * channels * (width / 8);
+	unsigned char *buf, sample[8];
+	size_t i, bytes = width / 8;
+
+	one.addr = sample;
+	one.first = 0;
+	one.step = width;
+	if (ALSA_CHECK(snd_pcm_area_silence(&one, 0, 1, format)) < 0)
+		return;
+	buf = malloc(size);
+	if (!buf) {
+		TEST_CHECK(0);
+		return;
+	}
+
+	fill(buf, size, 1);
+	set_planar(areas, buf, channels, width, FRAMES + 2);
+	ALSA_CHECK(snd_pcm_areas_silence(areas, 1, channels, FRAMES, format));
+	for (i = 0; i < size / bytes; i++) {
+		if (i % (FRAMES + 2) == 0 || i % (FRAMES + 2) == FRAMES + 1)
+			continue;
+		TEST_CHECK(memcmp(buf + i * bytes, sample, bytes) == 0);
+	}
+
+	fill(buf, size, 2);
+	set_interleaved(areas, buf, channels, width);
+	ALSA_CHECK(snd_pcm_areas_silence(areas, 1, channels, FRAMES, format));
+	for (i = channels; i < (FRAMES + 1) * channels; i++)
+		TEST_CHECK(memcmp(buf + i * bytes, sample, bytes) == 0);
+	free(buf);
+}
+
+int main(void)
+{
+	static const snd_pcm_format_t formats[] = {
+		SND_PCM_FORMAT_U8,
+		SND_PCM_FORMAT_S16_LE,
+		SND_PCM_FORMAT_S24_3LE,
+		SND_PCM_FORMAT_U24_3LE,
+		SND_PCM_FORMAT_S32_LE,
+		SND_PCM_FORMAT_FLOAT64_LE,
+	};
+	static const unsigned int channels[] = { 2, 3, 8, 32 };
+	unsigned int f, c;
+
+	for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		for (c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+			test_transpose(formats[f], channels[c]);
+			test_silence(formats[f], channels[c]);
+		}
+	}
+	return TEST_EXIT_CODE();
+}
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test.h"
+
+/* automake exit code of a skipped test */
+#define TEST_SKIP	77
+
+#define CHANNELS	2
+#define FRAMES		2048
+/* more than the clients of a mixing server */
+#define CHILDREN	20
+
+static const char config_text[] =
+	"pcm.mixtest {\n"
+	"	type dmix\n"
+	"	ipc_key 0x4d495854\n"
+	"	mix_server true\n"
+	"	slave {\n"
+	"		pcm { type hw card 0 device 0 }\n"
+	"		format S16_LE\n"
+	"		rate 48000\n"
+	"		channels 2\n"
+	"		period_size 1024\n"
+	"		buffer_size 4096\n"
+	"	}\n"
+	"}\n";
+
+static int open_client(snd_pcm_t **pcm, snd_config_t *conf)
+{
+	int err;
+
+	err = snd_pcm_open_lconf(pcm, "mixtest", SND_PCM_STREAM_PLAYBACK,
+				 SND_PCM_NONBLOCK, conf);
+	if (err < 0)
+		return err;
+	err = snd_pcm_set_params(*pcm, SND_PCM_FORMAT_S16_LE,
+				 SND_PCM_ACCESS_RW_INTERLEAVED, CHANNELS,
+				 48000, 0, 85000);
+	if (err < 0)
+		snd_pcm_close(*pcm);
+	return err;
+}
+
+/* both clients of the server take their frames and keep running */
+static void test_two_clients(snd_pcm_t *a, snd_pcm_t *b)
+{
+	short buf[FRAMES * CHANNELS];
+	unsigned int i;
+
+	for (i = 0; i < FRAMES * CHANNELS; i++)
+		buf[i] = (short)(i * 64);
+	TEST_CHECK(snd_pcm_writei(a, buf, FRAMES) == FRAMES);
+	TEST_CHECK(snd_pcm_writei(b, buf, FRAMES) == FRAMES);
+	ALSA_CHECK(snd_pcm_start(a));
+	ALSA_CHECK(snd_pcm_start(b));
+	usleep(50000);
+	TEST_CHECK(snd_pcm_state(a) == SND_PCM_STATE_RUNNING);
+	TEST_CHECK(snd_pcm_state(b) == SND_PCM_STATE_RUNNING);
+	TEST_CHECK(snd_pcm_avail_update(a) > 0);
+	TEST_CHECK(snd_pcm_avail_update(b) > 0);
+}
+
+/*
+ * Clients exiting without closing leave their slots behind; the slots
+ * must be taken over by the next clients.
+ */
+static void test_slot_reuse(snd_config_t *conf)
+{
+	snd_pcm_t *pcm;
+	pid_t pid;
+	int i, status;
+
+	for (i = 0; i < CHILDREN; i++) {
+		pid = fork();
+		if (pid < 0) {
+			TEST_CHECK(pid >= 0);
+			return;
+		}
+		if (pid == 0)
+			_exit(open_client(&pcm, conf) < 0);
+		TEST_CHECK(waitpid(pid, &status, 0) == pid);
+		TEST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+}
+
+int main(void)
+{
+	snd_config_t *conf;
+	snd_input_t *input;
+	snd_pcm_t *a, *b;
+
+	if (ALSA_CHECK(snd_config_top(&conf)) < 0)
+		return TEST_EXIT_CODE();
+	if (ALSA_CHECK(snd_input_buffer_open(&input, config_text,
+					     strlen(config_text))) < 0)
+		return TEST_EXIT_CODE();
+	ALSA_CHECK(snd_config_load(conf, input));
+	snd_input_close(input);
+
+	/* no sound card */
+	if (open_client(&a, conf) < 0) {
+		snd_config_delete(conf);
+		return TEST_SKIP;
+	}
+	if (ALSA_CHECK(open_client(&b, conf)) >= 0) {
+		test_two_clients(a, b);
+		test_slot_reuse(conf);
+		snd_pcm_close(b);
+	}
+	snd_pcm_close(a);
+	snd_config_delete(conf);
+	return TEST_EXIT_CODE();
+}
@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "test.h"
+
+/* automake exit code of a skipped test */
+#define TEST_SKIP	77
+
+#define SYSEX_LEN	300
+
+static snd_seq_t *open_seq(void)
+{
+	snd_seq_t *seq;
+
+	if (snd_seq_open(&seq, "hw", SND_SEQ_OPEN_DUPLEX, 0) < 0)
+		return NULL;
+	return seq;
+}
+
+static int create_port(snd_seq_t *seq)
+{
+	return snd_seq_create_simple_port(seq, "test",
+			SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_WRITE,
+			SND_SEQ_PORT_TYPE_APPLICATION);
+}
+
+/* read the next event, it must be of the given type */
+static snd_seq_event_t *expect_event(snd_seq_t *seq, int type)
+{
+	snd_seq_event_t *ev = NULL;
+
+	if (ALSA_CHECK(snd_seq_event_input(seq, &ev)) < 0)
+		return NULL;
+	TEST_CHECK(ev->type == type);
+	return ev->type == type ? ev : NULL;
+}
+
+static void check_sysex(snd_seq_event_t *ev, const unsigned char *data,
+			unsigned int len)
+{
+	if (!ev)
+		return;
+	TEST_CHECK(ev->data.ext.len == len);
+	if (ev->data.ext.len == len)
+		TEST_CHECK(memcmp(ev->data.ext.ptr, data, len) == 0);
+}
+
+/*
+ * fixed and SysEx events sent together with snd_seq_event_output_batch();
+ * the output buffer keeps the given size
+ */
+static void test_output_batch(snd_seq_t *seq, int port, size_t obuf_size)
+{
+	snd_seq_event_t evs[5];
+	unsigned char sysex1[SYSEX_LEN], sysex2[4] = { 0xf0, 0x7e, 0x01, 0xf7 };
+	unsigned int i;
+
+	sysex1[0] = 0xf0;
+	for (i = 1; i < SYSEX_LEN - 1; i++)
+		sysex1[i] = i & 0x7f;
+	sysex1[SYSEX_LEN - 1] = 0xf7;
+
+	for (i = 0; i < 5; i++) {
+		snd_seq_ev_clear(&evs[i]);
+		snd_seq_ev_set_source(&evs[i], port);
+		snd_seq_ev_set_dest(&evs[i], snd_seq_client_id(seq), port);
+		snd_seq_ev_set_direct(&evs[i]);
+	}
+	/* a batch starting with a SysEx */
+	snd_seq_ev_set_sysex(&evs[0], sizeof(sysex2), sysex2);
+	snd_seq_ev_set_noteon(&evs[1], 0, 60, 100);
+	snd_seq_ev_set_sysex(&evs[2], sizeof(sysex1), sysex1);
+	snd_seq_ev_set_noteoff(&evs[3], 0, 60, 0);
+	snd_seq_ev_set_controller(&evs[4], 0, 7, 90);
+	TEST_CHECK(snd_seq_event_output_batch(seq, evs, 5) == 5);
+	TEST_CHECK(snd_seq_event_output_pending(seq) == 0);
+	TEST_CHECK(snd_seq_get_output_buffer_size(seq) == obuf_size);
+
+	check_sysex(expect_event(seq, SND_SEQ_EVENT_SYSEX), sysex2,
+		    sizeof(sysex2));
+	expect_event(seq, SND_SEQ_EVENT_NOTEON);
+	check_sysex(expect_event(seq, SND_SEQ_EVENT_SYSEX), sysex1,
+		    sizeof(sysex1));
+	expect_event(seq, SND_SEQ_EVENT_NOTEOFF);
+	expect_event(seq, SND_SEQ_EVENT_CONTROLLER);
+}
+
+/*
+ * A producer and a consumer of type shm in one process: the SysEx goes
+ * through the kernel, the notes through the shared ring, and the SysEx
+ * must not wait until the ring is drained.
+ */
+static void test_shm_pair(void)
+{
+	snd_seq_t *prod, *cons;
+	snd_seq_event_t ev, *rev;
+	unsigned char sysex[4] = { 0xf0, 0x7e, 0x02, 0xf7 };
+	int port, i, notes = 0, sysex_at = -1;
+
+	if (snd_seq_open(&cons, "shm", SND_SEQ_OPEN_INPUT, 0) < 0)
+		return;
+	if (ALSA_CHECK(snd_seq_open(&prod, "shm", SND_SEQ_OPEN_OUTPUT, 0)) < 0) {
+		snd_seq_close(cons);
+		return;
+	}
+	port = ALSA_CHECK(create_port(cons));
+	if (port < 0)
+		goto __end;
+
+	snd_seq_ev_clear(&ev);
+	snd_seq_ev_set_dest(&ev, snd_seq_client_id(cons), port);
+	snd_seq_ev_set_direct(&ev);
+	snd_seq_ev_set_sysex(&ev, sizeof(sysex), sysex);
+	ALSA_CHECK(snd_seq_event_output_direct(prod, &ev));
+	for (i = 0; i < 1000; i++) {
+		snd_seq_ev_set_noteon(&ev, 0, i & 0x7f, 100);
+		ALSA_CHECK(snd_seq_event_output_direct(prod, &ev));
+	}
+
+	for (i = 0; i < 1001; i++) {
+		if (ALSA_CHECK(snd_seq_event_input(cons, &rev)) < 0)
+			break;
+		if (rev->type == SND_SEQ_EVENT_NOTEON) {
+			TEST_CHECK(rev->data.note.note == (notes & 0x7f));
+			notes++;
+		} else if (rev->type == SND_SEQ_EVENT_SYSEX) {
+			check_sysex(rev, sysex, sizeof(sysex));
+			sysex_at = i;
+		}
+	}
+	TEST_CHECK(notes == 1000);
+	TEST_CHECK(sysex_at == 0);
+
+      __end:
+	snd_seq_close(prod);
+	snd_seq_close(cons);
+}
+
+/* find the client of the virtual RawMIDI opened by this process */
+static int find_virtual_client(snd_seq_t *seq)
+{
+	snd_seq_client_info_t *cinfo;
+
+	snd_seq_client_info_alloca(&cinfo);
+	snd_seq_client_info_set_client(cinfo, -1);
+	while (snd_seq_query_next_client(seq, cinfo) >= 0) {
+		if (snd_seq_client_info_get_client(cinfo) != snd_seq_client_id(seq) &&
+		    snd_seq_client_info_get_pid(cinfo) == getpid())
+			return snd_seq_client_info_get_client(cinfo);
+	}
+	return -ENOENT;
+}
+
+/*
+ * A SysEx between two short messages written to a virtual RawMIDI whose
+ * port is connected to itself must be read back unchanged.
+ */
+static void test_virtual_sysex(snd_seq_t *seq)
+{
+	snd_rawmidi_t *in, *out;
+	snd_seq_port_subscribe_t *subs;
+	snd_seq_addr_t addr;
+	unsigned char msg[3 + SYSEX_LEN + 3], buf[sizeof(msg)];
+	size_t len = 0;
+	ssize_t n;
+	int client;
+	unsigned int i;
+
+	msg[0] = 0x90;
+	msg[1] = 60;
+	msg[2] = 100;
+	msg[3] = 0xf0;
+	for (i = 1; i < SYSEX_LEN - 1; i++)
+		msg[3 + i] = i & 0x7f;
+	msg[3 + SYSEX_LEN - 1] = 0xf7;
+	msg[3 + SYSEX_LEN] = 0x80;
+	msg[3 + SYSEX_LEN + 1] = 60;
+	msg[3 + SYSEX_LEN + 2] = 0;
+
+	if (ALSA_CHECK(snd_rawmidi_open(&in, &out, "virtual", 0)) < 0)
+		return;
+	client = ALSA_CHECK(find_virtual_client(seq));
+	if (client < 0)
+		goto __end;
+	addr.client = client;
+	addr.port = 0;
+	snd_seq_port_subscribe_alloca(&subs);
+	snd_seq_port_subscribe_set_sender(subs, &addr);
+	snd_seq_port_subscribe_set_dest(subs, &addr);
+	if (ALSA_CHECK(snd_seq_subscribe_port(seq, subs)) < 0)
+		goto __end;
+
+	TEST_CHECK(snd_rawmidi_write(out, msg, sizeof(msg)) == sizeof(msg));
+	ALSA_CHECK(snd_rawmidi_drain(out));
+	while (len < sizeof(buf)) {
+		n = snd_rawmidi_read(in, buf + len, sizeof(buf) - len);
+		if (ALSA_CHECK((int)n) < 0 || n == 0)
+			break;
+		len += n;
+	}
+	TEST_CHECK(len == sizeof(msg));
+	if (len == sizeof(msg))
+		TEST_CHECK(memcmp(buf, msg, sizeof(msg)) == 0);
+
+      __end:
+	snd_rawmidi_close(in);
+	snd_rawmidi_close(out);
+}
+
+/* announce a queue control event stamped with a queue position */
+static void clock_event(snd_seq_queue_clock_t *clock, int q, int type,
+			unsigned int value, const snd_seq_real_time_t *rt,
+			snd_seq_tick_time_t tick)
+{
+	snd_seq_event_t ev;
+
+	snd_seq_ev_clear(&ev);
+	snd_seq_ev_set_queue_control(&ev, type, q, value);
+	if (rt)
+		snd_seq_ev_schedule_real(&ev, q, 0, rt);
+	else
+		snd_seq_ev_schedule_tick(&ev, q, 0, tick);
+	TEST_CHECK(snd_seq_queue_clock_update(clock, &ev) == 1);
+}
+
+/*
+ * The queue clock follows the positions stamped on the announcements,
+ * across a tempo change, and doesn't lose the parts of ticks.
+ */
+static void test_queue_clock(snd_seq_t *seq)
+{
+	snd_seq_queue_clock_t *clock;
+	snd_seq_queue_tempo_t *tempo;
+	snd_seq_real_time_t rt;
+	int q, i;
+
+	q = ALSA_CHECK(snd_seq_alloc_queue(seq));
+	if (q < 0)
+		return;
+	snd_seq_queue_tempo_alloca(&tempo);
+	snd_seq_queue_tempo_set_tempo(tempo, 500000);
+	snd_seq_queue_tempo_set_ppq(tempo, 96);
+	if (ALSA_CHECK(snd_seq_set_queue_tempo(seq, q, tempo)) < 0 ||
+	    ALSA_CHECK(snd_seq_queue_clock_new(&clock, seq, q)) < 0)
+		goto __end;
+
+	/* one beat at 120 bpm */
+	clock_event(clock, q, SND_SEQ_EVENT_START, 0, NULL, 0);
+	clock_event(clock, q, SND_SEQ_EVENT_STOP, 0, NULL, 96);
+	TEST_CHECK(snd_seq_queue_clock_get_tick(clock) == 96);
+	snd_seq_queue_clock_get_time(clock, &rt);
+	TEST_CHECK(rt.tv_sec == 0 && rt.tv_nsec == 500000000);
+
+	/* twice as fast from here */
+	clock_event(clock, q, SND_SEQ_EVENT_TEMPO, 250000, NULL, 96);
+	snd_seq_queue_clock_tick_to_time(clock, 192, &rt);
+	TEST_CHECK(rt.tv_sec == 0 && rt.tv_nsec == 750000000);
+	rt.tv_sec = 1;
+	rt.tv_nsec = 0;
+	TEST_CHECK(snd_seq_queue_clock_time_to_tick(clock, &rt) == 288);
+
+	/* ten steps of 1 ms, 0.384 ticks each */
+	clock_event(clock, q, SND_SEQ_EVENT_CONTINUE, 0, NULL, 96);
+	rt.tv_sec = 0;
+	for (i = 1; i <= 10; i++) {
+		rt.tv_nsec = 500000000 + i * 1000000;
+		clock_event(clock, q, i < 10 ? SND_SEQ_EVENT_TEMPO :
+			    SND_SEQ_EVENT_STOP, 250000, &rt, 0);
+	}
+	TEST_CHECK(snd_seq_queue_clock_get_tick(clock) == 99);
+	snd_seq_queue_clock_get_time(clock, &rt);
+	TEST_CHECK(rt.tv_sec == 0 && rt.tv_nsec == 510000000);
+
+	snd_seq_queue_clock_free(clock);
+      __end:
+	snd_seq_free_queue(seq, q);
+}
+
+int main(void)
+{
+	snd_seq_t *seq;
+	int port;
+
+	seq = open_seq();
+	if (!seq)
+		return TEST_SKIP;
+	port = ALSA_CHECK(create_port(seq));
+	if (port >= 0) {
+		test_output_batch(seq, port, snd_seq_get_output_buffer_size(seq));
+		/* the whole batch doesn't fit to a 400 byte buffer */
+		if (ALSA_CHECK(snd_seq_set_output_buffer_size(seq, 400)) >= 0)
+			test_output_batch(seq, port, 400);
+	}
+	test_virtual_sysex(seq);
+	test_queue_clock(seq);
+	snd_seq_close(seq);
+	test_shm_pair();
+	return TEST_EXIT_CODE();
+}
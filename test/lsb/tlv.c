@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <errno.h>
+#include "test.h"
+
+/* compare the table lookups with the direct TLV conversions */
+static void check_table(unsigned int *tlv, long rangemin, long rangemax)
+{
+	snd_tlv_dB_table_t *table;
+	long min1, max1, min2, max2;
+	long v, db1, db2, val1, val2;
+	int xdir, err1, err2;
+
+	if (ALSA_CHECK(snd_tlv_dB_table_new(&table, tlv, rangemin, rangemax)) < 0)
+		return;
+	err1 = snd_tlv_get_dB_range(tlv, rangemin, rangemax, &min1, &max1);
+	err2 = snd_tlv_dB_table_get_range(table, &min2, &max2);
+	TEST_CHECK(err1 == err2);
+	if (err1 < 0) {
+		min1 = -10000;
+		max1 = 10000;
+	} else {
+		TEST_CHECK(min1 == min2 && max1 == max2);
+	}
+	for (v = rangemin - 2; v <= rangemax + 2; v++) {
+		err1 = snd_tlv_convert_to_dB(tlv, rangemin, rangemax, v, &db1);
+		err2 = snd_tlv_dB_table_convert_to_dB(table, v, &db2);
+		TEST_CHECK(err1 == err2);
+		if (err1 == 0)
+			TEST_CHECK(db1 == db2);
+	}
+	for (v = min1 - 100; v <= max1 + 100; v += 7) {
+		for (xdir = -1; xdir <= 1; xdir++) {
+			err1 = snd_tlv_convert_from_dB(tlv, rangemin, rangemax,
+						       v, &val1, xdir);
+			err2 = snd_tlv_dB_table_convert_from_dB(table, v,
+								&val2, xdir);
+			TEST_CHECK(err1 == err2);
+			if (err1 == 0)
+				TEST_CHECK(val1 == val2);
+		}
+	}
+	snd_tlv_dB_table_free(table);
+}
+
+static void test_scale(void)
+{
+	unsigned int tlv[] = {
+		SND_CTL_TLVT_DB_SCALE, 2 * sizeof(int),
+		(unsigned int)-6000, 0x10000 | 75,
+	};
+	unsigned int *db;
+
+	TEST_CHECK(snd_tlv_parse_dB_info(tlv, sizeof(tlv), &db) > 0);
+	check_table(db, 0, 80);
+	check_table(db, -10, 10);
+}
+
+static void test_minmax(void)
+{
+	unsigned int tlv[] = {
+		SND_CTL_TLVT_DB_MINMAX_MUTE, 2 * sizeof(int),
+		(unsigned int)-9000, 600,
+	};
+
+	check_table(tlv, 0, 255);
+}
+
+static void test_linear(void)
+{
+	unsigned int tlv[] = {
+		SND_CTL_TLVT_DB_LINEAR, 2 * sizeof(int),
+		(unsigned int)-4800, 0,
+	};
+
+	check_table(tlv, 0, 1000);
+}
+
+static void test_range(void)
+{
+	unsigned int tlv[] = {
+		SND_CTL_TLVT_DB_RANGE, 12 * sizeof(int),
+		0, 7, SND_CTL_TLVT_DB_SCALE, 2 * sizeof(int),
+		(unsigned int)-9999999, 0x10000 | 0,
+		8, 63, SND_CTL_TLVT_DB_SCALE, 2 * sizeof(int),
+		(unsigned int)-5000, 100,
+	};
+
+	check_table(tlv, 0, 63);
+	check_table(tlv, 0, 40);
+}
+
+/* the raw value 0 is not covered by any sub-range */
+static void test_range_gap(void)
+{
+	unsigned int tlv[] = {
+		SND_CTL_TLVT_DB_RANGE, 6 * sizeof(int),
+		1, 63, SND_CTL_TLVT_DB_SCALE, 2 * sizeof(int),
+		(unsigned int)-6300, 100,
+	};
+
+	check_table(tlv, 0, 63);
+}
+
+int main(void)
+{
+	test_scale();
+	test_minmax();
+	test_linear();
+	test_range();
+	test_range_gap();
+	return TEST_EXIT_CODE();
+}